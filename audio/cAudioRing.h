@@ -0,0 +1,76 @@
+// cAudioRing.h - single producer, single consumer lock free ring of interleaved float samples
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+//}}}
+
+class cAudioRing {
+public:
+  //{{{
+  cAudioRing (int numChannels, int capacity) : mNumChannels(numChannels) {
+  // capacity in samples, rounded up to power of 2
+
+    mCapacity = 1;
+    while (mCapacity < capacity)
+      mCapacity *= 2;
+
+    mBuffer.resize (mCapacity * mNumChannels);
+    }
+  //}}}
+
+  int getNumChannels() const { return mNumChannels; }
+  int getCapacity() const { return mCapacity; }
+
+  // producer, consumer both safe
+  int getReadAvailable() const { return int(mWriteIndex.load (std::memory_order_acquire) -
+                                            mReadIndex.load (std::memory_order_acquire)); }
+  int getWriteAvailable() const { return mCapacity - getReadAvailable(); }
+
+  //{{{
+  int write (const float* samples, int numSamples) {
+  // producer only, return numSamples written
+
+    uint64_t writeIndex = mWriteIndex.load (std::memory_order_relaxed);
+    numSamples = std::min (numSamples, getWriteAvailable());
+
+    int offset = int(writeIndex & (mCapacity - 1));
+    int firstSamples = std::min (numSamples, mCapacity - offset);
+    memcpy (mBuffer.data() + (offset * mNumChannels), samples, firstSamples * mNumChannels * sizeof(float));
+    memcpy (mBuffer.data(), samples + (firstSamples * mNumChannels),
+            (numSamples - firstSamples) * mNumChannels * sizeof(float));
+
+    mWriteIndex.store (writeIndex + numSamples, std::memory_order_release);
+    return numSamples;
+    }
+  //}}}
+  //{{{
+  int read (float* samples, int numSamples) {
+  // consumer only, return numSamples read
+
+    uint64_t readIndex = mReadIndex.load (std::memory_order_relaxed);
+    numSamples = std::min (numSamples, getReadAvailable());
+
+    int offset = int(readIndex & (mCapacity - 1));
+    int firstSamples = std::min (numSamples, mCapacity - offset);
+    memcpy (samples, mBuffer.data() + (offset * mNumChannels), firstSamples * mNumChannels * sizeof(float));
+    memcpy (samples + (firstSamples * mNumChannels), mBuffer.data(),
+            (numSamples - firstSamples) * mNumChannels * sizeof(float));
+
+    mReadIndex.store (readIndex + numSamples, std::memory_order_release);
+    return numSamples;
+    }
+  //}}}
+
+private:
+  const int mNumChannels;
+  int mCapacity = 0;
+  std::vector <float> mBuffer;
+
+  // free running sample counts, separate cache lines for producer and consumer
+  alignas(64) std::atomic <uint64_t> mWriteIndex = 0;
+  alignas(64) std::atomic <uint64_t> mReadIndex = 0;
+  };
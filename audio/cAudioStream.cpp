@@ -0,0 +1,528 @@
+// cAudioStream.cpp - callback driven linux audio output, player fills lock free ring, sink pulls from it
+//{{{  includes
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+
+#if defined(ALSA)
+  #include <alsa/asoundlib.h>
+#elif defined(USE_PULSE)
+  #include <pulse/pulseaudio.h>
+#else
+  #include <pulse/simple.h>
+  #include <pulse/error.h>
+#endif
+
+#include "cAudioStream.h"
+
+#include "../common/cLog.h"
+#include "fmt/format.h"
+
+using namespace std;
+//}}}
+//{{{  constexpr
+constexpr int kMaxFrameSamples = 2048;
+constexpr int kPeriodsPerBuffer = 4;
+//}}}
+
+namespace {
+  #ifdef ALSA
+    //{{{
+    class cAlsaStream : public cAudioStream {
+    // alsa mmap, own thread writes device buffer in place from ring
+    public:
+      //{{{
+      cAlsaStream (int numChannels, int sampleRate, int latencyUs)
+          : cAudioStream (numChannels, sampleRate, latencyUs) {
+
+        int err = snd_pcm_open (&mHandle, "default", SND_PCM_STREAM_PLAYBACK, 0);
+        if (err < 0) {
+          cLog::log (LOGERROR, fmt::format ("cAlsaStream snd_pcm_open {}", snd_strerror (err)));
+          return;
+          }
+
+        //{{{  hw params, mmap interleaved float, device buffer half of target latency
+        snd_pcm_hw_params_t* hwParams;
+        snd_pcm_hw_params_alloca (&hwParams);
+        snd_pcm_hw_params_any (mHandle, hwParams);
+
+        unsigned int rate = sampleRate;
+        unsigned int bufferTime = latencyUs / 2;
+        unsigned int periodTime = bufferTime / kPeriodsPerBuffer;
+        if ((snd_pcm_hw_params_set_access (mHandle, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) ||
+            (snd_pcm_hw_params_set_format (mHandle, hwParams, SND_PCM_FORMAT_FLOAT) < 0) ||
+            (snd_pcm_hw_params_set_channels (mHandle, hwParams, numChannels) < 0) ||
+            (snd_pcm_hw_params_set_rate_near (mHandle, hwParams, &rate, 0) < 0) ||
+            (snd_pcm_hw_params_set_buffer_time_near (mHandle, hwParams, &bufferTime, 0) < 0) ||
+            (snd_pcm_hw_params_set_period_time_near (mHandle, hwParams, &periodTime, 0) < 0) ||
+            (snd_pcm_hw_params (mHandle, hwParams) < 0)) {
+          cLog::log (LOGERROR, fmt::format ("cAlsaStream mmap hw params failed"));
+          return;
+          }
+
+        snd_pcm_hw_params_get_period_size (hwParams, &mPeriodSize, 0);
+        //}}}
+        //{{{  sw params, wake per period, start by hand
+        snd_pcm_sw_params_t* swParams;
+        snd_pcm_sw_params_alloca (&swParams);
+        snd_pcm_sw_params_current (mHandle, swParams);
+        snd_pcm_sw_params_set_avail_min (mHandle, swParams, mPeriodSize);
+        snd_pcm_sw_params_set_start_threshold (mHandle, swParams, ~0u);
+        snd_pcm_sw_params (mHandle, swParams);
+        //}}}
+
+        cLog::log (LOGINFO, fmt::format ("cAlsaStream mmap rate:{} buffer:{}us period:{}", rate, bufferTime, mPeriodSize));
+
+        mOk = true;
+        mThread = thread ([=,this]() { run(); });
+        }
+      //}}}
+      //{{{
+      virtual ~cAlsaStream() {
+
+        mExit = true;
+        if (mThread.joinable())
+          mThread.join();
+
+        if (mHandle)
+          snd_pcm_close (mHandle);
+        }
+      //}}}
+
+      virtual string getName() const final { return "alsaMmap"; }
+
+    private:
+      //{{{
+      void run() {
+
+        cLog::setThreadName ("alsa");
+
+        //{{{  raise to max priority
+        sched_param schedParam;
+        schedParam.sched_priority = sched_get_priority_max (SCHED_RR);
+        pthread_setschedparam (pthread_self(), SCHED_RR, &schedParam);
+        //}}}
+
+        while (!mExit) {
+          snd_pcm_sframes_t avail = snd_pcm_avail_update (mHandle);
+          if (avail < 0) {
+            recover ((int)avail);
+            continue;
+            }
+
+          if (avail < (snd_pcm_sframes_t)mPeriodSize) {
+            snd_pcm_wait (mHandle, 100);
+            continue;
+            }
+
+          // fill device buffer in place
+          const snd_pcm_channel_area_t* areas;
+          snd_pcm_uframes_t offset;
+          snd_pcm_uframes_t frames = avail;
+          int err = snd_pcm_mmap_begin (mHandle, &areas, &offset, &frames);
+          if (err < 0) {
+            recover (err);
+            continue;
+            }
+
+          float* samples = (float*)((uint8_t*)areas[0].addr + (areas[0].first / 8) + (offset * (areas[0].step / 8)));
+          pull (samples, (int)frames);
+
+          snd_pcm_sframes_t committed = snd_pcm_mmap_commit (mHandle, offset, frames);
+          if ((committed < 0) || ((snd_pcm_uframes_t)committed != frames))
+            recover (committed < 0 ? (int)committed : -EPIPE);
+          else if (snd_pcm_state (mHandle) == SND_PCM_STATE_PREPARED)
+            // first buffer filled, or refilled after recover
+            snd_pcm_start (mHandle);
+
+          snd_pcm_sframes_t delay;
+          if (snd_pcm_delay (mHandle, &delay) == 0)
+            mDeviceLatencyUs = (delay * int64_t(1000000)) / mSampleRate;
+          }
+
+        snd_pcm_drop (mHandle);
+        }
+      //}}}
+      //{{{
+      void recover (int err) {
+
+        if (err == -EPIPE)
+          addUnderrun();
+
+        if (snd_pcm_recover (mHandle, err, 1) < 0)
+          cLog::log (LOGERROR, fmt::format ("cAlsaStream recover {}", snd_strerror (err)));
+        }
+      //}}}
+
+      snd_pcm_t* mHandle = nullptr;
+      snd_pcm_uframes_t mPeriodSize = 0;
+
+      atomic <bool> mExit = false;
+      thread mThread;
+      };
+    //}}}
+  #elif defined(USE_PULSE)
+    //{{{
+    class cPulseStream : public cAudioStream {
+    // pulseAudio async api, threaded mainloop requests bytes through writeCallback
+    public:
+      //{{{
+      cPulseStream (int numChannels, int sampleRate, int latencyUs)
+          : cAudioStream (numChannels, sampleRate, latencyUs) {
+
+        mSampleSpec = { PA_SAMPLE_FLOAT32, (uint32_t)sampleRate, (uint8_t)numChannels };
+
+        mMainloop = pa_threaded_mainloop_new();
+        mContext = pa_context_new (pa_threaded_mainloop_get_api (mMainloop), "mini");
+        pa_context_set_state_callback (mContext, contextStateCallback, this);
+
+        pa_threaded_mainloop_lock (mMainloop);
+        pa_threaded_mainloop_start (mMainloop);
+
+        if (pa_context_connect (mContext, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
+          cLog::log (LOGERROR, fmt::format ("cPulseStream connect {}", pa_strerror (pa_context_errno (mContext))));
+          pa_threaded_mainloop_unlock (mMainloop);
+          return;
+          }
+        //{{{  wait for context ready
+        while (true) {
+          pa_context_state_t state = pa_context_get_state (mContext);
+          if (state == PA_CONTEXT_READY)
+            break;
+          if (!PA_CONTEXT_IS_GOOD (state)) {
+            cLog::log (LOGERROR, fmt::format ("cPulseStream context failed"));
+            pa_threaded_mainloop_unlock (mMainloop);
+            return;
+            }
+          pa_threaded_mainloop_wait (mMainloop);
+          }
+        //}}}
+
+        mStream = pa_stream_new (mContext, "playback", &mSampleSpec, NULL);
+        pa_stream_set_state_callback (mStream, streamStateCallback, this);
+        pa_stream_set_write_callback (mStream, writeCallback, this);
+
+        // server side buffer half of target latency, rest in ring
+        pa_buffer_attr bufferAttr;
+        bufferAttr.maxlength = (uint32_t)-1;
+        bufferAttr.tlength = (uint32_t)pa_usec_to_bytes (latencyUs / 2, &mSampleSpec);
+        bufferAttr.prebuf = (uint32_t)-1;
+        bufferAttr.minreq = (uint32_t)pa_usec_to_bytes (latencyUs / 2 / kPeriodsPerBuffer, &mSampleSpec);
+        bufferAttr.fragsize = (uint32_t)-1;
+
+        pa_stream_flags_t flags = pa_stream_flags_t(PA_STREAM_ADJUST_LATENCY |
+                                                    PA_STREAM_INTERPOLATE_TIMING |
+                                                    PA_STREAM_AUTO_TIMING_UPDATE);
+        if (pa_stream_connect_playback (mStream, NULL, &bufferAttr, flags, NULL, NULL) < 0) {
+          cLog::log (LOGERROR, fmt::format ("cPulseStream connect_playback {}", pa_strerror (pa_context_errno (mContext))));
+          pa_threaded_mainloop_unlock (mMainloop);
+          return;
+          }
+        //{{{  wait for stream ready
+        while (true) {
+          pa_stream_state_t state = pa_stream_get_state (mStream);
+          if (state == PA_STREAM_READY)
+            break;
+          if (!PA_STREAM_IS_GOOD (state)) {
+            cLog::log (LOGERROR, fmt::format ("cPulseStream stream failed"));
+            pa_threaded_mainloop_unlock (mMainloop);
+            return;
+            }
+          pa_threaded_mainloop_wait (mMainloop);
+          }
+        //}}}
+
+        const pa_buffer_attr* attr = pa_stream_get_buffer_attr (mStream);
+        cLog::log (LOGINFO, fmt::format ("cPulseStream rate:{} tlength:{}us minreq:{}us",
+                                         sampleRate, pa_bytes_to_usec (attr->tlength, &mSampleSpec),
+                                         pa_bytes_to_usec (attr->minreq, &mSampleSpec)));
+
+        pa_threaded_mainloop_unlock (mMainloop);
+        mOk = true;
+        }
+      //}}}
+      //{{{
+      virtual ~cPulseStream() {
+
+        if (mMainloop)
+          pa_threaded_mainloop_stop (mMainloop);
+
+        if (mStream) {
+          pa_stream_disconnect (mStream);
+          pa_stream_unref (mStream);
+          }
+
+        if (mContext) {
+          pa_context_disconnect (mContext);
+          pa_context_unref (mContext);
+          }
+
+        if (mMainloop)
+          pa_threaded_mainloop_free (mMainloop);
+        }
+      //}}}
+
+      virtual string getName() const final { return "pulseAsync"; }
+
+    private:
+      //{{{
+      static void contextStateCallback (pa_context* context, void* userData) {
+        (void)context;
+        pa_threaded_mainloop_signal (((cPulseStream*)userData)->mMainloop, 0);
+        }
+      //}}}
+      //{{{
+      static void streamStateCallback (pa_stream* stream, void* userData) {
+        (void)stream;
+        pa_threaded_mainloop_signal (((cPulseStream*)userData)->mMainloop, 0);
+        }
+      //}}}
+      //{{{
+      static void writeCallback (pa_stream* stream, size_t numBytes, void* userData) {
+      // mainloop thread, fill requested bytes from ring, silence on underrun
+
+        cPulseStream* pulseStream = (cPulseStream*)userData;
+
+        void* data;
+        if (pa_stream_begin_write (stream, &data, &numBytes) < 0)
+          return;
+
+        size_t sampleBytes = pulseStream->getNumChannels() * sizeof(float);
+        pulseStream->pull ((float*)data, int(numBytes / sampleBytes));
+        pa_stream_write (stream, data, numBytes, NULL, 0, PA_SEEK_RELATIVE);
+
+        pa_usec_t latencyUs;
+        int negative;
+        if (pa_stream_get_latency (stream, &latencyUs, &negative) == 0)
+          pulseStream->mDeviceLatencyUs = negative ? 0 : (int64_t)latencyUs;
+        }
+      //}}}
+
+      pa_sample_spec mSampleSpec;
+      pa_threaded_mainloop* mMainloop = nullptr;
+      pa_context* mContext = nullptr;
+      pa_stream* mStream = nullptr;
+      };
+    //}}}
+  #else
+    //{{{
+    class cPulseSimpleStream : public cAudioStream {
+    // pulseAudio simple api, own thread pulls a period from ring, pa_simple_write blocks at device pace
+    public:
+      //{{{
+      cPulseSimpleStream (int numChannels, int sampleRate, int latencyUs)
+          : cAudioStream (numChannels, sampleRate, latencyUs) {
+
+        const pa_sample_spec kSampleSpec = { PA_SAMPLE_FLOAT32, (uint32_t)sampleRate, (uint8_t)numChannels };
+
+        // server side buffer half of target latency, rest in ring
+        pa_buffer_attr bufferAttr;
+        bufferAttr.maxlength = (uint32_t)-1;
+        bufferAttr.tlength = (uint32_t)pa_usec_to_bytes (latencyUs / 2, &kSampleSpec);
+        bufferAttr.prebuf = (uint32_t)-1;
+        bufferAttr.minreq = (uint32_t)-1;
+        bufferAttr.fragsize = (uint32_t)-1;
+
+        int error = 0;
+        mSimple = pa_simple_new (NULL, "mini", PA_STREAM_PLAYBACK, NULL, "playback",
+                                 &kSampleSpec, NULL, &bufferAttr, &error);
+        if (!mSimple) {
+          cLog::log (LOGERROR, fmt::format ("cPulseSimpleStream pa_simple_new {}", pa_strerror (error)));
+          return;
+          }
+
+        mPeriodSamples = max (1, (int)((int64_t(sampleRate) * latencyUs) / 2 / kPeriodsPerBuffer / 1000000));
+        cLog::log (LOGINFO, fmt::format ("cPulseSimpleStream rate:{} tlength:{}us period:{}",
+                                         sampleRate, latencyUs / 2, mPeriodSamples));
+
+        mOk = true;
+        mThread = thread ([=,this]() { run(); });
+        }
+      //}}}
+      //{{{
+      virtual ~cPulseSimpleStream() {
+
+        mExit = true;
+        if (mThread.joinable())
+          mThread.join();
+
+        if (mSimple)
+          pa_simple_free (mSimple);
+        }
+      //}}}
+
+      virtual string getName() const final { return "pulseSimple"; }
+
+    private:
+      //{{{
+      void run() {
+
+        cLog::setThreadName ("puls");
+
+        vector <float> samples (mPeriodSamples * getNumChannels());
+        while (!mExit) {
+          pull (samples.data(), mPeriodSamples);
+
+          int error = 0;
+          if (pa_simple_write (mSimple, samples.data(), samples.size() * sizeof(float), &error) < 0) {
+            cLog::log (LOGERROR, fmt::format ("cPulseSimpleStream pa_simple_write {}", pa_strerror (error)));
+            break;
+            }
+
+          pa_usec_t latencyUs = pa_simple_get_latency (mSimple, &error);
+          if (latencyUs != (pa_usec_t)-1)
+            mDeviceLatencyUs = (int64_t)latencyUs;
+          }
+        }
+      //}}}
+
+      pa_simple* mSimple = nullptr;
+      int mPeriodSamples = 0;
+
+      atomic <bool> mExit = false;
+      thread mThread;
+      };
+    //}}}
+  #endif
+
+  //{{{
+  class cNullStream : public cAudioStream {
+  // headless sink, own thread pulls a period at a time at the sampleRate, optionally to raw float file
+  public:
+    //{{{
+    cNullStream (int numChannels, int sampleRate, int latencyUs, const string& filename)
+        : cAudioStream (numChannels, sampleRate, latencyUs), mFilename(filename) {
+
+      if (!mFilename.empty()) {
+        mFile = fopen (mFilename.c_str(), "wb");
+        if (!mFile) {
+          cLog::log (LOGERROR, fmt::format ("cNullStream failed to open {}", mFilename));
+          return;
+          }
+        }
+
+      mPeriodSamples = max (1, (int)((int64_t(sampleRate) * latencyUs) / 2 / kPeriodsPerBuffer / 1000000));
+      mDeviceLatencyUs = latencyUs / 2;
+
+      mOk = true;
+      mThread = thread ([=,this]() { run(); });
+      }
+    //}}}
+    //{{{
+    virtual ~cNullStream() {
+
+      mExit = true;
+      if (mThread.joinable())
+        mThread.join();
+
+      if (mFile)
+        fclose (mFile);
+      }
+    //}}}
+
+    virtual string getName() const final { return mFile ? "file " + mFilename : "null"; }
+
+  private:
+    //{{{
+    void run() {
+
+      cLog::setThreadName ("null");
+
+      vector <float> samples (mPeriodSamples * getNumChannels());
+      auto periodDuration = chrono::microseconds ((int64_t(mPeriodSamples) * 1000000) / mSampleRate);
+
+      auto deadline = chrono::steady_clock::now();
+      while (!mExit) {
+        pull (samples.data(), mPeriodSamples);
+        if (mFile)
+          fwrite (samples.data(), sizeof(float), samples.size(), mFile);
+
+        deadline += periodDuration;
+        this_thread::sleep_until (deadline);
+        }
+      }
+    //}}}
+
+    const string mFilename;
+    FILE* mFile = nullptr;
+    int mPeriodSamples = 0;
+
+    atomic <bool> mExit = false;
+    thread mThread;
+    };
+  //}}}
+  }
+
+// cAudioStream
+//{{{
+cAudioStream* cAudioStream::create (const string& output, int numChannels, int sampleRate, int latencyUs) {
+
+  cAudioStream* audioStream;
+  if (output == "null")
+    audioStream = new cNullStream (numChannels, sampleRate, latencyUs, "");
+  else if (output.empty() || (output == "default"))
+    #if defined(ALSA)
+      audioStream = new cAlsaStream (numChannels, sampleRate, latencyUs);
+    #elif defined(USE_PULSE)
+      audioStream = new cPulseStream (numChannels, sampleRate, latencyUs);
+    #else
+      audioStream = new cPulseSimpleStream (numChannels, sampleRate, latencyUs);
+    #endif
+  else
+    audioStream = new cNullStream (numChannels, sampleRate, latencyUs, output);
+
+  cLog::log (LOGINFO, fmt::format ("cAudioStream {} {} channels:{} sampleRate:{} targetLatency:{}us",
+                                   audioStream->getName(), audioStream->isOk() ? "ok" : "failed",
+                                   numChannels, sampleRate, latencyUs));
+  return audioStream;
+  }
+//}}}
+//{{{
+cAudioStream::cAudioStream (int numChannels, int sampleRate, int latencyUs)
+  : mSampleRate(sampleRate), mTargetLatencyUs(latencyUs),
+    mRing (numChannels, (int)((int64_t(sampleRate) * latencyUs) / 2 / 1000000) + (2 * kMaxFrameSamples)) {
+  }
+//}}}
+
+//{{{
+string cAudioStream::getInfoString() const {
+  return fmt::format ("{} latency:{}ms device:{}ms target:{}ms underruns:{}",
+                      getName(), getLatencyUs() / 1000, getDeviceLatencyUs() / 1000,
+                      getTargetLatencyUs() / 1000, getUnderruns());
+  }
+//}}}
+
+//{{{
+bool cAudioStream::waitWrite (int numSamples, chrono::milliseconds timeout) {
+// player thread, wait for sink pulls till ring down to its half of target latency with room for numSamples
+
+  int ringTargetSamples = (int)((int64_t(mSampleRate) * mTargetLatencyUs) / 2 / 1000000);
+
+  unique_lock<mutex> lock (mPullMutex);
+  return mPullCondition.wait_for (lock, timeout, [&]() {
+    return (mRing.getReadAvailable() <= ringTargetSamples) && (mRing.getWriteAvailable() >= numSamples); });
+  }
+//}}}
+//{{{
+int cAudioStream::pull (float* samples, int numSamples) {
+// sink thread, read ring, silence and count underrun if short once player has started
+
+  int numRead = mRing.read (samples, numSamples);
+  if (numRead) {
+    mPrimed = true;
+
+    // wake waitWrite, lock orders read against its ring check
+    { unique_lock<mutex> lock (mPullMutex); }
+    mPullCondition.notify_one();
+    }
+
+  if (numRead < numSamples) {
+    memset (samples + (numRead * getNumChannels()), 0, (numSamples - numRead) * getNumChannels() * sizeof(float));
+    if (mPrimed)
+      mUnderruns++;
+    }
+
+  return numRead;
+  }
+//}}}
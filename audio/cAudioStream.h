@@ -0,0 +1,61 @@
+// cAudioStream.h - callback driven linux audio output, player fills lock free ring, sink pulls from it
+// - pulseAudio simple, pulseAudio async stream if USE_PULSE, alsa mmap if ALSA,
+// - null or raw float file sink for headless boxes
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include "cAudioRing.h"
+//}}}
+
+class cAudioStream {
+public:
+  // output "default" device, "null" sink, anything else a raw float file sink
+  static cAudioStream* create (const std::string& output, int numChannels, int sampleRate, int latencyUs);
+  virtual ~cAudioStream() = default;
+
+  // gets
+  virtual std::string getName() const = 0;
+  int getNumChannels() const { return mRing.getNumChannels(); }
+  int getSampleRate() const { return mSampleRate; }
+  int getTargetLatencyUs() const { return mTargetLatencyUs; }
+  int64_t getUnderruns() const { return mUnderruns; }
+  int64_t getDeviceLatencyUs() const { return mDeviceLatencyUs; }
+  int64_t getRingLatencyUs() const { return (mRing.getReadAvailable() * int64_t(1000000)) / mSampleRate; }
+  int64_t getLatencyUs() const { return getDeviceLatencyUs() + getRingLatencyUs(); }
+  std::string getInfoString() const;
+
+  // player
+  bool isOk() const { return mOk; }
+  int getWriteAvailable() const { return mRing.getWriteAvailable(); }
+  bool waitWrite (int numSamples, std::chrono::milliseconds timeout);
+  int write (const float* samples, int numSamples) { return mRing.write (samples, numSamples); }
+
+protected:
+  cAudioStream (int numChannels, int sampleRate, int latencyUs);
+
+  // sink
+  int pull (float* samples, int numSamples);
+  void addUnderrun() { mUnderruns++; }
+
+  const int mSampleRate;
+  const int mTargetLatencyUs;
+
+  bool mOk = false;
+  std::atomic <int64_t> mDeviceLatencyUs = 0;
+
+private:
+  cAudioRing mRing;
+
+  bool mPrimed = false;
+  std::atomic <int64_t> mUnderruns = 0;
+
+  // sink pull wakes player waitWrite
+  std::mutex mPullMutex;
+  std::condition_variable mPullCondition;
+  };
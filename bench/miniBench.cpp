@@ -0,0 +1,1128 @@
+// miniBench.cpp - headless micro benchmarks of the demux, decode, song, draw, loopback http and hls fetch hot paths
+//   miniBench [json|csv] [quick] [log1] [outFileName]
+//   - results are csv (default) or json, to stdout or outFileName, for comparing builds
+//{{{  includes
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "../common/basicTypes.h"
+#include "../common/cLog.h"
+#include "../fmt/include/fmt/format.h"
+
+// song
+#include "../song/cSong.h"
+#include "../song/cPidParser.h"
+#include "../song/cHlsRateSelector.h"
+
+#include "../gui/cTexture.h"
+#include "../gui/cDrawTexture.h"
+#include "../gui/cDrawAA.h"
+
+#include "../decoders/iAudioDecoder.h"
+#include "../decoders/cFFmpegAudioDecoder.h"
+#include "../decoders/lodepng.h"
+
+#ifndef _WIN32
+  #include <unistd.h>
+  #include <sys/socket.h>
+  #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <arpa/inet.h>
+
+  #include "../net/cDnsCache.h"
+  #include "../net/cHttp.h"
+  #include "../net/cHttpEngine.h"
+  #include "../song/cHlsFetcher.h"
+#endif
+
+//{{{  include libav
+#ifdef _WIN32
+  #pragma warning (push)
+  #pragma warning (disable: 4244)
+#endif
+
+extern "C" {
+  #include <libavcodec/avcodec.h>
+  #include <libavutil/channel_layout.h>
+  }
+
+#ifdef _WIN32
+  #pragma warning (pop)
+#endif
+//}}}
+
+using namespace std;
+using namespace chrono;
+//}}}
+
+//{{{
+class cBench {
+public:
+  cBench (bool quick) : mMinRepeatTime(quick ? 20ms : 200ms), mNumRepeats(quick ? 3 : 7) {}
+
+  //{{{
+  void run (const string& name, const string& unit, double unitsPerIteration, const function <void()>& iteration) {
+  // warm up, calibrate iterations to mMinRepeatTime, time mNumRepeats batches, keep min,median,max
+
+    iteration();
+
+    int64_t numIterations = 1;
+    while (true) {
+      int64_t ns = timeIterations (numIterations, iteration);
+      if ((ns >= duration_cast<nanoseconds>(mMinRepeatTime).count()) || (numIterations >= (1 << 24)))
+        break;
+      numIterations *= 2;
+      }
+
+    vector <double> nsPerIteration;
+    for (int repeat = 0; repeat < mNumRepeats; repeat++)
+      nsPerIteration.push_back (double(timeIterations (numIterations, iteration)) / numIterations);
+    sort (nsPerIteration.begin(), nsPerIteration.end());
+
+    cResult result = { name, unit, unitsPerIteration, numIterations,
+                       nsPerIteration.front(), nsPerIteration[nsPerIteration.size() / 2], nsPerIteration.back() };
+    mResults.push_back (result);
+
+    cLog::log (LOGINFO, fmt::format ("{:12} {:8} iterations {:12.1f}ns median {:12.1f} {}/s",
+                                     name, numIterations, result.mMedianNs, result.getUnitsPerSecond(), unit));
+    }
+  //}}}
+
+  //{{{
+  string getCsv() const {
+
+    string csv = "name,unit,unitsPerIteration,iterations,repeats,minNs,medianNs,maxNs,unitsPerSecond\n";
+    for (auto& result : mResults)
+      csv += fmt::format ("{},{},{},{},{},{:.1f},{:.1f},{:.1f},{:.1f}\n",
+                          result.mName, result.mUnit, result.mUnitsPerIteration, result.mIterations, mNumRepeats,
+                          result.mMinNs, result.mMedianNs, result.mMaxNs, result.getUnitsPerSecond());
+    return csv;
+    }
+  //}}}
+  //{{{
+  string getJson() const {
+
+    string json = "[\n";
+    for (auto& result : mResults)
+      json += fmt::format ("  {{\"name\":\"{}\", \"unit\":\"{}\", \"unitsPerIteration\":{}, \"iterations\":{}, "
+                           "\"repeats\":{}, \"minNs\":{:.1f}, \"medianNs\":{:.1f}, \"maxNs\":{:.1f}, "
+                           "\"unitsPerSecond\":{:.1f}}}{}\n",
+                           result.mName, result.mUnit, result.mUnitsPerIteration, result.mIterations,
+                           mNumRepeats, result.mMinNs, result.mMedianNs, result.mMaxNs, result.getUnitsPerSecond(),
+                           &result == &mResults.back() ? "" : ",");
+    return json + "]\n";
+    }
+  //}}}
+
+private:
+  //{{{
+  class cResult {
+  public:
+    double getUnitsPerSecond() const { return mMedianNs > 0.0 ? (mUnitsPerIteration * 1e9) / mMedianNs : 0.0; }
+
+    string mName;
+    string mUnit;
+    double mUnitsPerIteration;
+    int64_t mIterations;
+
+    double mMinNs;
+    double mMedianNs;
+    double mMaxNs;
+    };
+  //}}}
+  //{{{
+  static int64_t timeIterations (int64_t numIterations, const function <void()>& iteration) {
+
+    auto startTime = steady_clock::now();
+    for (int64_t i = 0; i < numIterations; i++)
+      iteration();
+    return duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+    }
+  //}}}
+
+  const milliseconds mMinRepeatTime;
+  const int mNumRepeats;
+
+  vector <cResult> mResults;
+  };
+//}}}
+
+// demux
+//{{{
+class cBenchPesParser : public cPesParser {
+// count pes decoded, no queue, no decoder
+public:
+  cBenchPesParser (int pid) : cPesParser (pid, "bench", false) {}
+  virtual ~cBenchPesParser() = default;
+
+  int64_t getNumPes() const { return mNumPes; }
+  int64_t getNumPesBytes() const { return mNumPesBytes; }
+
+protected:
+  //{{{
+  virtual void decode (bool reuseFromFront, uint8_t* pes, int size, int64_t pts, int64_t dts) final {
+
+    (void)reuseFromFront;
+    (void)pes;
+    (void)pts;
+    (void)dts;
+
+    mNumPes++;
+    mNumPesBytes += size;
+    }
+  //}}}
+
+private:
+  int64_t mNumPes = 0;
+  int64_t mNumPesBytes = 0;
+  };
+//}}}
+//{{{
+vector <uint8_t> createTs (int pid, int numPackets, int packetsPerPes) {
+// synthetic single pid ts, pes with pts every packetsPerPes packets, continuity count wraps with numPackets % 16
+
+  vector <uint8_t> ts (numPackets * 188);
+
+  int64_t pts = 0;
+  for (int packet = 0; packet < numPackets; packet++) {
+    uint8_t* tsPtr = ts.data() + (packet * 188);
+    bool payloadStart = (packet % packetsPerPes) == 0;
+
+    *tsPtr++ = 0x47;
+    *tsPtr++ = (payloadStart ? 0x40 : 0x00) | ((pid >> 8) & 0x1F);
+    *tsPtr++ = pid & 0xFF;
+    *tsPtr++ = 0x10 | (packet & 0x0F);
+
+    if (payloadStart) {
+      //{{{  pes header, video stream, no packet length, dataAlignmentIndicator, pts
+      *tsPtr++ = 0x00;
+      *tsPtr++ = 0x00;
+      *tsPtr++ = 0x01;
+      *tsPtr++ = 0xE0;
+      *tsPtr++ = 0x00;
+      *tsPtr++ = 0x00;
+      *tsPtr++ = 0x84;
+      *tsPtr++ = 0x80;
+      *tsPtr++ = 0x05;
+
+      *tsPtr++ = uint8_t(0x21 | ((pts >> 29) & 0x0E));
+      *tsPtr++ = uint8_t(pts >> 22);
+      *tsPtr++ = uint8_t(((pts >> 14) & 0xFE) | 0x01);
+      *tsPtr++ = uint8_t(pts >> 7);
+      *tsPtr++ = uint8_t(((pts << 1) & 0xFE) | 0x01);
+
+      pts += 3600;
+      }
+      //}}}
+
+    uint8_t value = uint8_t(packet);
+    while (tsPtr < ts.data() + ((packet+1) * 188))
+      *tsPtr++ = value++;
+    }
+
+  return ts;
+  }
+//}}}
+//{{{
+void benchTsParse (cBench& bench) {
+
+  constexpr int kPid = 0x100;
+  constexpr int kNumPackets = 4096;
+
+  vector <uint8_t> ts = createTs (kPid, kNumPackets, 32);
+  cBenchPesParser pesParser (kPid);
+
+  bench.run ("tsParse", "MB", (kNumPackets * 188) / 1e6, [&]() {
+    for (uint8_t* tsPtr = ts.data(); tsPtr < ts.data() + ts.size(); tsPtr += 188)
+      if ((*tsPtr == 0x47) && ((((tsPtr[1] & 0x1F) << 8) | tsPtr[2]) == kPid))
+        pesParser.parse (tsPtr, true);
+    });
+
+  cLog::log (LOGINFO, fmt::format ("tsParse pes:{} bytes:{}", pesParser.getNumPes(), pesParser.getNumPesBytes()));
+  }
+//}}}
+
+// song
+//{{{
+vector <float> createSamples (int numChannels, int samplesPerFrame) {
+// interleaved sine per channel with a little noise
+
+  vector <float> samples (samplesPerFrame * numChannels);
+  uint32_t noise = 1;
+  for (int sample = 0; sample < samplesPerFrame; sample++)
+    for (int channel = 0; channel < numChannels; channel++) {
+      noise = (noise * 1664525) + 1013904223;
+      samples[(sample * numChannels) + channel] = (0.5f * sinf (sample * (channel + 1) * 0.05f)) +
+                                                  (((noise >> 16) / 65536.f) - 0.5f) * 0.1f;
+      }
+
+  return samples;
+  }
+//}}}
+//{{{
+void benchSongAddFrame (cBench& bench) {
+// addFrame path only, power,peak,silence, spectrum is queued to its worker
+
+  constexpr int kNumChannels = 2;
+  constexpr int kSampleRate = 48000;
+  constexpr int kSamplesPerFrame = 1024;
+  constexpr int64_t kFramePtsDuration = (kSamplesPerFrame * 90000) / kSampleRate;
+
+  // copied into each frame's owned samples
+  vector <float> samples = createSamples (kNumChannels, kSamplesPerFrame);
+
+  cPtsSong song (eAudioFrameType::eAacAdts, kNumChannels, kSampleRate, kSamplesPerFrame, kFramePtsDuration, 1000);
+
+  cLog::log (LOGINFO, fmt::format ("songAddFrame powerPeak kernel:{}", cSong::getPowerPeakKernelName()));
+
+  int64_t pts = 0;
+  bench.run ("songAddFrame", "frames", 1.0, [&]() {
+    song.copyFrame (true, pts, samples.data(), (pts / kFramePtsDuration) + 1);
+    pts += kFramePtsDuration;
+    });
+  }
+//}}}
+//{{{
+void benchSongSpectrum (cBench& bench) {
+// add a batch of frames, wait for spectrum worker to fft them all
+
+  constexpr int kNumChannels = 2;
+  constexpr int kSampleRate = 48000;
+  constexpr int kSamplesPerFrame = 1024;
+  constexpr int64_t kFramePtsDuration = (kSamplesPerFrame * 90000) / kSampleRate;
+  constexpr int kBatchFrames = 64;
+
+  vector <float> samples = createSamples (kNumChannels, kSamplesPerFrame);
+
+  cPtsSong song (eAudioFrameType::eAacAdts, kNumChannels, kSampleRate, kSamplesPerFrame, kFramePtsDuration, 1000);
+
+  int64_t frameNum = 0;
+  bench.run ("songSpectrum", "frames", kBatchFrames, [&]() {
+    int64_t firstFrameNum = frameNum;
+    for (int i = 0; i < kBatchFrames; i++, frameNum++)
+      song.copyFrame (true, frameNum * kFramePtsDuration, samples.data(), frameNum + 1);
+
+    for (int64_t waitFrameNum = firstFrameNum; waitFrameNum < frameNum; waitFrameNum++)
+      while (!song.isFreqReady (waitFrameNum))
+        this_thread::yield();
+    });
+  }
+//}}}
+
+//{{{
+bool checkHlsRateSelector() {
+// synthetic segment downloads at a set throughput, buffer as if fetch keeps up
+// - climbs one rate at a time, holding between switches, to top rate on a fast link
+// - only steps down, to lowest rate, when link collapses below second rate
+// - fixed and non variant rates never switch
+
+  const vector <int> kRates = { 827008, 1604032, 2812032, 5070016 };
+  constexpr int kAudioRate = 128000;
+  constexpr float kChunkSeconds = 6.4f;
+  constexpr int kHoldSegments = 3;
+
+  // download one chunk at rate over a link of throughput, select for next, return true if switched
+  auto segment = [&](cHlsRateSelector& rateSelector, float throughput, float bufferSeconds) {
+    int contentSize = int((rateSelector.getRate() + kAudioRate) * kChunkSeconds / 8.f);
+    rateSelector.addSegment (contentSize, int64_t(contentSize * 8.f * 1000000.f / throughput));
+    return rateSelector.select (bufferSeconds, kChunkSeconds);
+    };
+
+  bool ok = true;
+
+  // fast link, climb
+  cHlsRateSelector rateSelector (kRates, kRates.front(), kAudioRate, true);
+  int sinceSwitch = 0;
+  for (int i = 0; i < 30; i++, sinceSwitch++)
+    if (segment (rateSelector, 20e6f, 2 * kChunkSeconds)) {
+      if (sinceSwitch + 1 < kHoldSegments) {
+        cLog::log (LOGERROR, fmt::format ("hlsRateSelector switched up after {} segments", sinceSwitch + 1));
+        ok = false;
+        }
+      sinceSwitch = -1;
+      }
+  if ((rateSelector.getRate() != kRates.back()) || (rateSelector.getNumSwitches() != (int)kRates.size() - 1)) {
+    cLog::log (LOGERROR, fmt::format ("hlsRateSelector climb rate:{} switches:{}",
+                                      rateSelector.getRate(), rateSelector.getNumSwitches()));
+    ok = false;
+    }
+
+  // link collapses below second rate, only ever steps down, lowest rate once fast average has fallen
+  int lastRate = rateSelector.getRate();
+  for (int i = 0; i < 8; i++) {
+    segment (rateSelector, 1e6f, kChunkSeconds);
+    if (rateSelector.getRate() > lastRate) {
+      cLog::log (LOGERROR, fmt::format ("hlsRateSelector collapse stepped up to {}", rateSelector.getRate()));
+      ok = false;
+      }
+    lastRate = rateSelector.getRate();
+    }
+  if (rateSelector.getRate() != kRates.front()) {
+    cLog::log (LOGERROR, fmt::format ("hlsRateSelector collapse rate:{}", rateSelector.getRate()));
+    ok = false;
+    }
+
+  // fixed rate, and a rate that is not a variant, stay put
+  cHlsRateSelector fixedSelector (kRates, kRates.front(), kAudioRate, false);
+  cHlsRateSelector pinnedSelector (kRates, 1000000, kAudioRate, true);
+  for (int i = 0; i < 10; i++) {
+    segment (fixedSelector, 20e6f, 2 * kChunkSeconds);
+    segment (pinnedSelector, 20e6f, 2 * kChunkSeconds);
+    }
+  if ((fixedSelector.getRate() != kRates.front()) || (pinnedSelector.getRate() != 1000000)) {
+    cLog::log (LOGERROR, fmt::format ("hlsRateSelector fixed rate:{} pinned rate:{}",
+                                      fixedSelector.getRate(), pinnedSelector.getRate()));
+    ok = false;
+    }
+
+  return ok;
+  }
+//}}}
+
+// decode
+//{{{
+vector <vector <uint8_t>> createAacAdtsFrames (int numFrames) {
+// encode stereo 48khz sine with libav aac encoder, wrap each packet in adts header
+
+  vector <vector <uint8_t>> frames;
+
+  const AVCodec* codec = avcodec_find_encoder (AV_CODEC_ID_AAC);
+  if (!codec) {
+    cLog::log (LOGERROR, "no aac encoder");
+    return frames;
+    }
+
+  AVCodecContext* context = avcodec_alloc_context3 (codec);
+  context->sample_fmt = AV_SAMPLE_FMT_FLTP;
+  context->sample_rate = 48000;
+  context->bit_rate = 128000;
+  av_channel_layout_default (&context->ch_layout, 2);
+  if (avcodec_open2 (context, codec, NULL) < 0) {
+    //{{{  error, return
+    cLog::log (LOGERROR, "failed to open aac encoder");
+    avcodec_free_context (&context);
+    return frames;
+    }
+    //}}}
+
+  AVFrame* avFrame = av_frame_alloc();
+  avFrame->nb_samples = context->frame_size;
+  avFrame->format = context->sample_fmt;
+  avFrame->sample_rate = context->sample_rate;
+  av_channel_layout_copy (&avFrame->ch_layout, &context->ch_layout);
+  av_frame_get_buffer (avFrame, 0);
+
+  AVPacket* avPacket = av_packet_alloc();
+
+  int64_t sampleNum = 0;
+  for (int frame = 0; frame <= numFrames; frame++) {
+    // last pass flushes encoder
+    if (frame < numFrames) {
+      av_frame_make_writable (avFrame);
+      for (int channel = 0; channel < 2; channel++) {
+        float* samples = (float*)avFrame->data[channel];
+        for (int sample = 0; sample < avFrame->nb_samples; sample++)
+          samples[sample] = 0.5f * sinf ((sampleNum + sample) * (channel + 1) * 0.05f);
+        }
+      avFrame->pts = sampleNum;
+      sampleNum += avFrame->nb_samples;
+      }
+
+    int ret = avcodec_send_frame (context, frame < numFrames ? avFrame : NULL);
+    while (ret >= 0) {
+      ret = avcodec_receive_packet (context, avPacket);
+      if (ret < 0)
+        break;
+
+      //{{{  adts header, aac lc, 48khz, stereo
+      int frameLength = avPacket->size + 7;
+
+      vector <uint8_t> adtsFrame (frameLength);
+      adtsFrame[0] = 0xFF;
+      adtsFrame[1] = 0xF1;
+      adtsFrame[2] = (1 << 6) | (3 << 2);
+      adtsFrame[3] = uint8_t((2 << 6) | (frameLength >> 11));
+      adtsFrame[4] = uint8_t(frameLength >> 3);
+      adtsFrame[5] = uint8_t(((frameLength & 7) << 5) | 0x1F);
+      adtsFrame[6] = 0xFC;
+      memcpy (adtsFrame.data() + 7, avPacket->data, avPacket->size);
+      //}}}
+      frames.push_back (adtsFrame);
+      av_packet_unref (avPacket);
+      }
+    }
+
+  av_packet_free (&avPacket);
+  av_frame_free (&avFrame);
+  avcodec_free_context (&context);
+
+  return frames;
+  }
+//}}}
+//{{{
+void benchAacDecode (cBench& bench) {
+
+  vector <vector <uint8_t>> frames = createAacAdtsFrames (256);
+  if (frames.empty())
+    return;
+
+  cFFmpegAudioDecoder decoder (eAudioFrameType::eAacAdts);
+
+  // decode into one reused buffer
+  vector <float> samples;
+  size_t frameIndex = 0;
+  bench.run ("aacDecode", "frames", 1.0, [&]() {
+    auto& frame = frames[frameIndex++ % frames.size()];
+    decoder.decodeFrame (frame.data(), (int)frame.size(), int64_t(frameIndex) * 1920,
+                         [&](int numChannels, int numSamples) noexcept {
+                           samples.resize (numChannels * numSamples);
+                           return samples.data();
+                           });
+    });
+
+  // decode straight into song frame records, power,peak,silence, as the loaders add frames
+  cFFmpegAudioDecoder songDecoder (eAudioFrameType::eAacAdts);
+  cPtsSong song (eAudioFrameType::eAacAdts, 2, 48000, 1024, 1920, 1000);
+  int64_t pts = 0;
+  bench.run ("aacDecodeSong", "frames", 1.0, [&]() {
+    auto& frame = frames[frameIndex++ % frames.size()];
+    song.decodeFrame (&songDecoder, true, frame.data(), (int)frame.size(), pts, (pts / 1920) + 1);
+    pts += 1920;
+    });
+  }
+//}}}
+//{{{
+void benchPngDecode (cBench& bench) {
+// 256x256 rgba map like tile, lodepng encoded, decoded as tiledMap does
+
+  constexpr uint32_t kTileSize = 256;
+
+  vector <uint8_t> pixels (kTileSize * kTileSize * 4);
+  for (uint32_t y = 0; y < kTileSize; y++)
+    for (uint32_t x = 0; x < kTileSize; x++) {
+      uint8_t* pixel = pixels.data() + (((y * kTileSize) + x) * 4);
+      bool road = ((x / 8) % 9 == 0) || ((y / 8) % 7 == 0);
+      pixel[0] = road ? 0xF0 : uint8_t(0x80 + (x ^ y) % 0x20);
+      pixel[1] = road ? 0xE0 : uint8_t(0xA0 + (x * y) % 0x18);
+      pixel[2] = road ? 0xB0 : 0x70;
+      pixel[3] = 0xFF;
+      }
+
+  unsigned char* png = nullptr;
+  size_t pngSize = 0;
+  if (lodepng_encode32 (&png, &pngSize, pixels.data(), kTileSize, kTileSize)) {
+    cLog::log (LOGERROR, "lodepng encode failed");
+    return;
+    }
+
+  bench.run ("pngDecode", "tiles", 1.0, [&]() {
+    cTexture texture = cTexture::createDecode (png, (uint32_t)pngSize);
+    texture.release();
+    });
+
+  free (png);
+  }
+//}}}
+
+// draw
+//{{{
+void benchDrawAA (cBench& bench) {
+// 64 point star polygon, nonZero fill, coverage summed by stamp callback
+
+  constexpr int kNumPoints = 64;
+
+  cDrawAA drawAA;
+  uint64_t coverage = 0;
+
+  bench.run ("drawAA", "polygons", 1.0, [&]() {
+    for (int point = 0; point <= kNumPoints; point++) {
+      float radians = point * 2.f * kPi / kNumPoints;
+      float radius = (point & 1) ? 200.f : 480.f;
+      cPoint edge (512.f + (cos (radians) * radius), 512.f + (sin (radians) * radius));
+      if (point == 0)
+        drawAA.addEdgeFrom (edge);
+      else
+        drawAA.addEdgeTo (edge);
+      }
+
+    drawAA.draw (1024, 1024, true, [&](uint8_t* src, int32_t dstx, int32_t dsty, uint32_t numPixels) {
+      (void)dstx;
+      (void)dsty;
+      for (uint32_t i = 0; i < numPixels; i++)
+        coverage += src[i];
+      });
+    });
+
+  cLog::log (LOGINFO, fmt::format ("drawAA coverage:{}", coverage));
+  }
+//}}}
+//{{{
+void benchTexture (cBench& bench) {
+
+  constexpr int32_t kWidth = 1920;
+  constexpr int32_t kHeight = 1080;
+  constexpr int32_t kSrcSize = 256;
+
+  cTexture dstTexture;
+  dstTexture.createPixels (kWidth, kHeight);
+  dstTexture.clear (kBlack);
+
+  cTexture srcTexture;
+  srcTexture.createPixels (kSrcSize, kSrcSize);
+  for (int32_t y = 0; y < kSrcSize; y++)
+    for (int32_t x = 0; x < kSrcSize; x++)
+      srcTexture.getPixels (x, y)->pixel = 0xFF000000 | (y << 16) | (x << 8) | ((x ^ y) & 0xFF);
+
+  cAlphaTexture alphaTexture;
+  alphaTexture.createPixels (kSrcSize, kSrcSize);
+  for (int32_t y = 0; y < kSrcSize; y++)
+    for (int32_t x = 0; x < kSrcSize; x++)
+      *alphaTexture.getPixels (x, y) = uint8_t((x + y) / 2);
+
+  // walk dst positions, partly offscreen to exercise clipping
+  int position = 0;
+  auto nextPoint = [&]() {
+    position++;
+    return cPoint (float(((position * 397) % (kWidth + kSrcSize)) - (kSrcSize / 2)),
+                   float(((position * 211) % (kHeight + kSrcSize)) - (kSrcSize / 2)));
+    };
+
+  bench.run ("blit", "Mpixels", (kSrcSize * kSrcSize) / 1e6, [&]() {
+    cPoint point = nextPoint();
+    dstTexture.blit (srcTexture, cRect (point, point + cPoint (kSrcSize, kSrcSize)));
+    });
+
+  bench.run ("blitSize", "Mpixels", (kSrcSize * 2 * kSrcSize * 2) / 1e6, [&]() {
+    cPoint point = nextPoint();
+    dstTexture.blitSize (srcTexture, cRect (point, point + cPoint (kSrcSize * 2, kSrcSize * 2)));
+    });
+
+  bench.run ("stamp", "Mpixels", (kSrcSize * kSrcSize) / 1e6, [&]() {
+    dstTexture.stamp (kOrange, alphaTexture, nextPoint());
+    });
+
+  alphaTexture.release();
+  srcTexture.release();
+  dstTexture.release();
+  }
+//}}}
+//{{{
+void benchDrawText (cBench& bench) {
+
+  cDrawTexture::createStaticResources (20.f);
+
+  cDrawTexture dstTexture;
+  dstTexture.createPixels (1920, 1080);
+  dstTexture.clear (kBlack);
+
+  const string text = "The quick brown fox jumps over the lazy dog 0123456789 {}[]()";
+
+  int line = 0;
+  bench.run ("drawText", "chars", (double)text.size(), [&]() {
+    float y = float((line++ % 50) * 20);
+    dstTexture.drawText (kWhite, cRect (0.f, y, 1920.f, y + 20.f), text);
+    });
+
+  dstTexture.release();
+  }
+//}}}
+
+#ifndef _WIN32
+// net
+//{{{
+class cBenchHttpServer {
+// loopback keep-alive http/1.1 server, header and body in one send, optional response delay as rtt
+// - fixed body, or body of request path from bodyCallback, canned hls m3u8 and segments
+// - each response sent at its request arrival plus delay, in order, so pipelined requests overlap their rtt
+// - logs connection,path of every request, optionally closes a connection abruptly after closeAfter responses
+public:
+  cBenchHttpServer (int bodySize, int delayMs)
+    : cBenchHttpServer (delayMs, [body = string (bodySize, 'x')](const string& path) { (void)path; return body; }) {}
+  //{{{
+  cBenchHttpServer (int delayMs, const function <string (const string& path)>& bodyCallback, int closeAfter = 0)
+      : mDelayMs(delayMs), mBodyCallback(bodyCallback), mCloseAfter(closeAfter) {
+
+    mListenSocket = socket (AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    address.sin_port = 0;
+    bind (mListenSocket, (sockaddr*)&address, sizeof(address));
+    listen (mListenSocket, 64);
+
+    socklen_t length = sizeof(address);
+    getsockname (mListenSocket, (sockaddr*)&address, &length);
+    mPort = ntohs (address.sin_port);
+
+    mAcceptThread = thread ([=,this]() {
+      while (true) {
+        int sock = accept (mListenSocket, nullptr, nullptr);
+        if (sock < 0)
+          break;
+
+        int noDelay = 1;
+        setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        unique_lock<mutex> lock (mMutex);
+        int connection = (int)mSockets.size();
+        mSockets.push_back (sock);
+        mThreads.push_back (thread ([=,this]() { serve (sock, connection); }));
+        }
+      });
+    }
+  //}}}
+  //{{{
+  ~cBenchHttpServer() {
+
+    shutdown (mListenSocket, SHUT_RDWR);
+    mAcceptThread.join();
+    close (mListenSocket);
+
+    for (auto sock : mSockets)
+      shutdown (sock, SHUT_RDWR);
+    for (auto& serveThread : mThreads)
+      serveThread.join();
+    for (auto sock : mSockets)
+      close (sock);
+    }
+  //}}}
+
+  string getHost() const { return fmt::format ("127.0.0.1:{}", mPort); }
+  //{{{
+  vector <pair <int,string>> getRequests() {
+  // connection,path of each request, in arrival order
+
+    unique_lock<mutex> lock (mMutex);
+    return mRequests;
+    }
+  //}}}
+
+private:
+  //{{{
+  void serve (int sock, int connection) {
+  // parse requests, ended by blank line, queue response due at arrival plus delay to this connection's writer
+
+    mutex responseMutex;
+    condition_variable responseCondition;
+    deque <pair <steady_clock::time_point,string>> responses;
+    bool exit = false;
+
+    thread writeThread ([&]() {
+      int numResponses = 0;
+      while (true) {
+        pair <steady_clock::time_point,string> response;
+        {
+        unique_lock<mutex> lock (responseMutex);
+        responseCondition.wait (lock, [&]() { return exit || !responses.empty(); });
+        if (exit)
+          return;
+        response = move (responses.front());
+        responses.pop_front();
+        }
+
+        this_thread::sleep_until (response.first);
+        if (send (sock, response.second.data(), response.second.size(), MSG_NOSIGNAL) < 0)
+          return;
+
+        if (mCloseAfter && (++numResponses == mCloseAfter)) {
+          // abrupt close, no connection: close, requests in flight go unanswered
+          shutdown (sock, SHUT_RDWR);
+          return;
+          }
+        }
+      });
+
+    char buffer[4096];
+    string request;
+    while (true) {
+      ssize_t bytesReceived = recv (sock, buffer, sizeof(buffer), 0);
+      if (bytesReceived <= 0)
+        break;
+      auto arrival = steady_clock::now();
+
+      request.append (buffer, bytesReceived);
+      size_t end;
+      while ((end = request.find ("\r\n\r\n")) != string::npos) {
+        // GET /path HTTP/1.1
+        size_t pathBegin = request.find (' ') + 1;
+        string path = request.substr (pathBegin, request.find (' ', pathBegin) - pathBegin);
+        request.erase (0, end + 4);
+
+        {
+        unique_lock<mutex> lock (mMutex);
+        mRequests.push_back ({connection, path});
+        }
+
+        string body = mBodyCallback (path);
+        unique_lock<mutex> lock (responseMutex);
+        responses.push_back ({arrival + milliseconds (mDelayMs),
+                              fmt::format ("HTTP/1.1 200 OK\r\nContent-Length: {}\r\n\r\n", body.size()) + body});
+        responseCondition.notify_one();
+        }
+      }
+
+    {
+    unique_lock<mutex> lock (responseMutex);
+    exit = true;
+    responseCondition.notify_one();
+    }
+    writeThread.join();
+    }
+  //}}}
+
+  const int mDelayMs;
+  const function <string (const string& path)> mBodyCallback;
+  const int mCloseAfter;
+
+  int mListenSocket = -1;
+  uint16_t mPort = 0;
+  thread mAcceptThread;
+
+  mutex mMutex;
+  vector <int> mSockets;
+  vector <thread> mThreads;
+  vector <pair <int,string>> mRequests;
+  };
+//}}}
+//{{{
+void benchHttp (cBench& bench) {
+// blocking cHttp, one keep-alive connection, pipelined 8 deep on one connection,
+// against cHttpEngine, concurrent gets on up to 8 connections
+
+  constexpr int kNumGets = 64;
+  constexpr int kBodySize = 16 * 1024;
+
+  for (int delayMs : { 0, 1 }) {
+    cBenchHttpServer server (kBodySize, delayMs);
+    string host = server.getHost();
+    string suffix = delayMs ? "Rtt" : "";
+
+    cHttp http;
+    int64_t numBytes = 0;
+    bench.run ("httpGet" + suffix, "requests", kNumGets, [&]() {
+      for (int i = 0; i < kNumGets; i++)
+        if (http.get (host, "tile") == 200)
+          numBytes += http.getContentSize();
+      });
+
+    vector <string> paths (kNumGets, "tile");
+    bench.run ("httpPipelined" + suffix, "requests", kNumGets, [&]() {
+      http.getPipelined (host, paths, 8, [&](size_t index, int response) {
+        (void)index;
+        if (response == 200)
+          numBytes += http.getContentSize();
+        });
+      });
+
+    cHttpEngine engine (8);
+    mutex doneMutex;
+    condition_variable doneCondition;
+    bench.run ("httpEngine" + suffix, "requests", kNumGets, [&]() {
+      int numDone = 0;
+      for (int i = 0; i < kNumGets; i++)
+        engine.get (host, "tile", "", 5000ms, [&](int response, const uint8_t* content, int contentSize) {
+          (void)content;
+          unique_lock<mutex> lock (doneMutex);
+          if (response == 200)
+            numBytes += contentSize;
+          if (++numDone == kNumGets)
+            doneCondition.notify_one();
+          });
+
+      unique_lock<mutex> lock (doneMutex);
+      doneCondition.wait (lock, [&]() { return numDone == kNumGets; });
+      });
+
+    cLog::log (LOGINFO, fmt::format ("http{} bytes:{} {}", suffix, numBytes, engine.getInfoString()));
+    }
+  }
+//}}}
+//{{{
+bool checkDnsCache() {
+// offline, address literals and an injected hosts table, no resolver
+// - second resolve is a hit, concurrent resolves of one cold host cost one miss, failed lookup cached
+
+  constexpr int kNumThreads = 8;
+
+  bool ok = true;
+  auto check = [&](bool pass, const string& what) {
+    if (!pass) {
+      cLog::log (LOGERROR, fmt::format ("dnsCache {} - {}", what, cDnsCache::getInfoString()));
+      ok = false;
+      }
+    };
+
+  cDnsCache::clear();
+  cDnsCache::setHostsTable ({ { "bench.host", { "127.0.0.2" } },
+                              { "bench.cold", { "127.0.0.3", "::1" } },
+                              { "bench.fail", { "not.a.literal" } } });
+
+  // literals and hosts table name, port set per resolve, second resolve a hit
+  for (auto& [hostName, expected] : vector <pair <string,string>> {
+                                      { "127.0.0.1", "127.0.0.1:80" },
+                                      { "[::1]", "[::1]:80" },
+                                      { "bench.host", "127.0.0.2:80" } }) {
+    vector <cDnsCache::cAddress> addresses;
+    int64_t misses = cDnsCache::getMisses();
+    bool resolved = cDnsCache::resolve (hostName, 80, addresses);
+    check (resolved && (addresses.size() == 1) && (addresses.front().getString() == expected) &&
+           (cDnsCache::getMisses() == misses + 1), hostName + " resolve");
+
+    int64_t hits = cDnsCache::getHits();
+    resolved = cDnsCache::resolve (hostName, 8080, addresses);
+    check (resolved && (addresses.size() == 1) && (cDnsCache::getHits() == hits + 1) &&
+           (cDnsCache::getMisses() == misses + 1) && (addresses.front().getString().ends_with (":8080")),
+           hostName + " second resolve hit");
+    }
+
+  // threads released together on a cold host, one looks up, rest wait for it or hit
+  int64_t misses = cDnsCache::getMisses();
+  int64_t hitsWaits = cDnsCache::getHits() + cDnsCache::getWaits();
+  atomic <bool> go = false;
+  atomic <int> numResolved = 0;
+  vector <thread> threads;
+  for (int i = 0; i < kNumThreads; i++)
+    threads.emplace_back ([&]() {
+      while (!go)
+        this_thread::yield();
+      vector <cDnsCache::cAddress> addresses;
+      if (cDnsCache::resolve ("bench.cold", 80, addresses) && (addresses.size() == 2))
+        numResolved++;
+      });
+  go = true;
+  for (auto& thread : threads)
+    thread.join();
+  check ((numResolved == kNumThreads) && (cDnsCache::getMisses() == misses + 1) &&
+         (cDnsCache::getHits() + cDnsCache::getWaits() == hitsWaits + kNumThreads - 1),
+         fmt::format ("bench.cold {} threads resolved:{}", kNumThreads, numResolved.load()));
+
+  // failed lookup negatively cached, second resolve fails as a hit without looking up
+  vector <cDnsCache::cAddress> addresses;
+  misses = cDnsCache::getMisses();
+  check (!cDnsCache::resolve ("bench.fail", 80, addresses) && (cDnsCache::getMisses() == misses + 1),
+         "bench.fail resolve");
+  int64_t hits = cDnsCache::getHits();
+  check (!cDnsCache::resolve ("bench.fail", 80, addresses) && (cDnsCache::getMisses() == misses + 1) &&
+         (cDnsCache::getHits() == hits + 1), "bench.fail negatively cached");
+
+  cLog::log (LOGINFO, fmt::format ("dnsCache {}", cDnsCache::getInfoString()));
+
+  // leave real lookups to the http cases
+  cDnsCache::setHostsTable ({});
+  cDnsCache::clear();
+  return ok;
+  }
+//}}}
+//{{{
+bool checkHttpPipelined() {
+// pipelined responses match requests in order, server closing every few responses,
+// - unanswered tail resent on new connections, every path answered once with its own body
+
+  constexpr int kNumPaths = 20;
+  constexpr int kCloseAfter = 5;
+
+  bool ok = true;
+  for (int closeAfter : { 0, kCloseAfter }) {
+    cBenchHttpServer server (1, [](const string& path) { return "body" + path; }, closeAfter);
+
+    vector <string> paths;
+    for (int i = 0; i < kNumPaths; i++)
+      paths.push_back (fmt::format ("path{}", i));
+
+    cHttp http;
+    size_t nextIndex = 0;
+    int numAnswered = http.getPipelined (server.getHost(), paths, 4, [&](size_t index, int response) {
+      string body = http.getContent() ? string ((const char*)http.getContent(), http.getContentSize()) : "";
+      if ((index != nextIndex++) || (response != 200) || (body != "body/" + paths[index])) {
+        cLog::log (LOGERROR, fmt::format ("httpPipelined closeAfter:{} index:{} response:{} body:{}",
+                                          closeAfter, index, response, body));
+        ok = false;
+        }
+      });
+
+    // tail retry, a closing server sees more connections than closes, requests beyond the answered are resends
+    vector <pair <int,string>> requests = server.getRequests();
+    int numConnections = 0;
+    for (auto& request : requests)
+      numConnections = max (numConnections, request.first + 1);
+    cLog::log (LOGINFO, fmt::format ("httpPipelined closeAfter:{} answered:{} requests:{} connections:{}",
+                                     closeAfter, numAnswered, requests.size(), numConnections));
+    if ((numAnswered != kNumPaths) ||
+        (closeAfter && (numConnections < (kNumPaths / closeAfter))) ||
+        (!closeAfter && (numConnections != 1))) {
+      cLog::log (LOGERROR, fmt::format ("httpPipelined closeAfter:{} failed", closeAfter));
+      ok = false;
+      }
+    }
+
+  return ok;
+  }
+//}}}
+//{{{
+void benchHls (cBench& bench) {
+// canned m3u8 and ts chunks from loopback server with rtt, cHlsFetcher with 1 connection, serial, against 3
+// - start, get m3u8 then first chunks on fresh connections
+// - seek, chunks not loaded on warm connections, alternates between two positions
+
+  constexpr int kDelayMs = 20;
+  constexpr int kNumChunks = 3;
+  constexpr int kFirstChunk = 1000;
+  constexpr int kSeekChunks = 100;
+
+  string m3u8 = fmt::format ("#EXTM3U\n#EXT-X-TARGETDURATION:7\n#EXT-X-MEDIA-SEQUENCE:{}\n", kFirstChunk);
+  for (int chunk = 0; chunk < 2 * kSeekChunks; chunk++)
+    m3u8 += fmt::format ("#EXTINF:6.4,\nbench-{}.ts\n", kFirstChunk + chunk);
+  vector <uint8_t> ts = createTs (0x100, 2048, 32);
+  string chunk (ts.begin(), ts.end());
+
+  cBenchHttpServer server (kDelayMs, [&](const string& path) {
+    return (path.find (".m3u8") != string::npos) ? m3u8 : chunk; });
+  string host = server.getHost();
+  auto pathCallback = [](int chunkNum) noexcept { return fmt::format ("bench-{}.ts", chunkNum); };
+
+  int64_t numBytes = 0;
+  //{{{
+  auto getChunks = [&](cHlsFetcher& fetcher, int firstChunk) {
+  // demux order as cLoadHls, refetch wanted chunks while waiting for first
+
+    vector <int> chunkNums;
+    for (int chunkNum = firstChunk; chunkNum < firstChunk + kNumChunks; chunkNum++)
+      chunkNums.push_back (chunkNum);
+
+    while (!chunkNums.empty()) {
+      fetcher.fetch (chunkNums);
+      cHlsFetcher::cSegment* segment = fetcher.waitSegment (chunkNums.front(), 100ms);
+      if (segment) {
+        if (segment->mResponse == 200)
+          numBytes += segment->mContentSize;
+        delete segment;
+        chunkNums.erase (chunkNums.begin());
+        }
+      }
+    };
+  //}}}
+
+  for (int numConnections : { 1, 3 }) {
+    bench.run (fmt::format ("hlsStart{}", numConnections), "chunks", kNumChunks, [&]() {
+      cHttp http;
+      if (http.get (host, "bench.norewind.m3u8") != 200)
+        return;
+      string playlist ((const char*)http.getContent(), http.getContentSize());
+      size_t sequence = playlist.find ("#EXT-X-MEDIA-SEQUENCE:");
+      int firstChunk = (sequence != string::npos) ? atoi (playlist.c_str() + sequence + 22) : kFirstChunk;
+
+      cHlsFetcher fetcher (numConnections, pathCallback);
+      fetcher.setHost (host);
+      getChunks (fetcher, firstChunk);
+      });
+
+    cHlsFetcher fetcher (numConnections, pathCallback);
+    fetcher.setHost (host);
+    bool seekForward = true;
+    bench.run (fmt::format ("hlsSeek{}", numConnections), "chunks", kNumChunks, [&]() {
+      getChunks (fetcher, seekForward ? kFirstChunk + kSeekChunks : kFirstChunk);
+      seekForward = !seekForward;
+      });
+    }
+
+  cLog::log (LOGINFO, fmt::format ("hls bytes:{}", numBytes));
+  }
+//}}}
+#endif
+
+// main
+//{{{
+int main (int numArgs, char* args[]) {
+
+  vector <string> params;
+  for (int i = 1; i < numArgs; i++)
+    params.push_back (args[i]);
+
+  // command line options
+  eLogLevel logLevel = LOGERROR;
+  bool json = false;
+  bool quick = false;
+  string outFileName;
+  //{{{  parse params to command line options
+  for (auto it = params.begin(); it < params.end();) {
+    if (*it == "log1") { logLevel = LOGINFO; ++it; }
+    else if (*it == "json") { json = true; ++it; }
+    else if (*it == "csv") { json = false; ++it; }
+    else if (*it == "quick") { quick = true; ++it; }
+    else { outFileName = *it; ++it; }
+    };
+  //}}}
+
+  // synchronous log, keeps results and log lines in order
+  cLog::init (logLevel, false, "", false);
+  cLog::log (LOGNOTICE, "miniBench");
+
+  // simd power,peak kernel must match scalar reference before its timings mean anything
+  if (!cSong::checkPowerPeakKernel()) {
+    cLog::log (LOGERROR, fmt::format ("powerPeak {} kernel check failed", cSong::getPowerPeakKernelName()));
+    return 1;
+    }
+
+  if (!checkHlsRateSelector()) {
+    cLog::log (LOGERROR, "hlsRateSelector check failed");
+    return 1;
+    }
+
+  #ifndef _WIN32
+    // dns cache must hit, share a cold lookup and cache failures before http timings mean anything
+    if (!checkDnsCache()) {
+      cLog::log (LOGERROR, "dnsCache check failed");
+      return 1;
+      }
+
+    // pipelined http must match responses in order and retry its tail before its timings mean anything
+    if (!checkHttpPipelined()) {
+      cLog::log (LOGERROR, "httpPipelined check failed");
+      return 1;
+      }
+  #endif
+
+  cBench bench (quick);
+  benchTsParse (bench);
+  benchSongAddFrame (bench);
+  benchSongSpectrum (bench);
+  benchAacDecode (bench);
+  benchPngDecode (bench);
+  benchDrawAA (bench);
+  benchTexture (bench);
+  benchDrawText (bench);
+  #ifndef _WIN32
+    benchHttp (bench);
+    benchHls (bench);
+  #endif
+
+  string results = json ? bench.getJson() : bench.getCsv();
+  if (outFileName.empty())
+    fputs (results.c_str(), stdout);
+  else {
+    FILE* file = fopen (outFileName.c_str(), "w");
+    if (!file) {
+      cLog::log (LOGERROR, fmt::format ("failed to open {}", outFileName));
+      return 1;
+      }
+    fputs (results.c_str(), file);
+    fclose (file);
+    }
+
+  return 0;
+  }
+//}}}
@@ -217,7 +217,7 @@ class cRect {
   //{{{
   cRect()  {
     left = 0;
-    bottom = 0;
+    top = 0;
     right = 0;
     bottom = 0;
     }
@@ -327,6 +327,37 @@ class cRect {
     return *this;
     }
   //}}}
+  //{{{
+  cRect operator |= (const cRect& rect) {
+  // union, bounding rect of both
+
+    if (rect.empty())
+      return *this;
+
+    if (empty())
+      *this = rect;
+    else {
+      left = std::min (left, rect.left);
+      top = std::min (top, rect.top);
+      right = std::max (right, rect.right);
+      bottom = std::max (bottom, rect.bottom);
+      }
+
+    return *this;
+    }
+  //}}}
+  //{{{
+  cRect operator & (const cRect& rect) const {
+  // intersection, empty if no overlap
+
+    cRect intersect (std::max (left, rect.left), std::max (top, rect.top),
+                     std::min (right, rect.right), std::min (bottom, rect.bottom));
+    if ((intersect.right <= intersect.left) || (intersect.bottom <= intersect.top))
+      return cRect();
+
+    return intersect;
+    }
+  //}}}
 
   //{{{
   bool operator == (const cRect& rect)  {
@@ -14,6 +14,9 @@
 #include <deque>
 #include <map>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstring>
 
 #include "../date/include/date/date.h"
 #include "fmt/format.h"
@@ -55,9 +58,14 @@ namespace {
                                        fmt::color::lavender};    // info3
 
   map <uint64_t, string> gThreadNameMap;
+  mutex gThreadNameMutex;
+
   deque <cLogLine> gLineDeque;
   mutex gLinesMutex;
 
+  // serialises writing, async writer thread or sync log callers
+  mutex gWriterMutex;
+
   FILE* gFile = NULL;
   bool gBuffer = false;
 
@@ -71,6 +79,163 @@ namespace {
   #ifdef __linux__
     uint64_t getThreadId() { return gettid(); }
   #endif
+
+  //{{{  async record ring
+  // - bounded lock free mpsc ring of fixed size records, sequence per slot
+  // - full ring drops newest record, counted, writer reports drops
+  // - long line spans consecutive records, claimed together, writer rejoins them
+  constexpr uint64_t kRingSize = 4096;
+  constexpr uint64_t kRingMask = kRingSize - 1;
+  constexpr uint32_t kMaxRecordText = 240;
+  constexpr uint32_t kMaxLineRecords = 16;
+
+  struct cLogRecord {
+    atomic<uint64_t> mSequence = 0;
+    eLogLevel mLogLevel = LOGINFO;
+    uint64_t mThreadId = 0;
+    chrono::time_point<chrono::system_clock> mTimePoint;
+    uint32_t mLength = 0;
+    bool mContinued = false;
+    char mText[kMaxRecordText];
+    };
+
+  atomic<bool> gAsync = false;
+  atomic<bool> gWriterExit = false;
+  thread gWriterThread;
+  cLogRecord* gRing = nullptr;
+  atomic<uint64_t> gRingHead = 0;
+  uint64_t gRingTail = 0;
+  string gRingText;
+
+  atomic<uint64_t> gNumDropped = 0;
+  uint64_t gNumDroppedReported = 0;
+  //}}}
+
+  //{{{
+  void writeLine (eLogLevel logLevel, uint64_t threadId,
+                  chrono::time_point<chrono::system_clock> timePoint, const string& logStr) {
+  // buffer or print line, called holding gWriterMutex
+
+    if (gBuffer) {
+      // buffer for widget display
+      lock_guard<mutex> lockGuard (gLinesMutex);
+      gLineDeque.push_front (cLogLine (logLevel, threadId, timePoint, logStr));
+      if (gLineDeque.size() > kMaxBuffer)
+        gLineDeque.pop_back();
+      }
+
+    else if (logLevel <= gLogLevel) {
+      fmt::print (fg (fmt::color::floral_white) | fmt::emphasis::bold, "{} {} {}\n",
+                  date::format ("%T", chrono::floor<chrono::microseconds>(timePoint)),
+                  fmt::format (fg (fmt::color::dark_gray), "{}", cLog::getThreadName (threadId)),
+                  fmt::format (fg (kLevelColours[logLevel]), "{}", logStr));
+
+      if (gFile)
+        fputs (fmt::format ("{} {} {}\n",
+                            date::format("%T", chrono::floor<chrono::microseconds>(timePoint)),
+                            cLog::getThreadName (threadId),
+                            logStr).c_str(), gFile);
+      }
+    }
+  //}}}
+  //{{{
+  bool pushRecord (eLogLevel logLevel, chrono::time_point<chrono::system_clock> timePoint, const string& logStr) {
+  // claim run of slots by cas on head, fill, publish each by sequence, false if full
+  // - slots free in order, so last slot of run free means whole run free
+  // - line longer than kMaxLineRecords records truncated, marked by trailing ...
+
+    const char* kTruncatedMark = "...";
+    const size_t kMaxLineText = kMaxLineRecords * kMaxRecordText;
+
+    string truncatedStr;
+    const string* str = &logStr;
+    if (logStr.size() > kMaxLineText) {
+      truncatedStr = logStr.substr (0, kMaxLineText - strlen (kTruncatedMark)) + kTruncatedMark;
+      str = &truncatedStr;
+      }
+    uint64_t numRecords = max ((size_t)1, (str->size() + kMaxRecordText - 1) / kMaxRecordText);
+
+    uint64_t pos = gRingHead.load (memory_order_relaxed);
+    while (true) {
+      cLogRecord& lastRecord = gRing[(pos + numRecords - 1) & kRingMask];
+      int64_t diff = int64_t(lastRecord.mSequence.load (memory_order_acquire)) - int64_t(pos + numRecords - 1);
+      if (diff == 0) {
+        if (gRingHead.compare_exchange_weak (pos, pos + numRecords, memory_order_relaxed))
+          break;
+        }
+      else if (diff < 0) {
+        // full, drop
+        gNumDropped++;
+        return false;
+        }
+      else
+        pos = gRingHead.load (memory_order_relaxed);
+      }
+
+    uint64_t threadId = getThreadId();
+    for (uint64_t i = 0; i < numRecords; i++) {
+      cLogRecord& record = gRing[(pos + i) & kRingMask];
+      record.mLogLevel = logLevel;
+      record.mThreadId = threadId;
+      record.mTimePoint = timePoint;
+      record.mLength = (uint32_t)min (str->size() - (i * kMaxRecordText), (size_t)kMaxRecordText);
+      record.mContinued = i < numRecords - 1;
+      memcpy (record.mText, str->data() + (i * kMaxRecordText), record.mLength);
+      record.mSequence.store (pos + i + 1, memory_order_release);
+      }
+
+    return true;
+    }
+  //}}}
+  //{{{
+  uint32_t drainRecords() {
+  // single consumer, called holding gWriterMutex, return number written
+
+    uint32_t numRecords = 0;
+    while (true) {
+      cLogRecord& record = gRing[gRingTail & kRingMask];
+      if (record.mSequence.load (memory_order_acquire) != gRingTail + 1)
+        break;
+
+      // continued records of a line are contiguous, may be rejoined across drains
+      gRingText.append (record.mText, record.mLength);
+      if (!record.mContinued) {
+        writeLine (record.mLogLevel, record.mThreadId, record.mTimePoint, gRingText);
+        gRingText.clear();
+        }
+      record.mSequence.store (gRingTail + kRingSize, memory_order_release);
+      gRingTail++;
+      numRecords++;
+      }
+
+    uint64_t numDropped = gNumDropped;
+    if (numDropped != gNumDroppedReported) {
+      writeLine (LOGERROR, getThreadId(), chrono::system_clock::now() + gDaylightSavingHours,
+                 fmt::format ("log ring full, dropped {} lines", numDropped - gNumDroppedReported));
+      gNumDroppedReported = numDropped;
+      }
+
+    if (numRecords && gFile)
+      fflush (gFile);
+
+    return numRecords;
+    }
+  //}}}
+  //{{{
+  void stopWriter() {
+  // atexit, stop and join writer thread before statics destruct, drain, later log calls sync
+
+    gWriterExit = true;
+    if (gWriterThread.joinable())
+      gWriterThread.join();
+
+    gAsync = false;
+
+    // catch records pushed by callers that still saw gAsync
+    lock_guard<mutex> lockGuard (gWriterMutex);
+    drainRecords();
+    }
+  //}}}
   }
 
 //{{{
@@ -84,7 +249,7 @@ cLog::~cLog() {
 //}}}
 
 //{{{
-bool cLog::init (enum eLogLevel logLevel, bool buffer, const string& logFilePath) {
+bool cLog::init (enum eLogLevel logLevel, bool buffer, const string& logFilePath, bool async) {
 
   // get daylightSaving hours
   time_t current_time;
@@ -108,17 +273,55 @@ bool cLog::init (enum eLogLevel logLevel, bool buffer, const string& logFilePath
       }
     }
 
+  if (async && !gAsync) {
+    //{{{  create ring, launch writer thread
+    gRing = new cLogRecord[kRingSize];
+    for (uint64_t i = 0; i < kRingSize; i++)
+      gRing[i].mSequence = i;
+    gAsync = true;
+
+    gWriterThread = thread ([=]() {
+      cLog::setThreadName ("log ");
+      while (!gWriterExit) {
+        uint32_t numRecords;
+        {
+        lock_guard<mutex> lockGuard (gWriterMutex);
+        numRecords = drainRecords();
+        }
+        if (!numRecords)
+          this_thread::sleep_for (chrono::milliseconds (2));
+        }
+      });
+
+    // stop writer, write out anything left in ring at exit
+    atexit (stopWriter);
+    }
+    //}}}
+
   setThreadName ("main");
 
   return gFile != NULL;
   }
 //}}}
 
+//{{{
+void cLog::flush() {
+// write anything in async ring now
+
+  if (gAsync) {
+    lock_guard<mutex> lockGuard (gWriterMutex);
+    drainRecords();
+    }
+  }
+//}}}
+
 enum eLogLevel cLog::getLogLevel() { return gLogLevel; }
+uint64_t cLog::getNumDropped() { return gNumDropped; }
 
 //{{{
 string cLog::getThreadName (uint64_t threadId) {
 
+  lock_guard<mutex> lockGuard (gThreadNameMutex);
   auto it = gThreadNameMap.find (threadId);
   if (it != gThreadNameMap.end())
     return it->second;
@@ -181,9 +384,12 @@ void cLog::setLogLevel (enum eLogLevel logLevel) {
 //{{{
 void cLog::setThreadName (const string& name) {
 
+  {
+  lock_guard<mutex> lockGuard (gThreadNameMutex);
   auto it = gThreadNameMap.find (getThreadId());
   if (it == gThreadNameMap.end())
     gThreadNameMap.insert (map<uint64_t,string>::value_type (getThreadId(), name));
+  }
 
   log (LOGNOTICE, "start");
   }
@@ -195,30 +401,17 @@ void cLog::log (enum eLogLevel logLevel, const string& logStr) {
   if (!gBuffer && (logLevel > gLogLevel))
     return;
 
-  lock_guard<mutex> lockGuard (gLinesMutex);
-
   chrono::time_point<chrono::system_clock> now = chrono::system_clock::now() + gDaylightSavingHours;
 
-  if (gBuffer) {
-    // buffer for widget display
-    gLineDeque.push_front (cLogLine (logLevel, getThreadId(), now, logStr));
-    if (gLineDeque.size() > kMaxBuffer)
-      gLineDeque.pop_back();
-    }
+  if (gAsync)
+    // async, writer thread formats and writes
+    pushRecord (logLevel, now, logStr);
 
-  else if (logLevel <= gLogLevel) {
-    fmt::print (fg (fmt::color::floral_white) | fmt::emphasis::bold, "{} {} {}\n",
-                date::format ("%T", chrono::floor<chrono::microseconds>(now)),
-                fmt::format (fg (fmt::color::dark_gray), "{}", getThreadName (getThreadId())),
-                fmt::format (fg (kLevelColours[logLevel]), "{}", logStr));
-
-    if (gFile) {
-      fputs (fmt::format ("{} {} {}\n",
-                          date::format("%T", chrono::floor<chrono::microseconds>(now)),
-                          getThreadName (getThreadId()),
-                          logStr).c_str(), gFile);
+  else {
+    lock_guard<mutex> lockGuard (gWriterMutex);
+    writeLine (logLevel, getThreadId(), now, logStr);
+    if (gFile)
       fflush (gFile);
-      }
     }
   }
 //}}}
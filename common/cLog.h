@@ -30,12 +30,15 @@ public:
   cLog() = default;
   ~cLog();
 
-  static bool init (eLogLevel logLevel = LOGINFO, bool buffer = false, const std::string& logFilePath = "");
+  static bool init (eLogLevel logLevel = LOGINFO, bool buffer = false, const std::string& logFilePath = "",
+                    bool async = true);
+  static void flush();
 
   // get
   static enum eLogLevel getLogLevel();
   static std::string getThreadName (uint64_t threadId);
   static bool getLine (cLogLine& line, unsigned lineNum, unsigned& lastLineIndex);
+  static uint64_t getNumDropped();
 
   // set
   static void cycleLogLevel();
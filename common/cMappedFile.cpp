@@ -0,0 +1,178 @@
+// cMappedFile.cpp - readOnly memory mapped file, remaps as a growing file extends
+//{{{  includes
+#ifdef _WIN32
+  #define _CRT_SECURE_NO_WARNINGS
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#include "cMappedFile.h"
+
+#include "cLog.h"
+#include "fmt/format.h"
+
+using namespace std;
+//}}}
+
+//{{{
+bool cMappedFile::open (const string& filename) {
+// open and map whatever is there, a zero length file opens ok and maps on a later remap
+
+  close();
+
+  #ifdef _WIN32
+    // share write,delete so a recorder can keep extending the file
+    HANDLE fileHandle = CreateFileA (filename.c_str(), GENERIC_READ,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                     NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+      cLog::log (LOGERROR, fmt::format ("cMappedFile::open failed {}", filename));
+      return false;
+      }
+    mFileHandle = fileHandle;
+  #else
+    mFileDescriptor = ::open (filename.c_str(), O_RDONLY);
+    if (mFileDescriptor < 0) {
+      cLog::log (LOGERROR, fmt::format ("cMappedFile::open failed {}", filename));
+      return false;
+      }
+  #endif
+
+  mOpen = true;
+
+  int64_t size = getFileSize();
+  if (size > 0)
+    return map (size);
+
+  return true;
+  }
+//}}}
+//{{{
+bool cMappedFile::remap() {
+// remap if file has grown, return true if more data mapped
+
+  if (!mOpen)
+    return false;
+
+  int64_t size = getFileSize();
+  if (size <= mSize)
+    return false;
+
+  #ifdef __linux__
+    if (mData) {
+      // grow in place or move, no unmap gap
+      void* data = mremap (mData, mSize, size, MREMAP_MAYMOVE);
+      if (data == MAP_FAILED) {
+        cLog::log (LOGERROR, fmt::format ("cMappedFile::remap failed {} to {}", mSize, size));
+        return false;
+        }
+
+      mData = (uint8_t*)data;
+      mSize = size;
+      mNumRemaps++;
+      return true;
+      }
+  #endif
+
+  unmap();
+  if (!map (size))
+    return false;
+
+  mNumRemaps++;
+  return true;
+  }
+//}}}
+//{{{
+void cMappedFile::close() {
+
+  unmap();
+
+  #ifdef _WIN32
+    if (mFileHandle)
+      CloseHandle (mFileHandle);
+    mFileHandle = nullptr;
+  #else
+    if (mFileDescriptor >= 0)
+      ::close (mFileDescriptor);
+    mFileDescriptor = -1;
+  #endif
+
+  mOpen = false;
+  }
+//}}}
+
+// private
+//{{{
+int64_t cMappedFile::getFileSize() {
+
+  #ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx (mFileHandle, &size))
+      return 0;
+    return size.QuadPart;
+  #else
+    struct stat st;
+    if (fstat (mFileDescriptor, &st) == -1)
+      return 0;
+    return st.st_size;
+  #endif
+  }
+//}}}
+//{{{
+bool cMappedFile::map (int64_t size) {
+
+  #ifdef _WIN32
+    HANDLE mappingHandle = CreateFileMappingA (mFileHandle, NULL, PAGE_READONLY,
+                                               DWORD(size >> 32), DWORD(size & 0xFFFFFFFF), NULL);
+    if (!mappingHandle) {
+      cLog::log (LOGERROR, fmt::format ("cMappedFile::map CreateFileMapping failed {}", size));
+      return false;
+      }
+
+    void* data = MapViewOfFile (mappingHandle, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+    if (!data) {
+      cLog::log (LOGERROR, fmt::format ("cMappedFile::map MapViewOfFile failed {}", size));
+      CloseHandle (mappingHandle);
+      return false;
+      }
+    mMappingHandle = mappingHandle;
+
+  #else
+    void* data = mmap (NULL, (size_t)size, PROT_READ, MAP_SHARED, mFileDescriptor, 0);
+    if (data == MAP_FAILED) {
+      cLog::log (LOGERROR, fmt::format ("cMappedFile::map mmap failed {}", size));
+      return false;
+      }
+
+    // mostly read front to back, let the kernel read ahead
+    madvise (data, (size_t)size, MADV_SEQUENTIAL);
+  #endif
+
+  mData = (uint8_t*)data;
+  mSize = size;
+  return true;
+  }
+//}}}
+//{{{
+void cMappedFile::unmap() {
+
+  if (mData) {
+    #ifdef _WIN32
+      UnmapViewOfFile (mData);
+      CloseHandle (mMappingHandle);
+      mMappingHandle = nullptr;
+    #else
+      munmap (mData, (size_t)mSize);
+    #endif
+    }
+
+  mData = nullptr;
+  mSize = 0;
+  }
+//}}}
@@ -0,0 +1,38 @@
+// cMappedFile.h - readOnly memory mapped file, remaps as a growing file extends
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+//}}}
+
+class cMappedFile {
+public:
+  cMappedFile() = default;
+  ~cMappedFile() { close(); }
+
+  bool open (const std::string& filename);
+  bool remap();
+  void close();
+
+  bool isOpen() const { return mOpen; }
+  const uint8_t* getData() const { return mData; }
+  int64_t getSize() const { return mSize; }
+  int64_t getNumRemaps() const { return mNumRemaps; }
+
+private:
+  int64_t getFileSize();
+  bool map (int64_t size);
+  void unmap();
+
+  bool mOpen = false;
+  uint8_t* mData = nullptr;
+  int64_t mSize = 0;
+  int64_t mNumRemaps = 0;
+
+  #ifdef _WIN32
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+  #else
+    int mFileDescriptor = -1;
+  #endif
+  };
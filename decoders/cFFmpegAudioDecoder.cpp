@@ -72,9 +72,11 @@ cFFmpegAudioDecoder::~cFFmpegAudioDecoder() {
 //}}}
 
 //{{{
-float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen, int64_t pts) {
+int cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen, int64_t pts,
+                                      const function <float* (int numChannels, int numSamples)>& getSamples) {
+// decode into caller's getSamples buffer, first decoded frame only
 
-  float* samples = nullptr;
+  int numSamples = 0;
 
   AVPacket* avPacket = av_packet_alloc();
   AVFrame* avFrame = av_frame_alloc();
@@ -94,7 +96,7 @@ float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen,
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF || ret < 0)
           break;
 
-        if (avFrame->nb_samples > 0) {
+        if ((avFrame->nb_samples > 0) && !numSamples) {
           switch (mAvContext->sample_fmt) {
             //{{{
             case AV_SAMPLE_FMT_FLTP: { // 32bit float planar, copy to interleaved, mix down 5.1
@@ -103,8 +105,10 @@ float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen,
               mSampleRate = avFrame->sample_rate;
               mSamplesPerFrame = avFrame->nb_samples;
 
-              samples = (float*)malloc (mChannels * mSamplesPerFrame * sizeof(float));
-              float* dstPtr = samples;
+              float* dstPtr = getSamples (mChannels, mSamplesPerFrame);
+              if (!dstPtr)
+                break;
+              numSamples = mSamplesPerFrame;
 
               float* srcPtr0 = (float*)avFrame->data[0];
               float* srcPtr1 = (float*)avFrame->data[1];
@@ -127,12 +131,16 @@ float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen,
               break;
             //}}}
             //{{{
-            case AV_SAMPLE_FMT_S16P: // 16bit signed planar, copy scale and copy to interleaved
+            case AV_SAMPLE_FMT_S16P: { // 16bit signed planar, copy scale and copy to interleaved
               mChannels =  avFrame->ch_layout.nb_channels;
               mSampleRate = avFrame->sample_rate;
               mSamplesPerFrame = avFrame->nb_samples;
 
-              samples = (float*)malloc (avFrame->ch_layout.nb_channels * avFrame->nb_samples * sizeof(float));
+              float* samples = getSamples (mChannels, mSamplesPerFrame);
+              if (!samples)
+                break;
+              numSamples = mSamplesPerFrame;
+
               for (int channel = 0; channel < avFrame->ch_layout.nb_channels; channel++) {
                 float* dstPtr = samples + channel;
                 short* srcPtr = (short*)avFrame->data[channel];
@@ -141,6 +149,7 @@ float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen,
                   dstPtr += mChannels;
                   }
                 }
+              }
               break;
             //}}}
             default:;
@@ -156,6 +165,6 @@ float* cFFmpegAudioDecoder::decodeFrame (const uint8_t* framePtr, int frameLen,
 
   av_frame_free (&avFrame);
   av_packet_free (&avPacket);
-  return samples;
+  return numSamples;
   }
 //}}}
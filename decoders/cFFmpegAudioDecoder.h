@@ -15,7 +15,8 @@ public:
   int32_t getSampleRate() { return mSampleRate; }
   int32_t getNumSamplesPerFrame() { return mSamplesPerFrame; }
 
-  float* decodeFrame (const uint8_t* framePtr, int frameLen, int64_t pts);
+  int decodeFrame (const uint8_t* framePtr, int frameLen, int64_t pts,
+                   const std::function <float* (int numChannels, int numSamples)>& getSamples);
 
 private:
   int32_t mChannels = 0;
@@ -1,6 +1,7 @@
 // iAudioDecoder.h
 #pragma once
 #include <stdint.h>
+#include <functional>
 
 enum class eAudioFrameType { eUnknown, eId3Tag, eWav, eMp3, eAacAdts, eAacLatm } ;
 
@@ -12,5 +13,8 @@ public:
   virtual int32_t getSampleRate() = 0;
   virtual int32_t getNumSamplesPerFrame() = 0;
 
-  virtual float* decodeFrame (const uint8_t* inbuf, int bytesLeft, int64_t pts) = 0;
+  // decode frame into interleaved float samples written to getSamples buffer, return numSamples, 0 if none
+  // - getSamples gets decoded numChannels,numSamples, returns buffer for them, nullptr to drop frame
+  virtual int decodeFrame (const uint8_t* inbuf, int bytesLeft, int64_t pts,
+                           const std::function <float* (int numChannels, int numSamples)>& getSamples) = 0;
   };
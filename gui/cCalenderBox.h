@@ -13,7 +13,9 @@
 class cCalendarBox : public cWindow::cBox {
 public:
   cCalendarBox (cWindow& window, bool roundedBgnd = false)
-    : cBox("calendar", window, 11, 8), mRoundedBgnd(roundedBgnd) {}
+    : cBox("calendar", window, 11, 8), mRoundedBgnd(roundedBgnd) {
+    mTimedOn = true;
+    }
 
   //{{{
   virtual bool down (bool right, cPoint pos) final {
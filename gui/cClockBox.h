@@ -13,7 +13,9 @@
 class cClockBox : public cWindow::cBox {
 public:
   cClockBox (cWindow& window, float height, bool showSubSeconds = false)
-    : cBox("clock", window, height, height), mShowSubSeconds(showSubSeconds) {}
+    : cBox("clock", window, height, height), mShowSubSeconds(showSubSeconds) {
+    mTimedOn = true;
+    }
 
   //{{{
   virtual bool down (bool right, cPoint pos) final {
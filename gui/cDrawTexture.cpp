@@ -188,54 +188,48 @@ uint32_t cDrawTexture::getNumFontChars() const {
 //{{{
 void cDrawTexture::drawGradH (const cColor& colorLeft, const cColor& colorRight, const cRect& rect) {
 // !!! is the color resolution maths is right !!!
-// !!! add clips !!!
 
-  int32_t left = rect.getLeftInt32();
-  int32_t top = rect.getTopInt32();
-  int32_t xmax = std::min (rect.getRightInt32(), mWidth);
-  int32_t ymax = std::min (rect.getBottomInt32(), mHeight);
+  cClipRect clipRect (rect, getClip());
+  if (clipRect.empty)
+    return;
+
   int32_t width = rect.getWidthInt32();
 
   uPixel colorPixelLeft (colorLeft);
   uPixel colorPixelRight (colorRight);
 
   // draw first line
-  int32_t y = top;
-  uPixel* dst = getPixels (left, y);
-  for (int32_t x = 0; x < xmax - left; x++) {
+  uPixel* dst = getPixels (clipRect.left, clipRect.top);
+  for (int32_t x = clipRect.srcLeft; x < clipRect.srcLeft + clipRect.getWidth(); x++) {
     uint8_t alpha = mGamma[uint8_t((x * 0xFF) / width)];
     (*dst).rgba.r = colorPixelLeft.rgba.r + ((alpha * (colorPixelRight.rgba.r - colorPixelLeft.rgba.r)) >> 8);
     (*dst).rgba.g = colorPixelLeft.rgba.g + ((alpha * (colorPixelRight.rgba.g - colorPixelLeft.rgba.g)) >> 8);
     (*dst).rgba.b = colorPixelLeft.rgba.b + ((alpha * (colorPixelRight.rgba.b - colorPixelLeft.rgba.b)) >> 8);
     dst++;
     }
-  y++;
 
   // simple copy of first line to subsequent lines
-  uPixel* src = getPixels (left, top);
-  for (; y < ymax; y++) {
-    dst = getPixels (left,y);
-    memcpy (dst, src, (xmax - left) * sizeof(uPixel));
-    dst += mWidth;
-    }
+  uPixel* src = getPixels (clipRect.left, clipRect.top);
+  for (int32_t y = clipRect.top + 1; y < clipRect.bottom; y++)
+    memcpy (getPixels (clipRect.left, y), src, clipRect.getWidth() * sizeof(uPixel));
   }
 //}}}
 //{{{
 void cDrawTexture::drawGradV (const cColor& colorTop, const cColor& colorBottom, const cRect& rect) {
 // !!! is the color resolution maths is right !!!
 
-  int32_t left = rect.getLeftInt32();
-  int32_t top = rect.getTopInt32();
-  int32_t xmax = std::min (rect.getRightInt32(), mWidth);
-  int32_t ymax = std::min (rect.getBottomInt32(), mHeight);
+  cClipRect clipRect (rect, getClip());
+  if (clipRect.empty)
+    return;
+
   int32_t height = rect.getHeightInt32();
-  int32_t dstStride = mWidth - (xmax - left);
+  int32_t dstStride = mWidth - clipRect.getWidth();
 
   uPixel colorPixelTop (colorTop);
   uPixel colorPixelBottom (colorBottom);
 
-  uPixel* dst = getPixels (left,top);
-  for (int32_t j = 0; j < ymax - top; j++) {
+  uPixel* dst = getPixels (clipRect.left, clipRect.top);
+  for (int32_t j = clipRect.srcTop; j < clipRect.srcTop + clipRect.getHeight(); j++) {
     uint8_t alpha = mGamma[uint8_t((j * 0xFF) / height)];
 
     uPixel colorPixel;
@@ -245,7 +239,7 @@ void cDrawTexture::drawGradV (const cColor& colorTop, const cColor& colorBottom,
     colorPixel.rgba.a = 0;
 
     // draw line of color
-    for (int32_t i = left; i < xmax; i++)
+    for (int32_t i = clipRect.left; i < clipRect.right; i++)
       *dst++ = colorPixel.pixel;
 
     dst += dstStride;
@@ -256,10 +250,11 @@ void cDrawTexture::drawGradV (const cColor& colorTop, const cColor& colorBottom,
 void cDrawTexture::drawGrad (const cColor& colorTopLeft, const cColor& colorTopRight,
                              const cColor& colorBottomLeft, const cColor& colorBottomRight, const cRect& rect) {
 // !!! is the color resolution maths is right !!!
-  int32_t left = rect.getLeftInt32();
-  int32_t top = rect.getTopInt32();
-  int32_t xmax = std::min (rect.getRightInt32(), mWidth);
-  int32_t ymax = std::min (rect.getBottomInt32(), mHeight);
+
+  cClipRect clipRect (rect, getClip());
+  if (clipRect.empty)
+    return;
+
   int32_t width = rect.getWidthInt32();
   int32_t height = rect.getHeightInt32();
 
@@ -268,9 +263,9 @@ void cDrawTexture::drawGrad (const cColor& colorTopLeft, const cColor& colorTopR
   uPixel colorPixelBottomLeft (colorBottomLeft);
   uPixel colorPixelBottomRight (colorBottomRight);
 
-  uPixel* dst = getPixels (left, top);
+  uPixel* dst = getPixels (clipRect.left, clipRect.top);
 
-  for (int32_t y = 0; y < ymax - top; y++) {
+  for (int32_t y = clipRect.srcTop; y < clipRect.srcTop + clipRect.getHeight(); y++) {
     // !!! is the color resolution maths is right !!!
     uint8_t alpha = mGamma[uint8_t((y * 0xFF) / height)];
 
@@ -292,7 +287,7 @@ void cDrawTexture::drawGrad (const cColor& colorTopLeft, const cColor& colorTopR
                               ((alpha * (colorPixelBottomRight.rgba.b - colorPixelTopRight.rgba.b)) >> 8);
     colorPixelBottom.rgba.a = 0;
 
-    for (int32_t x = 0; x < xmax-left; x++) {
+    for (int32_t x = clipRect.srcLeft; x < clipRect.srcLeft + clipRect.getWidth(); x++) {
       alpha = mGamma[uint8_t((x * 0xFF) / width)];
 
       uPixel colorPixel;
@@ -302,7 +297,7 @@ void cDrawTexture::drawGrad (const cColor& colorTopLeft, const cColor& colorTopR
       *dst++ = colorPixel.pixel;
       }
 
-    dst += mWidth - (xmax - left);
+    dst += mWidth - clipRect.getWidth();
     }
   }
 //}}}
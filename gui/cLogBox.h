@@ -14,6 +14,7 @@ public:
   // full screen height, pick region 1 boxHeight on left of screen
 
     setPin (false);
+    setTimedOn (true);
     mLastRect = {mWindow.getSize()};
     }
   //}}}
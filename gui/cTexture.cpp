@@ -262,9 +262,14 @@ cTexture cTexture::createDecode (uint8_t* buffer, uint32_t bufferSize) {
   int32_t width;
   int32_t height;
   int32_t channels;
-  pixels = (uint8_t*)stbi_load_from_memory (buffer, bufferSize, &width, &height, &channels, 4);
-  if (pixels)
+  uint8_t* stbPixels = (uint8_t*)stbi_load_from_memory (buffer, bufferSize, &width, &height, &channels, 4);
+  if (stbPixels) {
+    // copy to our allocation, so release can deAllocate it
+    pixels = (uint8_t*)allocate (width * height * sizeof(uPixel));
+    memcpy (pixels, stbPixels, width * height * sizeof(uPixel));
+    stbi_image_free (stbPixels);
     return create (width, height, pixels, true);
+    }
 
   return cTexture();
   }
@@ -322,7 +327,7 @@ void cTexture::clear (const cColor& color) {
 void cTexture::drawRectangle (const cColor& color, const cRect& rect) {
 
   // convert to int32, clip to bitmap
-  cClipRect clipRect (rect, mWidth, mHeight);
+  cClipRect clipRect (rect, getClip());
   if (clipRect.empty)
     return;
 
@@ -342,7 +347,12 @@ void cTexture::drawRectangle (const cColor& color, const cRect& rect) {
 //}}}
 //{{{
 void cTexture::drawRectangleUnclipped (const cColor& color, const cRect& rect) {
-// useful for waveform drawing
+// useful for waveform drawing, still honours any damage clip
+
+  if (mClipped) {
+    drawRectangle (color, rect);
+    return;
+    }
 
   uPixel colorPixel (color);
 
@@ -366,7 +376,7 @@ void cTexture::blit (cTexture srcTexture, const cRect& dstRect) {
   if (srcTexture.empty())
     return;
 
-  cClipRect clipRect (dstRect, mWidth, mHeight);
+  cClipRect clipRect (dstRect, getClip());
   if (clipRect.empty)
     return;
 
@@ -400,7 +410,7 @@ void cTexture::blit (cTexture srcTexture, const cRect& dstRect, const cRect& cli
   if (srcTexture.empty())
     return;
 
-  cClipRect clipRect (dstRect, clip);
+  cClipRect clipRect (dstRect, clip & getClip());
   if (clipRect.empty)
     return;
 
@@ -425,7 +435,7 @@ void cTexture::blitSize (cTexture srcTexture, const cRect& dstRect) {
   if (srcTexture.empty())
     return;
 
-  cClipRect clipRect (dstRect, mWidth, mHeight);
+  cClipRect clipRect (dstRect, getClip());
   if (clipRect.empty)
     return;
 
@@ -450,7 +460,7 @@ void cTexture::blitAffine (cTexture srcTexture, const cRect& dstRect, const cMat
   if (srcTexture.empty())
     return;
 
-  cClipRect clipRect (dstRect, mWidth, mHeight);
+  cClipRect clipRect (dstRect, getClip());
   if (clipRect.empty)
     return;
 
@@ -494,7 +504,7 @@ void cTexture::stamp (const cColor& color, cAlphaTexture& alphaTexture, const cP
 
   cClipRect clipRect ({point.x, point.y,
                        point.x + (float)alphaTexture.getWidth(), point.y + (float)alphaTexture.getHeight()},
-                      mWidth, mHeight);
+                      getClip());
   if (clipRect.empty)
     return;
 
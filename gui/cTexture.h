@@ -125,6 +125,11 @@ public:
   uPixel* getPixels (cPoint point) { return getPixels (point.getYInt32(), point.getXInt32()); }
   uPixel* getPixels (int32_t x, int32_t y) { return empty() ? nullptr : getPixels() + (y * mWidth) + x; }
 
+  // clip, all draws are clipped to it, defaults to whole texture
+  cRect getClip() const { return mClipped ? mClip : cRect ((float)mWidth, (float)mHeight); }
+  void setClip (const cRect& clip) { mClip = clip & cRect ((float)mWidth, (float)mHeight); mClipped = true; }
+  void resetClip() { mClipped = false; }
+
   // draws
   void clear (const cColor& color = kBlack);
   void drawRectangle (const cColor& color, const cRect& rect);
@@ -145,5 +150,8 @@ protected:
 
   void setPixel (uPixel pixel, int32_t x, int32_t y) { *getPixels (x,y) = pixel; }
   void setPixel (uPixel pixel, cPoint point) { *getPixels (point) = pixel; }
+
+  bool mClipped = false;
+  cRect mClip;
   };
 //}}}
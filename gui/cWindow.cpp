@@ -3,6 +3,7 @@
 #include "cWindow.h"
 
 #include <chrono>
+#include <cmath>
 
 #include "../common/basicTypes.h"
 #include "../common/cLog.h"
@@ -15,6 +16,18 @@ using namespace chrono;
 //}}}
 
 // actions
+//{{{
+void cWindow::changed (const cRect& rect) {
+// add rect to damaged rects, clipped to window, thread safe
+
+  cRect damageRect = rect & cRect (getSize());
+  if (damageRect.empty())
+    return;
+
+  unique_lock<mutex> lock (mDamageMutex);
+  addDamage (mDamageRects, damageRect);
+  }
+//}}}
 void cWindow::resized() {}
 void cWindow::toggleFullScreen() {} // not yet
 
@@ -161,7 +174,7 @@ bool cWindow::createWindow (const string& title, uint32_t width, uint32_t height
 
       while (!mExit) {
         this_thread::sleep_for (tickMs);
-        changed();
+        mTicked = true;
         }
       }).detach();
     }
@@ -180,22 +193,43 @@ void cWindow::uiLoop (bool useChanged, bool drawPerf,
 
   int64_t frameUs = 0;
   while (!mExit) {
-    if (!useChanged || mChanged) {
+    if (!useChanged)
+      changed();
+    if (mTicked.exchange (false))
+      tickBoxes();
+
+    vector<cRect> damageRects = getDamage();
+    if (!damageRects.empty()) {
       system_clock::time_point time = system_clock::now();
+      mFrameNum++;
+
+      // perf bar redrawn every render
+      cRect perfRect (0.f, getHeight() - getBoxHeight(), (float)getWidth(), (float)getHeight());
+      if (drawPerf)
+        addDamage (damageRects, perfRect);
 
-      clear (bgndColor);
-      drawCallback (true);
-      drawBoxes();
+      // redraw damaged rects, clipped to them
+      float damageArea = 0.f;
+      for (auto& damageRect : damageRects) {
+        setClip (damageRect);
+        drawRectangle (bgndColor, damageRect);
+        drawCallback (true);
+        drawBoxes (damageRect);
+        damageArea += damageRect.area();
+        }
+      resetClip();
 
       if (drawPerf) {
         int64_t renderUs = duration_cast<microseconds>(system_clock::now() - time).count();
         drawRectangle (kGreen, {0.f, (float)getHeight() - 4.f, (frameUs * getWidth())/ 100000.f, (float)getHeight()});
         drawRectangle (kYellow, {0.f, (float)getHeight() - 4.f, (renderUs * getWidth())/ 100000.f, (float)getHeight()});
-        drawText (perfColor, {0.f, getHeight() - getBoxHeight(), (float)getWidth(), getBoxHeight()},
-                  fmt::format ("{:05d}:{:05d}us {} chars", renderUs, frameUs, getNumFontChars()));
+        drawText (perfColor, perfRect,
+                  fmt::format ("{:05d}:{:05d}us {} chars {} rects {:3.0f}%",
+                               renderUs, frameUs, getNumFontChars(),
+                               damageRects.size(), (damageArea * 100.f) / (getWidth() * getHeight())));
         }
 
-      mMiniFB->updatePixels (getPixels());
+      mMiniFB->updatePixels (getPixels(), damageRects);
       frameUs = duration_cast<microseconds>(system_clock::now() - time).count();
       }
     else {
@@ -208,3 +242,45 @@ void cWindow::uiLoop (bool useChanged, bool drawPerf,
     }
   }
 //}}}
+
+// private
+//{{{
+void cWindow::addDamage (vector<cRect>& damageRects, cRect rect) {
+// add rect rounded out to whole pixels, merge with any it overlaps
+// - collapse to single bounding rect if too many
+
+  rect = cRect (floorf (rect.left), floorf (rect.top), ceilf (rect.right), ceilf (rect.bottom));
+
+  auto it = damageRects.begin();
+  while (it != damageRects.end()) {
+    if (!(*it & rect).empty()) {
+      // merged rect may now overlap earlier rects, restart
+      rect |= *it;
+      damageRects.erase (it);
+      it = damageRects.begin();
+      }
+    else
+      ++it;
+    }
+  damageRects.push_back (rect);
+
+  if (damageRects.size() > kMaxDamageRects) {
+    cRect boundingRect;
+    for (auto& damageRect : damageRects)
+      boundingRect |= damageRect;
+    damageRects.clear();
+    damageRects.push_back (boundingRect);
+    }
+  }
+//}}}
+//{{{
+vector<cRect> cWindow::getDamage() {
+// take damaged rects
+
+  unique_lock<mutex> lock (mDamageMutex);
+
+  vector<cRect> damageRects;
+  damageRects.swap (mDamageRects);
+  return damageRects;
+  }
+//}}}
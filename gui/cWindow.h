@@ -6,6 +6,9 @@
 #include <chrono>
 #include <thread>
 #include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 #include "../common/basicTypes.h"
 
@@ -57,6 +60,7 @@ public:
   bool getControl() const { return mControlKeyDown; }
 
   uint64_t& getRenderUs() { return mRenderUs; }
+  uint64_t getFrameNum() const { return mFrameNum; }
 
   bool getFullScreen() const { return mFullScreen; }
   bool getExit() const { return mExit; }
@@ -70,7 +74,8 @@ public:
   void setExit() { mExit = true; }
 
   // actions
-  void changed() { mChanged = true; }
+  void changed() { changed (cRect (getSize())); }
+  void changed (const cRect& rect);
   void keyChanged() { mCursorDown = mCursorCountDown; }
   void cursorChanged() { mCursorDown = mCursorCountDown; }
   void resized();
@@ -165,6 +170,7 @@ public:
     cBox* togglePin() { mPin = !mPin;  return this; }
 
     void setSelfSize() { mSelfSize = true; }
+    cBox* setTimedOn (bool timedOn) { mTimedOn = timedOn; return this; }
     //}}}
     void toTop() { mWindow.toTop (this); }
 
@@ -251,7 +257,8 @@ public:
     virtual void draw() = 0;
 
   protected:
-    void changed() { mWindow.changed(); }
+    void changed() { mWindow.changed (mRect); }
+    void changed (const cRect& rect) { mWindow.changed (rect); }
 
     // draws
     //{{{
@@ -559,19 +566,43 @@ private:
     }
   //}}}
   //{{{
-  void drawBoxes() {
+  void tickBoxes() {
+  // tick damages timedOn boxes, whole window if there are none
+
+    bool timed = false;
     for (auto& box : mBackgroundBoxes)
-      if (box->getShow())
-        box->draw();
+      if (box->getShow() && box->getTimedOn()) {
+        changed (box->getRect());
+        timed = true;
+        }
 
     for (auto& box : mBoxes)
-      if (box->getShow())
+      if (box->getShow() && box->getTimedOn()) {
+        changed (box->getRect());
+        timed = true;
+        }
+
+    if (!timed)
+      changed();
+    }
+  //}}}
+  //{{{
+  void drawBoxes (const cRect& rect) {
+  // draw only boxes intersecting damaged rect, texture clip set to rect
+
+    for (auto& box : mBackgroundBoxes)
+      if (box->getShow() && !(box->getRect() & rect).empty())
         box->draw();
 
-    mChanged = false;
+    for (auto& box : mBoxes)
+      if (box->getShow() && !(box->getRect() & rect).empty())
+        box->draw();
     }
   //}}}
 
+  static void addDamage (std::vector<cRect>& damageRects, cRect rect);
+  std::vector<cRect> getDamage();
+
   //{{{  static const
   static constexpr float kOutlineWidth = 2.f;
   static constexpr float kRoundRadius = 4.f;
@@ -579,6 +610,8 @@ private:
   static constexpr float kBoxHeight = 20.f;
   static constexpr float kConsoleHeight = 12.f;
 
+  static constexpr size_t kMaxDamageRects = 8;
+
   inline static const cPoint kTextOffset = {2.f,-1.f};
   //}}}
   //{{{  static vars
@@ -618,14 +651,17 @@ private:
   bool mShiftKeyDown = false;
   bool mControlKeyDown = false;
 
-  // render
-  bool mChanged = true;
+  // render, damaged rects since last render
+  std::mutex mDamageMutex;
+  std::vector<cRect> mDamageRects;
+  std::atomic<bool> mTicked = false;
   bool mCursorOn = true;
 
   uint32_t mCursorDown = 50;
   uint32_t mCursorCountDown = 50;
 
   uint64_t mRenderUs = 0;
+  uint64_t mFrameNum = 0;
   bool mExitDone = false;
 
   // screen
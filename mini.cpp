@@ -22,6 +22,7 @@
 #include "paint/cPaint.h"
 
 #include "song/cSongLoaderBox.h"
+#include "song/cSongPlayer.h"
 
 #include "tiledMap/cTiledMap.h"
 #include "tiledMap/cTiledMapBox.h"
@@ -99,19 +100,28 @@ public:
       //}}}
 
     //{{{  create radio songLoader, gui
-    function <void (int64_t)> playCallback = [&](int64_t pts) {(void)pts; changed();};
+    function <void (int64_t)> playCallback = [&](int64_t pts) {
+      // play only damages songLoaderBox rect, wherever it is placed
+      (void)pts;
+      cSongLoaderBox* songLoaderBox = mSongLoaderBox;
+      if (songLoaderBox)
+        changed (songLoaderBox->getRect());
+      };
 
     const vector<string> kRadio3 = {"r3", "a320"};
     mRadioBoxes.push_back (add (new cTextBgndBox (*this, 6,1, "radio3", [&]() {
         //{{{  lambda
         if (mSongLoader) {
-          removeBox (mSongLoaderBox);
-          delete mSongLoaderBox;
+          // stop playCallback before deleting box it damages
+          cSongLoaderBox* songLoaderBox = mSongLoaderBox;
           mSongLoaderBox = nullptr;
 
           mSongLoader->exit();
           delete mSongLoader;
           mSongLoader = nullptr;
+
+          removeBox (songLoaderBox);
+          delete songLoaderBox;
           }
 
         mSongLoader = new cSongLoader();
@@ -127,13 +137,16 @@ public:
     mRadioBoxes.push_back (addBelow (new cTextBgndBox (*this, 6,1, "radio4", [&]() {
       //{{{  lambda
       if (mSongLoader) {
-        removeBox(mSongLoaderBox);
-        delete mSongLoaderBox;
+        // stop playCallback before deleting box it damages
+        cSongLoaderBox* songLoaderBox = mSongLoaderBox;
         mSongLoaderBox = nullptr;
 
         mSongLoader->exit();
         delete mSongLoader;
         mSongLoader = nullptr;
+
+        removeBox (songLoaderBox);
+        delete songLoaderBox;
         }
 
       mSongLoader = new cSongLoader();
@@ -148,13 +161,16 @@ public:
     mRadioBoxes.push_back (addBelow (new cTextBgndBox (*this, 6,1, "radio6", [&]() {
       //{{{  lambda
       if (mSongLoader) {
-        removeBox (mSongLoaderBox);
-        delete mSongLoaderBox;
+        // stop playCallback before deleting box it damages
+        cSongLoaderBox* songLoaderBox = mSongLoaderBox;
         mSongLoaderBox = nullptr;
 
         mSongLoader->exit();
         delete mSongLoader;
         mSongLoader = nullptr;
+
+        removeBox (songLoaderBox);
+        delete songLoaderBox;
         }
 
       mSongLoader = new cSongLoader();
@@ -176,7 +192,7 @@ public:
     #endif
     add (new cWindowBox (*this, 3,1), -3,0);
 
-    uiLoop (false, true, kBlack, kWhite);
+    uiLoop (true, true, kBlack, kWhite);
     }
   //}}}
 protected:
@@ -207,7 +223,7 @@ private:
   // song
   vector <cBox*> mRadioBoxes;
   cSongLoader* mSongLoader = nullptr;
-  cSongLoaderBox* mSongLoaderBox = nullptr;
+  atomic <cSongLoaderBox*> mSongLoaderBox = nullptr;
   };
 
 // main
@@ -247,6 +263,8 @@ private:
     string fileRoot = "../piccies/burger.jpg";    // launched in build/
   #endif
   string tiledMapApiKey;
+  string audioOutput = "default";
+  int audioLatencyMs = 40;
   //{{{  parse params to command line options
   for (auto it = params.begin(); it < params.end();) {
     if (*it == "log1") { logLevel = LOGINFO1; ++it; }
@@ -254,6 +272,8 @@ private:
     else if (*it == "log3") { logLevel = LOGINFO3; ++it; }
     else if (*it == "full") { fullScreen = true; ++it; }
     else if (*it == "map") { ++it; tiledMapApiKey = *it; ++it; }
+    else if (*it == "audio") { ++it; audioOutput = *it; ++it; }
+    else if (*it == "latency") { ++it; audioLatencyMs = stoi (*it); ++it; }
     else { fileRoot = *it; ++it; }
     };
   //}}}
@@ -264,6 +284,7 @@ private:
     cLog::init (logLevel, false);
   #endif
   cLog::log (LOGNOTICE, fmt::format ("mini"));
+  cSongPlayer::setAudioOutput (audioOutput, audioLatencyMs);
 
   cMiniWindow window;
   window.run ("mini", fileRoot, tiledMapApiKey, 1s, fullScreen);
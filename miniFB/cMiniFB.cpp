@@ -4,6 +4,8 @@
 //{{{  includes
 #include "cMiniFB.h"
 #include <vector>
+#include <cstdio>
+#include <cstring>
 
 #ifdef _WIN32
   #include <windowsx.h>
@@ -30,6 +32,20 @@
 #endif
 
 #define RGBA 0x1908  // [ Core in gl 1.0, gles1 1.0, gles2 2.0, glsc2 2.0 ]
+//{{{  pixel buffer object defines, [ Core in gl 2.1 ]
+#ifndef GL_PIXEL_UNPACK_BUFFER
+  #define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+  #define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+  #define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef APIENTRY
+  #define APIENTRY
+#endif
+//}}}
 
 #include "fmt/format.h"
 #include "../common/cLog.h"
@@ -738,6 +754,52 @@ namespace {
   #endif
 
   tGlSwapIntervalProc gSwapInterval = 0;
+  //{{{  pixel buffer object funcs
+  typedef void (APIENTRY* tGlGenBuffersProc) (GLsizei n, GLuint* buffers);
+  typedef void (APIENTRY* tGlDeleteBuffersProc) (GLsizei n, const GLuint* buffers);
+  typedef void (APIENTRY* tGlBindBufferProc) (GLenum target, GLuint buffer);
+  typedef void (APIENTRY* tGlBufferDataProc) (GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+  typedef void* (APIENTRY* tGlMapBufferProc) (GLenum target, GLenum access);
+  typedef GLboolean (APIENTRY* tGlUnmapBufferProc) (GLenum target);
+
+  tGlGenBuffersProc gGenBuffers = 0;
+  tGlDeleteBuffersProc gDeleteBuffers = 0;
+  tGlBindBufferProc gBindBuffer = 0;
+  tGlBufferDataProc gBufferData = 0;
+  tGlMapBufferProc gMapBuffer = 0;
+  tGlUnmapBufferProc gUnmapBuffer = 0;
+
+  //{{{
+  void* getGLproc (const char* name) {
+
+    #ifdef _WIN32
+      return (void*)wglGetProcAddress (name);
+    #else
+      return (void*)glXGetProcAddress ((const GLubyte*)name);
+    #endif
+    }
+  //}}}
+  //{{{
+  bool loadPboFuncs() {
+  // pbo core in openGL 2.1, llvmpipe software GL reports much higher
+
+    int major = 0;
+    int minor = 0;
+    const char* version = (const char*)glGetString (GL_VERSION);
+    if (!version || (sscanf (version, "%d.%d", &major, &minor) != 2) || ((major * 10) + minor < 21))
+      return false;
+
+    gGenBuffers = (tGlGenBuffersProc)getGLproc ("glGenBuffers");
+    gDeleteBuffers = (tGlDeleteBuffersProc)getGLproc ("glDeleteBuffers");
+    gBindBuffer = (tGlBindBufferProc)getGLproc ("glBindBuffer");
+    gBufferData = (tGlBufferDataProc)getGLproc ("glBufferData");
+    gMapBuffer = (tGlMapBufferProc)getGLproc ("glMapBuffer");
+    gUnmapBuffer = (tGlUnmapBufferProc)getGLproc ("glUnmapBuffer");
+
+    return gGenBuffers && gDeleteBuffers && gBindBuffer && gBufferData && gMapBuffer && gUnmapBuffer;
+    }
+  //}}}
+  //}}}
   //{{{
   bool hasGLextension (const char* name) {
   // TODO: This is deprecated on OpenGL 3+.
@@ -1043,6 +1105,25 @@ eMiniState cMiniFB::updatePixels (void* pixels) {
   if (!pixels)
     return STATE_INVALID_BUFFER;
 
+  mDirtyRects.clear();
+  redrawGL (pixels);
+
+  return STATE_OK;
+  }
+//}}}
+//{{{
+eMiniState cMiniFB::updatePixels (void* pixels, const vector<cRect>& dirtyRects) {
+// update only dirtyRects of pixels, rest unchanged since last update
+
+  if (mClosed) {
+    freeResources();
+    return STATE_EXIT;
+    }
+
+  if (!pixels)
+    return STATE_INVALID_BUFFER;
+
+  mDirtyRects = dirtyRects;
   redrawGL (pixels);
 
   return STATE_OK;
@@ -1794,6 +1875,7 @@ bool cMiniFB::init (const string& title, uint32_t width, uint32_t height, uint32
 
   mPixelsWidth  = width;
   mPixelsHeight = height;
+  mAllowPbo = !(flags & WF_NO_PBO);
 
   #ifdef _WIN32
     //{{{  windows
@@ -2436,6 +2518,16 @@ bool cMiniFB::initGL() {
   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+  // allocate texture storage once, updatePixels only uploads into it
+  glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, mPixelsWidth, mPixelsHeight, 0, RGBA, GL_UNSIGNED_BYTE, NULL);
+
+  if (mAllowPbo && loadPboFuncs()) {
+    gGenBuffers (2, mPboIds);
+    cLog::log (LOGINFO, "using pixel buffer object texture upload");
+    }
+  else
+    cLog::log (LOGINFO, "using glTexSubImage2D texture upload");
+
   glEnableClientState (GL_VERTEX_ARRAY);
   glEnableClientState (GL_TEXTURE_COORD_ARRAY);
 
@@ -2487,14 +2579,11 @@ void cMiniFB::redrawGL (const void* pixels) {
     glXMakeCurrent (mDisplay, mWindow, mGLXContext);
   #endif
 
-  GLenum format = RGBA;
-
   // clear
   //glClear (GL_COLOR_BUFFER_BIT);
 
   glBindTexture (GL_TEXTURE_2D, mTextureId);
-  glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, mPixelsWidth, mPixelsHeight, 0, format, GL_UNSIGNED_BYTE, pixels);
-  //glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, buffer_width, buffer_height, format, GL_UNSIGNED_BYTE, pixels);
+  uploadGL (pixels);
 
   // draw single texture
   glEnableClientState (GL_VERTEX_ARRAY);
@@ -2526,8 +2615,73 @@ void cMiniFB::redrawGL (const void* pixels) {
   }
 //}}}
 //{{{
+void cMiniFB::uploadGL (const void* pixels) {
+// upload mDirtyRects of pixels, or all if none, into allocated texture
+// - through alternate pbo if we have them, mapped pbo packs rects, orphaned to avoid waiting on last upload
+
+  vector<cRect> rects;
+  for (auto& dirtyRect : mDirtyRects) {
+    cRect rect = dirtyRect & cRect ((float)mPixelsWidth, (float)mPixelsHeight);
+    if (!rect.empty())
+      rects.push_back (rect);
+    }
+  if (mDirtyRects.empty())
+    rects.push_back (cRect ((float)mPixelsWidth, (float)mPixelsHeight));
+
+  uint8_t* mapped = nullptr;
+  if (mPboIds[0]) {
+    mPboIndex = (mPboIndex + 1) % 2;
+    gBindBuffer (GL_PIXEL_UNPACK_BUFFER, mPboIds[mPboIndex]);
+    gBufferData (GL_PIXEL_UNPACK_BUFFER, mPixelsWidth * mPixelsHeight * 4, NULL, GL_STREAM_DRAW);
+    mapped = (uint8_t*)gMapBuffer (GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (!mapped)
+      gBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+  if (mapped) {
+    // copy rects packed into pbo, then upload from pbo offsets
+    vector<size_t> offsets;
+    size_t offset = 0;
+    for (auto& rect : rects) {
+      offsets.push_back (offset);
+      size_t rowBytes = rect.getWidthInt32() * 4;
+      const uint8_t* src = (const uint8_t*)pixels + (((rect.getTopInt32() * mPixelsWidth) + rect.getLeftInt32()) * 4);
+      for (int32_t y = 0; y < rect.getHeightInt32(); y++) {
+        memcpy (mapped + offset, src, rowBytes);
+        src += mPixelsWidth * 4;
+        offset += rowBytes;
+        }
+      }
+    gUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+
+    for (size_t i = 0; i < rects.size(); i++)
+      glTexSubImage2D (GL_TEXTURE_2D, 0, rects[i].getLeftInt32(), rects[i].getTopInt32(),
+                       rects[i].getWidthInt32(), rects[i].getHeightInt32(),
+                       RGBA, GL_UNSIGNED_BYTE, (const void*)offsets[i]);
+
+    gBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+  else {
+    // upload rects directly from pixels, using row length to stride
+    glPixelStorei (GL_UNPACK_ROW_LENGTH, mPixelsWidth);
+    for (auto& rect : rects)
+      glTexSubImage2D (GL_TEXTURE_2D, 0, rect.getLeftInt32(), rect.getTopInt32(),
+                       rect.getWidthInt32(), rect.getHeightInt32(), RGBA, GL_UNSIGNED_BYTE,
+                       (const uint8_t*)pixels + (((rect.getTopInt32() * mPixelsWidth) + rect.getLeftInt32()) * 4));
+    glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+    }
+  }
+//}}}
+//{{{
 void cMiniFB::destroyGLcontext() {
 
+  if (mPboIds[0] && gDeleteBuffers) {
+    gDeleteBuffers (2, mPboIds);
+    mPboIds[0] = 0;
+    mPboIds[1] = 0;
+    }
+
   #ifdef _WIN32
     // windows
     if (mHGLRC) {
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <functional>
+#include <vector>
 
 #ifdef _WIN32
   #define NOMINMAX
@@ -22,7 +23,8 @@ enum eMiniFlags {
   WF_FULLSCREEN         = 0x02,
   WF_FULLSCREEN_DESKTOP = 0x04,
   WF_BORDERLESS         = 0x08,
-  WF_ALWAYS_ON_TOP      = 0x10 };
+  WF_ALWAYS_ON_TOP      = 0x10,
+  WF_NO_PBO             = 0x20 }; // upload with glTexSubImage2D only, no pixel buffer objects
 //}}}
 //{{{
 enum eMiniState {
@@ -206,6 +208,7 @@ public:
   static std::string getKeyName (eMiniKey key);
 
   eMiniState updatePixels (void* pixels);
+  eMiniState updatePixels (void* pixels, const std::vector<cRect>& dirtyRects);
   eMiniState updateEvents();
   void close() { mClosed = true; }
 
@@ -283,6 +286,7 @@ private:
   bool initGL();
   void resizeGL();
   void redrawGL (const void* pixels);
+  void uploadGL (const void* pixels);
   void destroyGLcontext();
   //}}}
   void resizeDst (uint32_t width, uint32_t height);
@@ -359,7 +363,15 @@ private:
   uint32_t mPixelsWidth = 0;
   uint32_t mPixelsHeight = 0;
 
+  // pixels buffer dirty rects, empty for whole buffer
+  std::vector<cRect> mDirtyRects;
+
   // openGL texture
   uint32_t mTextureId;
+
+  // openGL double buffered pixel buffer objects, 0 if unused
+  bool mAllowPbo = true;
+  uint32_t mPboIds[2] = { 0, 0 };
+  uint32_t mPboIndex = 0;
   //}}}
   };
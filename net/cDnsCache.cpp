@@ -0,0 +1,265 @@
+// cDnsCache.cpp - process wide thread safe getaddrinfo cache
+//{{{  includes
+#include "cDnsCache.h"
+
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+
+#ifndef _WIN32
+  #include <netdb.h>
+  #include <netinet/in.h>
+  #include <arpa/inet.h>
+#endif
+
+#include "fmt/format.h"
+#include "../common/cLog.h"
+
+using namespace std;
+//}}}
+
+namespace {
+  //{{{
+  class cEntry {
+  public:
+    bool mResolving = false;
+    bool mOk = false;
+    vector <cDnsCache::cAddress> mAddresses;
+    chrono::steady_clock::time_point mExpiry;
+    };
+  //}}}
+
+  mutex gMutex;
+  condition_variable gCondition;
+  map <string, cEntry> gEntries;
+  map <string, vector <string>> gHostsTable;
+
+  chrono::seconds gTtl = 300s;
+  chrono::seconds gFailTtl = 10s;
+
+  int64_t gHits = 0;
+  int64_t gMisses = 0;
+  int64_t gWaits = 0;
+
+  //{{{
+  bool isLiteral (const string& name) {
+  // ipv4 or ipv6 address literal, needs no resolver
+
+    uint8_t addr[sizeof(in6_addr)];
+    return (inet_pton (AF_INET, name.c_str(), addr) == 1) || (inet_pton (AF_INET6, name.c_str(), addr) == 1);
+    }
+  //}}}
+  //{{{
+  bool lookup (const string& hostName, const vector <string>* literals, vector <cDnsCache::cAddress>& addresses) {
+  // getaddrinfo hostName, or each literal address of an injected hostsTable entry, unlocked
+  // - bracketed ipv6 literal as in a url host, [::1], looked up without its brackets
+
+    vector <string> names;
+    if (literals)
+      names = *literals;
+    else if ((hostName.size() > 2) && (hostName.front() == '[') && (hostName.back() == ']'))
+      names.push_back (hostName.substr (1, hostName.size() - 2));
+    else
+      names.push_back (hostName);
+
+    for (auto& name : names) {
+      struct addrinfo hints;
+      memset (&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = (literals || isLiteral (name)) ? AI_NUMERICHOST : AI_ADDRCONFIG;
+
+      struct addrinfo* result = nullptr;
+      int error = getaddrinfo (name.c_str(), nullptr, &hints, &result);
+      if (error) {
+        cLog::log (LOGERROR, fmt::format ("cDnsCache getaddrinfo {} {}", name, gai_strerror (error)));
+        continue;
+        }
+
+      for (struct addrinfo* info = result; info; info = info->ai_next) {
+        if ((info->ai_family != AF_INET) && (info->ai_family != AF_INET6))
+          continue;
+
+        cDnsCache::cAddress address;
+        address.mFamily = info->ai_family;
+        address.mLength = (socklen_t)info->ai_addrlen;
+        memcpy (&address.mSockAddr, info->ai_addr, info->ai_addrlen);
+        addresses.push_back (address);
+        }
+
+      freeaddrinfo (result);
+      }
+
+    return !addresses.empty();
+    }
+  //}}}
+  }
+
+// cDnsCache::cAddress
+//{{{
+string cDnsCache::cAddress::getString() const {
+
+  char str[INET6_ADDRSTRLEN] = { 0 };
+  if (mFamily == AF_INET6) {
+    auto sockAddr = (const sockaddr_in6*)&mSockAddr;
+    inet_ntop (AF_INET6, (void*)&sockAddr->sin6_addr, str, sizeof(str));
+    return fmt::format ("[{}]:{}", str, ntohs (sockAddr->sin6_port));
+    }
+
+  auto sockAddr = (const sockaddr_in*)&mSockAddr;
+  inet_ntop (AF_INET, (void*)&sockAddr->sin_addr, str, sizeof(str));
+  return fmt::format ("{}:{}", str, ntohs (sockAddr->sin_port));
+  }
+//}}}
+
+// cDnsCache
+//{{{
+bool cDnsCache::resolve (const string& hostName, uint16_t port, vector <cAddress>& addresses) {
+
+  addresses.clear();
+
+  unique_lock<mutex> lock (gMutex);
+
+  bool waited = false;
+  while (true) {
+    auto it = gEntries.find (hostName);
+    if (it != gEntries.end()) {
+      cEntry& entry = it->second;
+      if (entry.mResolving) {
+        // another thread is looking it up, wait for its result
+        if (!waited)
+          gWaits++;
+        waited = true;
+        gCondition.wait (lock);
+        continue;
+        }
+
+      if (chrono::steady_clock::now() < entry.mExpiry) {
+        // fresh, ok or failed
+        if (!waited)
+          gHits++;
+        addresses = entry.mAddresses;
+        break;
+        }
+      }
+
+    //{{{  missing or expired, lookup unlocked, others wait on mResolving
+    gMisses++;
+    gEntries[hostName].mResolving = true;
+
+    vector <string> literals;
+    auto hostsIt = gHostsTable.find (hostName);
+    bool injected = hostsIt != gHostsTable.end();
+    if (injected)
+      literals = hostsIt->second;
+
+    lock.unlock();
+    vector <cAddress> lookupAddresses;
+    bool ok = lookup (hostName, injected ? &literals : nullptr, lookupAddresses);
+    lock.lock();
+
+    // re find, entry reference not held across unlock
+    cEntry& entry = gEntries[hostName];
+    entry.mResolving = false;
+    entry.mOk = ok;
+    entry.mAddresses = lookupAddresses;
+    entry.mExpiry = chrono::steady_clock::now() + (ok ? gTtl : gFailTtl);
+    gCondition.notify_all();
+
+    for (auto& address : lookupAddresses)
+      cLog::log (LOGINFO, fmt::format ("cDnsCache {} - {}", hostName, address.getString()));
+
+    addresses = lookupAddresses;
+    break;
+    //}}}
+    }
+
+  lock.unlock();
+
+  // set port
+  for (auto& address : addresses)
+    if (address.mFamily == AF_INET6)
+      ((sockaddr_in6*)&address.mSockAddr)->sin6_port = htons (port);
+    else
+      ((sockaddr_in*)&address.mSockAddr)->sin_port = htons (port);
+
+  return !addresses.empty();
+  }
+//}}}
+//{{{
+void cDnsCache::invalidate (const string& hostName) {
+// drop entry, next resolve looks up again
+
+  unique_lock<mutex> lock (gMutex);
+
+  auto it = gEntries.find (hostName);
+  if ((it != gEntries.end()) && !it->second.mResolving)
+    gEntries.erase (it);
+  }
+//}}}
+//{{{
+void cDnsCache::clear() {
+
+  unique_lock<mutex> lock (gMutex);
+
+  // keep entries being resolved, their waiters need them
+  for (auto it = gEntries.begin(); it != gEntries.end();)
+    if (it->second.mResolving)
+      ++it;
+    else
+      it = gEntries.erase (it);
+
+  gHits = 0;
+  gMisses = 0;
+  gWaits = 0;
+  }
+//}}}
+
+//{{{
+void cDnsCache::setTtl (chrono::seconds ttl, chrono::seconds failTtl) {
+
+  unique_lock<mutex> lock (gMutex);
+  gTtl = ttl;
+  gFailTtl = failTtl;
+  }
+//}}}
+//{{{
+void cDnsCache::setHostsTable (const map <string, vector <string>>& hostsTable) {
+// injected name to literal addresses, drops cached entries they replace
+
+  unique_lock<mutex> lock (gMutex);
+
+  gHostsTable = hostsTable;
+  for (auto& host : hostsTable) {
+    auto it = gEntries.find (host.first);
+    if ((it != gEntries.end()) && !it->second.mResolving)
+      gEntries.erase (it);
+    }
+  }
+//}}}
+
+//{{{
+int64_t cDnsCache::getHits() {
+  unique_lock<mutex> lock (gMutex);
+  return gHits;
+  }
+//}}}
+//{{{
+int64_t cDnsCache::getMisses() {
+  unique_lock<mutex> lock (gMutex);
+  return gMisses;
+  }
+//}}}
+//{{{
+int64_t cDnsCache::getWaits() {
+  unique_lock<mutex> lock (gMutex);
+  return gWaits;
+  }
+//}}}
+//{{{
+string cDnsCache::getInfoString() {
+
+  unique_lock<mutex> lock (gMutex);
+  return fmt::format ("dns hosts:{} hits:{} misses:{} waits:{}", gEntries.size(), gHits, gMisses, gWaits);
+  }
+//}}}
@@ -0,0 +1,50 @@
+// cDnsCache.h - process wide thread safe getaddrinfo cache
+// - entries live for a ttl, failures for a shorter ttl
+// - concurrent lookups of the same host wait on the first one
+// - injected hosts table resolves name to literal addresses offline
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#ifdef _WIN32
+  #define _WINSOCK_DEPRECATED_NO_WARNINGS
+  #define WIN32_LEAN_AND_MEAN
+  #include <winsock2.h>
+  #include <WS2tcpip.h>
+#else
+  #include <sys/socket.h>
+#endif
+//}}}
+
+class cDnsCache {
+public:
+  //{{{
+  class cAddress {
+  public:
+    std::string getString() const;
+
+    int mFamily = 0;
+    socklen_t mLength = 0;
+    sockaddr_storage mSockAddr = {};
+    };
+  //}}}
+
+  // resolve hostName to addresses with port set, ipv6 and ipv4 in getaddrinfo preference order
+  // - address literals, ipv6 bracketed or not, resolve without the resolver
+  static bool resolve (const std::string& hostName, uint16_t port, std::vector <cAddress>& addresses);
+  static void invalidate (const std::string& hostName);
+  static void clear();
+
+  static void setTtl (std::chrono::seconds ttl, std::chrono::seconds failTtl);
+  static void setHostsTable (const std::map <std::string, std::vector <std::string>>& hostsTable);
+
+  // stats
+  static int64_t getHits();
+  static int64_t getMisses();
+  static int64_t getWaits();
+  static std::string getInfoString();
+  };
@@ -1,6 +1,9 @@
 // cHttp.cpp - http base class based on tinyHttp parser
 //{{{  includes
 #include "cHttp.h"
+#include "cDnsCache.h"
+
+#include <algorithm>
 
 #include "fmt/format.h"
 #include "../common/cLog.h"
@@ -18,6 +21,7 @@
   #include <sys/types.h>
   #include <sys/socket.h>
   #include <netinet/in.h>
+  #include <netinet/tcp.h>
   #include <netdb.h>
   #include <arpa/inet.h>
 #endif
@@ -26,7 +30,7 @@ using namespace std;
 //}}}
 
 constexpr int kInitialHeaderBufferSize = 256;
-constexpr int kRecvBufferSize = 2048;
+constexpr int kDefaultRecvBufferSize = 0x10000;
 
 namespace {
   //{{{
@@ -63,6 +67,7 @@ cHttp::cHttp() {
 
   mHeaderBuffer = (char*)malloc (kInitialHeaderBufferSize);
   mHeaderBufferAllocSize = kInitialHeaderBufferSize;
+  mRecvBufferSize = kDefaultRecvBufferSize;
 
   initialise();
   }
@@ -70,8 +75,10 @@ cHttp::cHttp() {
 //{{{
 cHttp::~cHttp() {
 
-  free (mContent);
+  freeContent();
   free (mHeaderBuffer);
+  free (mRecvBuffer);
+  free (mSlice);
   }
 //}}}
 
@@ -102,11 +109,25 @@ int cHttp::get (const string& host, const string& path,
                    "\r\n";
 
   if (getSend (request)) {
-    uint8_t buffer[kRecvBufferSize];
+    if (!mRecvBuffer)
+      mRecvBuffer = (uint8_t*)malloc (mRecvBufferSize);
+
     bool needMoreData = true;
     while (needMoreData) {
-      auto bufferPtr = buffer;
-      auto bufferBytesReceived = getRecv (buffer, sizeof(buffer));
+      if (!mStreamSliceSize && ((mState == eExpectedData) || (mState == eChunkData))) {
+        //{{{  fast path, headers known, recv body straight into reserved content, no parser
+        uint8_t* content = mContent + mContentReceivedSize;
+        int bytesReceived = getRecv (content, mContentLengthLeft);
+        if (bytesReceived <= 0)
+          break;
+
+        needMoreData = body (content, bytesReceived, dataCallback);
+        continue;
+        }
+        //}}}
+
+      auto bufferPtr = mRecvBuffer;
+      auto bufferBytesReceived = getRecv (mRecvBuffer, mRecvBufferSize);
       if (bufferBytesReceived <= 0)
         break;
 
@@ -118,6 +139,16 @@ int cHttp::get (const string& host, const string& path,
         bufferPtr += bytesReceived;
         }
       }
+
+    if (mSliceFill) {
+      // last short slice
+      dataCallback (mSlice, mSliceFill);
+      mSliceFill = 0;
+      }
+
+    if (!getKeepAlive())
+      // server closes, next get reconnects
+      closeSocket();
     }
 
   return mResponse;
@@ -141,10 +172,117 @@ string cHttp::getRedirect (const string& host, const string& path) {
   }
 //}}}
 //{{{
+int cHttp::getPipelined (const string& host, const vector <string>& paths, int depth,
+                         const function<void (size_t index, int response)>& responseCallback,
+                         const string& header) {
+// send up to depth GETs ahead on one keep-alive connection, responseCallback each response in order
+// - content valid during responseCallback
+// - server close, connection: close or bad response, resend unanswered tail on new connection
+// - give up after two connections answer nothing, responseCallback -5 for the rest
+// - return number of responses
+
+  if (!mRecvBuffer)
+    mRecvBuffer = (uint8_t*)malloc (mRecvBufferSize);
+
+  auto headerCallback = [](const string& key, const string& value) { (void)key; (void)value; };
+  auto dataCallback = [](const uint8_t* data, int length) { (void)data; (void)length; return true; };
+
+  size_t answered = 0;
+  int fruitless = 0;
+  while ((answered < paths.size()) && (fruitless < 2)) {
+    size_t answeredBefore = answered;
+
+    clear();
+    if (connectToHost (host))
+      break;
+
+    size_t sent = answered;
+    size_t answeredConnect = answered;
+    bool closing = false;
+    while (!closing && (answered < paths.size())) {
+      //{{{  top up requests in flight, one send
+      string requests;
+      while ((sent < paths.size()) && (int(sent - answered) < depth))
+        requests += "GET /" + paths[sent++] + " HTTP/1.1\r\n" +
+                    "Host: " + host + "\r\n" +
+                    (header.empty() ? "" : (header + "\r\n")) +
+                    "\r\n";
+
+      if (!requests.empty() && !getSend (requests))
+        break;
+      //}}}
+
+      int bufferBytesReceived = getRecv (mRecvBuffer, mRecvBufferSize);
+      if (bufferBytesReceived <= 0) {
+        // closed, ends a close delimited response, resend the rest
+        if (mState == eStreamData)
+          responseCallback (answered++, mResponse);
+        break;
+        }
+
+      auto bufferPtr = mRecvBuffer;
+      while (bufferBytesReceived > 0) {
+        int bytesReceived;
+        bool needMoreData = parseData (bufferPtr, bufferBytesReceived, bytesReceived, headerCallback, dataCallback);
+        bufferBytesReceived -= bytesReceived;
+        bufferPtr += bytesReceived;
+
+        if (!needMoreData) {
+          // response done, next response parses from rest of buffer
+          responseCallback (answered++, mResponse);
+          if ((mState == eError) || !getKeepAlive()) {
+            // no more responses on this connection, drop rest
+            closing = true;
+            if (answered - answeredConnect == 1)
+              // server closes every time, stop wasting requests
+              depth = 1;
+            break;
+            }
+          clear();
+          }
+        }
+      }
+
+    if (closing || (answered < paths.size()))
+      closeSocket();
+
+    fruitless = (answered == answeredBefore) ? fruitless + 1 : 0;
+    }
+
+  size_t numAnswered = answered;
+  while (answered < paths.size())
+    responseCallback (answered++, -5);
+
+  return (int)numAnswered;
+  }
+//}}}
+//{{{
+uint8_t* cHttp::takeContent() {
+// hand content to caller, saves copying it, caller frees it unless it is their setContentBuffer buffer
+
+  uint8_t* content = getContent();
+  if (content) {
+    if (mContent == mUserContent) {
+      mUserContent = nullptr;
+      mUserContentSize = 0;
+      }
+
+    mContent = nullptr;
+    mContentAllocSize = 0;
+    mContentOwned = false;
+    }
+
+  return content;
+  }
+//}}}
+//{{{
 void cHttp::freeContent() {
 
-  free (mContent);
+  if (mContentOwned)
+    free (mContent);
   mContent = nullptr;
+  mContentAllocSize = 0;
+  mContentOwned = false;
 
   mHeaderContentLength = -1;
   mContentLengthLeft = 0;
@@ -154,6 +292,65 @@ void cHttp::freeContent() {
   }
 //}}}
 
+//{{{
+void cHttp::setRecvBufferSize (int size) {
+
+  free (mRecvBuffer);
+  mRecvBuffer = nullptr;
+  mRecvBufferSize = size;
+  }
+//}}}
+//{{{
+void cHttp::setContentBuffer (uint8_t* buffer, int size) {
+// caller buffer, bodies that fit recv straight into it, bigger bodies fall back to an owned buffer
+
+  if (mContent && !mContentOwned) {
+    mContent = nullptr;
+    mContentAllocSize = 0;
+    }
+
+  mUserContent = buffer;
+  mUserContentSize = buffer ? size : 0;
+  }
+//}}}
+//{{{
+void cHttp::setStreamSlice (int sliceSize) {
+// sliceSize > 0, body not stored, dataCallback gets sliceSize pieces, last one short
+
+  free (mSlice);
+  mStreamSliceSize = sliceSize;
+  mSlice = sliceSize ? (uint8_t*)malloc (sliceSize) : nullptr;
+  mSliceFill = 0;
+  }
+//}}}
+
+//{{{
+void cHttp::splitHost (const string& host, string& hostName, uint16_t& port) {
+
+  hostName = host;
+  port = 80;
+
+  size_t colon = string::npos;
+  if (!host.empty() && (host[0] == '[')) {
+    size_t bracket = host.find (']');
+    if (bracket != string::npos) {
+      hostName = host.substr (1, bracket - 1);
+      if ((bracket + 1 < host.size()) && (host[bracket + 1] == ':'))
+        colon = bracket + 1;
+      }
+    }
+  else if (host.find (':') == host.rfind (':')) {
+    // single colon, bare ipv6 literal has several
+    colon = host.find (':');
+    if (colon != string::npos)
+      hostName = host.substr (0, colon);
+    }
+
+  if (colon != string::npos)
+    port = (uint16_t)atoi (host.c_str() + colon + 1);
+  }
+//}}}
+
 // protected
 //{{{
 int cHttp::connectToHost (const string& host) {
@@ -167,64 +364,55 @@ int cHttp::connectToHost (const string& host) {
         close (mSocket);
       #endif
 
-    struct hostent* remoteHostEnt = gethostbyname (host.c_str());
-    if (!remoteHostEnt) {
+    string hostName;
+    uint16_t port;
+    splitHost (host, hostName, port);
+
+    vector <cDnsCache::cAddress> addresses;
+    if (!cDnsCache::resolve (hostName, port, addresses)) {
       //{{{  error, return
-      cLog::log (LOGERROR, "connectToHost - gethostbyname() failed");
+      cLog::log (LOGERROR, fmt::format ("connectToHost - resolve {} failed", hostName));
+      mSocket = 0;
       return 1;
       }
       //}}}
 
-    cLog::log (LOGINFO, fmt::format ("remoteName - {}", remoteHostEnt->h_name));
-
-    char** alias;
-    for (alias = remoteHostEnt->h_aliases; *alias; alias++)
-      cLog::log (LOGINFO, fmt::format ("- altName - {}", *alias));
-
-    switch (remoteHostEnt->h_addrtype) {
-      //{{{
-      case AF_INET: {
-        cLog::log (LOGINFO1, fmt::format ("- AF_INET len:{}", remoteHostEnt->h_length));
-
-        uint32_t i = 0;
-        while (remoteHostEnt->h_addr_list[i]) {
-          struct in_addr addr;
-          addr.s_addr = *(u_long *) remoteHostEnt->h_addr_list[i++];
-          cLog::log (LOGINFO, fmt::format ("- ip address {}", inet_ntoa(addr)));
-          }
+    // try addresses in resolver order
+    mSocket = 0;
+    for (auto& address : addresses) {
+      mSocket = (int)socket (address.mFamily, SOCK_STREAM, 0);
+      if (mSocket <= 0) {
+        //{{{  error, next
+        cLog::log (LOGERROR, "connectToHost - error opening socket");
+        mSocket = 0;
+        continue;
+        }
+        //}}}
 
+      if (connect (mSocket, (struct sockaddr*)&address.mSockAddr, address.mLength) == 0) {
+        // small requests, pipelined or not, go now
+        int noDelay = 1;
+        setsockopt (mSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+        cLog::log (LOGINFO, fmt::format ("connectToHost {} using socket {}", address.getString(), mSocket));
         break;
         }
-      //}}}
-      //{{{
-      default:
-        cLog::log (LOGINFO, fmt::format ("- addressType:{} len:{}",
-                                         remoteHostEnt->h_addrtype, remoteHostEnt->h_length));
-        break;
-      //}}}
-      }
 
-    struct sockaddr_in serveraddr;
-    memset (&serveraddr, 0, sizeof(sockaddr_in));
-    serveraddr.sin_family = AF_INET;
-    memcpy (&serveraddr.sin_addr.s_addr, remoteHostEnt->h_addr, remoteHostEnt->h_length);
-
-    mSocket = (int)socket (AF_INET, SOCK_STREAM, 0);
-    if (mSocket <= 0) {
-      //{{{  error, return
-      cLog::log (LOGERROR, "connectToHost - error opening socket");
-      return -2;
-      }
+      //{{{  error, close, next
+      cLog::log (LOGINFO, fmt::format ("connectToHost - error connecting {}", address.getString()));
+      #ifdef _WIN32
+        closesocket (mSocket);
+      #else
+        close (mSocket);
+      #endif
+      mSocket = 0;
       //}}}
-    cLog::log (LOGINFO, fmt::format ("- using socket {}", mSocket));
+      }
 
-    serveraddr.sin_port = htons (80);
-    if (connect (mSocket, (struct sockaddr*)&serveraddr, sizeof(serveraddr)) < 0) {
-      //{{{  error, return
-      cLog::log (LOGINFO, "connectToHost - Error Connecting");
+    if (!mSocket) {
+      // maybe stale, lookup again next time
+      cDnsCache::invalidate (hostName);
       return -2;
       }
-      //}}}
 
     mLastHost = host;
     }
@@ -278,9 +466,129 @@ void cHttp::clear() {
   mKeyLen = 0;
   mValueLen = 0;
 
-  freeContent();
+  // keep content buffer for next body
+  mHeaderContentLength = -1;
+  mContentLengthLeft = 0;
+  mContentReceivedSize = 0;
+  mContentState = eContentNone;
+  mSliceFill = 0;
 
   mResponse = 0;
+  mVersion = 0;
+  mConnection.clear();
+  }
+//}}}
+//{{{
+void cHttp::closeSocket() {
+
+  if (mSocket > 0)
+    #ifdef _WIN32
+      closesocket (mSocket);
+    #else
+      close (mSocket);
+    #endif
+
+  mSocket = 0;
+  }
+//}}}
+//{{{
+void cHttp::reserveContent (int size) {
+// room for size bytes of content, caller buffer if it fits, else owned buffer grown by doubling
+
+  if (mUserContent && (mContent != mUserContent) && (size <= mUserContentSize) && (mContentReceivedSize == 0)) {
+    // caller buffer first
+    if (mContentOwned)
+      free (mContent);
+    mContent = mUserContent;
+    mContentAllocSize = mUserContentSize;
+    mContentOwned = false;
+    return;
+    }
+
+  if (size <= mContentAllocSize)
+    return;
+
+  int allocSize = max (size, mContentAllocSize * 2);
+  if (mContentOwned && mContentReceivedSize)
+    mContent = (uint8_t*)realloc (mContent, allocSize);
+  else {
+    // nothing worth keeping, or copy out of caller buffer
+    uint8_t* content = (uint8_t*)malloc (allocSize);
+    if (mContentReceivedSize)
+      memcpy (content, mContent, mContentReceivedSize);
+    if (mContentOwned)
+      free (mContent);
+    mContent = content;
+    mContentOwned = true;
+    }
+
+  mContentAllocSize = allocSize;
+  }
+//}}}
+//{{{
+bool cHttp::body (const uint8_t* data, int length, const function<bool (const uint8_t* data, int len)>& dataCallback) {
+// length bytes of expected or chunk data, copied to content unless already recv'd there, or sliced when streaming
+// - return false when body done or refused
+
+  bool accepted;
+  if (mStreamSliceSize)
+    accepted = sliceBody (data, length, dataCallback);
+  else {
+    uint8_t* content = mContent + mContentReceivedSize;
+    if (data != content)
+      memcpy (content, data, length);
+    mContentReceivedSize += length;
+    accepted = dataCallback (content, length);
+    }
+
+  if (mStreamSliceSize)
+    mContentReceivedSize += length;
+  mContentLengthLeft -= length;
+
+  if (!accepted)
+    // refused data in callback, bomb out
+    mState = eClose;
+
+  else if (mContentLengthLeft == 0) {
+    if (mState == eExpectedData)
+      mState = eClose;
+    else {
+      // finished chunk, get ready for next chunk
+      mHeaderContentLength = 1;
+      mState = eChunkHeader;
+      }
+    }
+
+  return mState != eClose;
+  }
+//}}}
+//{{{
+bool cHttp::sliceBody (const uint8_t* data, int length, const function<bool (const uint8_t* data, int len)>& dataCallback) {
+// whole slices straight from data, partial slices gathered in mSlice
+
+  while (length > 0) {
+    if ((mSliceFill == 0) && (length >= mStreamSliceSize)) {
+      if (!dataCallback (data, mStreamSliceSize))
+        return false;
+      data += mStreamSliceSize;
+      length -= mStreamSliceSize;
+      continue;
+      }
+
+    int bytes = min (length, mStreamSliceSize - mSliceFill);
+    memcpy (mSlice + mSliceFill, data, bytes);
+    mSliceFill += bytes;
+    data += bytes;
+    length -= bytes;
+
+    if (mSliceFill == mStreamSliceSize) {
+      mSliceFill = 0;
+      if (!dataCallback (mSlice, mStreamSliceSize))
+        return false;
+      }
+    }
+
+  return true;
   }
 //}}}
 
@@ -388,6 +696,13 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
     switch (mState) {
       case eHeader:
         switch (parseHeaderChar (*data)) {
+          case eHeaderVersionCharacter:
+            //{{{  version char, HTTP/1.1 digits to 11
+            if ((*data >= '0') && (*data <= '9'))
+              mVersion = mVersion * 10 + *data - '0';
+
+            break;
+            //}}}
           case eHeaderCodeCharacter:
             //{{{  response char
             mResponse = mResponse * 10 + *data - '0';
@@ -428,9 +743,10 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
             //cLog::log (LOGINFO, "header key:" + key + " value:" + value);
             if (key == "content-length") {
               mHeaderContentLength = stoi (value);
-              mContent = (uint8_t*)malloc (mHeaderContentLength);
               mContentLengthLeft = mHeaderContentLength;
               mContentState = eContentLength;
+              if (!mStreamSliceSize)
+                reserveContent (mHeaderContentLength);
               //cLog::log (LOGINFO, "got mHeaderContentLength:%d", mHeaderContentLength);
               }
 
@@ -440,6 +756,12 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
             else if (key == "location")
               mRedirectUrl.parse (value);
 
+            else if (key == "connection") {
+              mConnection = value;
+              for (auto& ch : mConnection)
+                ch = (char)tolower (ch);
+              }
+
             mKeyLen = 0;
             mValueLen = 0;
 
@@ -482,38 +804,26 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
 
       //{{{
       case eExpectedData: {
-      // content declared and allocated by content-length header
-      // - callback each bit, reject too much, exit cleanly on just enough
+      // content declared and reserved by content-length header
+      // - take just enough, exit cleanly, bytes beyond are the next pipelined response
 
         //cLog::log (LOGINFO, "eExpectedData - length:%d mHeaderContentLength:%d left:%d mContentReceivedSize:%d",
         //                    length, mHeaderContentLength, mContentLengthLeft, mContentReceivedSize);
-        if (length > mContentLengthLeft) {
-          cLog::log (LOGERROR, "eExpectedData - too much data - got:%d expected:%d", length, mContentLengthLeft);
-          mState = eClose;
-          }
-
-        else if (mContent) {
+        if (mContent || mStreamSliceSize) {
           // data expected
-          memcpy (mContent + mContentReceivedSize, data, length);
-          mContentReceivedSize += length;
-
-          if (!dataCallback (data, length))
-            // data not accepted by callback, bomb out
-            mState = eClose;
-
-          data += length;
-          mContentLengthLeft -= length;
-          if (mContentLengthLeft == 0)
-            mState = eClose;
+          int expectedSize = (length < mContentLengthLeft) ? length : mContentLengthLeft;
+          body (data, expectedSize, dataCallback);
+          data += expectedSize;
+          length -= expectedSize;
           }
 
         else {
           // data not expected, bomb out
           cLog::log (LOGERROR, "eExpectedData - data not expected - got:%d", length);
           mState = eClose;
+          length = 0;
           }
 
-        length = 0;
         break;
         }
       //}}}
@@ -529,6 +839,8 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
           else {
             mState = eChunkData;
             mContentLengthLeft = mHeaderContentLength;
+            if (!mStreamSliceSize)
+              reserveContent (mContentReceivedSize + mHeaderContentLength);
             }
           }
 
@@ -541,24 +853,11 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
       case eChunkData: {
 
         int chunkSize = (length < mContentLengthLeft) ? length : mContentLengthLeft;
-        if (dataCallback (data, length)) {
-          //log (LOGINFO, "eChunkData - mHeaderContentLength:%d left:%d chunksize:%d mContent:%x",
-          //                    mHeaderContentLength, mContentLengthLeft, chunkSize, mContent);
-          mContent = (uint8_t*)realloc (mContent, mContentReceivedSize + chunkSize);
-          memcpy (mContent + mContentReceivedSize, data, chunkSize);
-          mContentReceivedSize += chunkSize;
-
-          length -= chunkSize;
-          data += chunkSize;
-          mContentLengthLeft -= chunkSize;
-          if (mContentLengthLeft <= 0) {
-            // finished chunk, get ready for next chunk
-            mHeaderContentLength = 1;
-            mState = eChunkHeader;
-            }
-          }
-        else // refused data in callback, bomb out early ???
-          mState = eClose;
+        //log (LOGINFO, "eChunkData - mHeaderContentLength:%d left:%d chunksize:%d mContent:%x",
+        //                    mHeaderContentLength, mContentLengthLeft, chunkSize, mContent);
+        body (data, chunkSize, dataCallback);
+        length -= chunkSize;
+        data += chunkSize;
 
         break;
         }
@@ -567,7 +866,7 @@ bool cHttp::parseData (const uint8_t* data, int length, int& bytesParsed,
       case eStreamData: {
 
         //cLog::log (LOGINFO, "eStreamData - length:%d", length);
-        if (!dataCallback (data, length))
+        if (!(mStreamSliceSize ? sliceBody (data, length, dataCallback) : dataCallback (data, length)))
           mState = eClose;
 
         data += length;
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <functional>
 
 #ifdef _WIN32
@@ -212,25 +213,45 @@ public:
   virtual ~cHttp();
   virtual void initialise();
 
-  // gets
+  // gets, content nullptr until body received, or when streaming slices
   int getResponse() { return mResponse; }
-  uint8_t* getContent() { return mContent; }
+  uint8_t* getContent() { return mContentReceivedSize && !mStreamSliceSize ? mContent : nullptr; }
   int getContentSize() { return mContentReceivedSize; }
 
   int getHeaderContentSize() { return mHeaderContentLength; }
 
+  // last response leaves connection open, http/1.1 unless connection: close, http/1.0 only if keep-alive
+  bool getKeepAlive() { return mConnection.empty() ? (mVersion >= 11) : (mConnection == "keep-alive"); }
+
+  // sets
+  void setRecvBufferSize (int size);
+  void setContentBuffer (uint8_t* buffer, int size);
+  void setStreamSlice (int sliceSize);
+
   int get (const std::string& host, const std::string& path, const std::string& header = "",
            const std::function<void (const std::string& key, const std::string& value)>& headerCallback = [](const std::string&, const std::string&) {},
            const std::function<bool (const uint8_t* data, int len)>& dataCallback = [](const uint8_t*, int) { return true; });
   std::string getRedirect (const std::string& host, const std::string& path);
+
+  // opt in pipelining, up to depth GETs in flight on one keep-alive connection, responses in order
+  int getPipelined (const std::string& host, const std::vector <std::string>& paths, int depth,
+                    const std::function<void (size_t index, int response)>& responseCallback,
+                    const std::string& header = "");
+  uint8_t* takeContent();
   void freeContent();
 
+  // split host, [ipv6] or host:port, [ipv6]:port, default port 80
+  static void splitHost (const std::string& host, std::string& hostName, uint16_t& port);
+
 protected:
   virtual int connectToHost (const std::string& host);
   virtual bool getSend (const std::string& sendStr);
   virtual int getRecv (uint8_t* buffer, int bufferSize);
 
 private:
+  // cHttpEngine drives the parser from its own non blocking sockets
+  friend class cHttpEngine;
+
   //{{{
   enum eState {
     eHeader,
@@ -263,6 +284,11 @@ private:
   //}}}
 
   void clear();
+  void closeSocket();
+  void reserveContent (int size);
+  bool body (const uint8_t* data, int length, const std::function<bool (const uint8_t* data, int len)>& dataCallback);
+  bool sliceBody (const uint8_t* data, int length, const std::function<bool (const uint8_t* data, int len)>& dataCallback);
+
   eHeaderState parseHeaderChar (char ch);
   bool parseChunk (int& size, char ch);
   bool parseData (const uint8_t* data, int length, int& bytesParsed,
@@ -290,8 +316,24 @@ private:
   int mHeaderContentLength = -1;
   int mContentLengthLeft = -1;
   int mContentReceivedSize = 0;
+
+  // content, owned and kept across gets, or caller buffer when body fits
   uint8_t* mContent = nullptr;
+  int mContentAllocSize = 0;
+  bool mContentOwned = false;
+  uint8_t* mUserContent = nullptr;
+  int mUserContentSize = 0;
+
+  uint8_t* mRecvBuffer = nullptr;
+  int mRecvBufferSize = 0;
+
+  // streaming, body handed to dataCallback in sliceSize pieces, not stored
+  int mStreamSliceSize = 0;
+  uint8_t* mSlice = nullptr;
+  int mSliceFill = 0;
 
   int mResponse = 0;
+  int mVersion = 0;
+  std::string mConnection;
   cUrl mRedirectUrl;
   };
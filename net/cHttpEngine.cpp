@@ -0,0 +1,551 @@
+// cHttpEngine.cpp - single thread epoll http/1.1 client, many concurrent non blocking GETs
+//{{{  includes
+#include "cHttpEngine.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "fmt/format.h"
+#include "../common/cLog.h"
+
+using namespace std;
+//}}}
+
+constexpr int kMaxEvents = 64;
+constexpr int kRecvBufferSize = 0x10000;
+constexpr int kMaxWaitMs = 1000;
+constexpr chrono::seconds kIdleTimeout = 30s;
+
+// public
+//{{{
+cHttpEngine::cHttpEngine (int maxHostConnections) : mMaxHostConnections(maxHostConnections) {
+
+  mRecvBuffer.resize (kRecvBufferSize);
+
+  mEpoll = epoll_create1 (EPOLL_CLOEXEC);
+  mEventFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  // wake on submit, null ptr marks eventFd
+  epoll_event event;
+  memset (&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  epoll_ctl (mEpoll, EPOLL_CTL_ADD, mEventFd, &event);
+
+  mThread = thread ([=,this]() { engineThread(); });
+  }
+//}}}
+//{{{
+cHttpEngine::~cHttpEngine() {
+// outstanding requests are dropped without callback
+
+  mExit = true;
+  uint64_t wake = 1;
+  (void)!write (mEventFd, &wake, sizeof(wake));
+  mThread.join();
+
+  for (auto connection : mConnections) {
+    if (connection->mSocket >= 0)
+      close (connection->mSocket);
+    delete connection->mRequest;
+    delete connection;
+    }
+  for (auto connection : mClosed)
+    delete connection;
+
+  for (auto& host : mHosts)
+    for (auto request : host.second.mPending)
+      delete request;
+  for (auto request : mSubmitted)
+    delete request;
+
+  close (mEventFd);
+  close (mEpoll);
+  }
+//}}}
+
+//{{{
+void cHttpEngine::get (const string& host, const string& path, const string& header,
+                       chrono::milliseconds timeout, cCallback callback) {
+
+  cRequest* request = new cRequest();
+  request->mHost = host;
+  request->mSendString = "GET /" + path + " HTTP/1.1\r\n" +
+                         "Host: " + host + "\r\n" +
+                         (header.empty() ? "" : (header + "\r\n")) +
+                         "\r\n";
+  request->mDeadline = chrono::steady_clock::now() + timeout;
+  request->mCallback = callback;
+
+  // resolve on caller thread, usually a cache hit, keeps lookups off engine thread
+  string hostName;
+  uint16_t port;
+  cHttp::splitHost (host, hostName, port);
+  cDnsCache::resolve (hostName, port, request->mAddresses);
+
+  mNumRequests++;
+  mNumActive++;
+
+  {
+  unique_lock<mutex> lock (mSubmitMutex);
+  mSubmitted.push_back (request);
+  }
+
+  uint64_t wake = 1;
+  (void)!write (mEventFd, &wake, sizeof(wake));
+  }
+//}}}
+//{{{
+string cHttpEngine::getInfoString() const {
+  return fmt::format ("http active:{} requests:{} connects:{} reuses:{} retries:{} timeouts:{}",
+                      mNumActive.load(), mNumRequests.load(), mNumConnects.load(),
+                      mNumReuses.load(), mNumRetries.load(), mNumTimeouts.load());
+  }
+//}}}
+
+// private
+//{{{
+void cHttpEngine::engineThread() {
+
+  cLog::setThreadName ("htEn");
+
+  epoll_event events[kMaxEvents];
+  while (!mExit) {
+    int numEvents = epoll_wait (mEpoll, events, kMaxEvents, getWaitMs());
+    if ((numEvents < 0) && (errno != EINTR)) {
+      cLog::log (LOGERROR, fmt::format ("cHttpEngine epoll_wait {}", strerror (errno)));
+      break;
+      }
+
+    for (int i = 0; i < numEvents; i++)
+      if (events[i].data.ptr)
+        handleEvent ((cConnection*)events[i].data.ptr, events[i].events);
+      else {
+        uint64_t count;
+        (void)!read (mEventFd, &count, sizeof(count));
+        takeSubmitted();
+        }
+
+    checkTimeouts();
+    dispatch();
+
+    // deferred delete, no event in this batch can still reference them
+    for (auto connection : mClosed)
+      delete connection;
+    mClosed.clear();
+    }
+
+  cLog::log (LOGINFO, "exit");
+  }
+//}}}
+//{{{
+int cHttpEngine::getWaitMs() {
+// until next request deadline or idle expiry
+
+  auto now = chrono::steady_clock::now();
+  auto next = now + chrono::milliseconds (kMaxWaitMs);
+
+  for (auto& host : mHosts)
+    for (auto request : host.second.mPending)
+      next = min (next, request->mDeadline);
+
+  for (auto connection : mConnections)
+    if (connection->mRequest)
+      next = min (next, connection->mRequest->mDeadline);
+    else if (connection->mState == cConnection::eIdle)
+      next = min (next, connection->mIdleExpiry);
+
+  if (next <= now)
+    return 0;
+
+  // round up, don't spin just short of deadline
+  return int(chrono::duration_cast<chrono::milliseconds>(next - now).count()) + 1;
+  }
+//}}}
+//{{{
+void cHttpEngine::takeSubmitted() {
+
+  vector <cRequest*> submitted;
+  {
+  unique_lock<mutex> lock (mSubmitMutex);
+  submitted.swap (mSubmitted);
+  }
+
+  for (auto request : submitted) {
+    if (request->mAddresses.empty()) {
+      cLog::log (LOGERROR, fmt::format ("cHttpEngine - resolve {} failed", request->mHost));
+      complete (request, eResolveError, nullptr, 0);
+      continue;
+      }
+
+    cHost& host = mHosts[request->mHost];
+    host.mName = request->mHost;
+    host.mPending.push_back (request);
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::dispatch() {
+// pending requests to idle connections, else new connections up to limit
+
+  for (auto& item : mHosts) {
+    cHost& host = item.second;
+    while (!host.mPending.empty()) {
+      cRequest* request = host.mPending.front();
+
+      cConnection* connection = nullptr;
+      if (!host.mIdle.empty()) {
+        connection = host.mIdle.back();
+        host.mIdle.pop_back();
+        connection->mReused = true;
+        mNumReuses++;
+        }
+
+      else if (host.mNumConnections < mMaxHostConnections) {
+        connection = new cConnection();
+        connection->mHost = &host;
+        connection->mAddresses = request->mAddresses;
+        host.mNumConnections++;
+        mConnections.insert (connection);
+
+        if (!connectNext (connection)) {
+          host.mPending.pop_front();
+          closeConnection (connection);
+          complete (request, eConnectError, nullptr, 0);
+          continue;
+          }
+        }
+
+      else
+        break;
+
+      host.mPending.pop_front();
+      startRequest (connection, request);
+      }
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::checkTimeouts() {
+
+  auto now = chrono::steady_clock::now();
+
+  for (auto& item : mHosts) {
+    auto& pending = item.second.mPending;
+    for (auto it = pending.begin(); it != pending.end();)
+      if (now >= (*it)->mDeadline) {
+        cRequest* request = *it;
+        it = pending.erase (it);
+        complete (request, eTimeoutError, nullptr, 0);
+        }
+      else
+        ++it;
+    }
+
+  // copy, closeConnection erases from mConnections
+  vector <cConnection*> connections (mConnections.begin(), mConnections.end());
+  for (auto connection : connections)
+    if (connection->mRequest && (now >= connection->mRequest->mDeadline)) {
+      cRequest* request = connection->mRequest;
+      connection->mRequest = nullptr;
+      closeConnection (connection);
+      complete (request, eTimeoutError, nullptr, 0);
+      }
+    else if ((connection->mState == cConnection::eIdle) && (now >= connection->mIdleExpiry))
+      closeConnection (connection);
+  }
+//}}}
+
+// connection
+//{{{
+bool cHttpEngine::connectNext (cConnection* connection) {
+// start non blocking connect to next address, completes on EPOLLOUT
+
+  while (connection->mAddressIndex < connection->mAddresses.size()) {
+    auto& address = connection->mAddresses[connection->mAddressIndex++];
+
+    int sock = socket (address.mFamily, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+      cLog::log (LOGERROR, "cHttpEngine - error opening socket");
+      continue;
+      }
+
+    int noDelay = 1;
+    setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    if ((connect (sock, (struct sockaddr*)&address.mSockAddr, address.mLength) == 0) || (errno == EINPROGRESS)) {
+      connection->mSocket = sock;
+      connection->mState = cConnection::eConnecting;
+      connection->mEvents = EPOLLOUT;
+
+      epoll_event event;
+      memset (&event, 0, sizeof(event));
+      event.events = connection->mEvents;
+      event.data.ptr = connection;
+      epoll_ctl (mEpoll, EPOLL_CTL_ADD, sock, &event);
+
+      mNumConnects++;
+      cLog::log (LOGINFO, fmt::format ("cHttpEngine connect {} using socket {}", address.getString(), sock));
+      return true;
+      }
+
+    cLog::log (LOGINFO, fmt::format ("cHttpEngine - error connecting {}", address.getString()));
+    close (sock);
+    }
+
+  return false;
+  }
+//}}}
+//{{{
+void cHttpEngine::startRequest (cConnection* connection, cRequest* request) {
+
+  connection->mRequest = request;
+  connection->mSendOffset = 0;
+  connection->mReceived = false;
+  connection->mKeepAlive = true;
+  connection->mHttp.clear();
+  connection->mStreamContent.clear();
+
+  // connecting sends when connected
+  if (connection->mState == cConnection::eIdle) {
+    connection->mState = cConnection::eSending;
+    sendRequest (connection);
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::handleEvent (cConnection* connection, uint32_t events) {
+
+  switch (connection->mState) {
+    case cConnection::eConnecting: {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      getsockopt (connection->mSocket, SOL_SOCKET, SO_ERROR, &error, &length);
+      if (!error && !(events & EPOLLERR)) {
+        connection->mState = cConnection::eSending;
+        sendRequest (connection);
+        break;
+        }
+
+      //{{{  error, try next address, else fail
+      cLog::log (LOGINFO, fmt::format ("cHttpEngine - connect {} {}", connection->mHost->mName, strerror (error)));
+
+      epoll_ctl (mEpoll, EPOLL_CTL_DEL, connection->mSocket, nullptr);
+      close (connection->mSocket);
+      connection->mSocket = -1;
+
+      if (!connectNext (connection)) {
+        // maybe stale, lookup again next time
+        string hostName;
+        uint16_t port;
+        cHttp::splitHost (connection->mHost->mName, hostName, port);
+        cDnsCache::invalidate (hostName);
+        retryOrFail (connection, eConnectError);
+        }
+
+      break;
+      //}}}
+      }
+
+    case cConnection::eSending:
+      if (events & (EPOLLERR | EPOLLHUP))
+        retryOrFail (connection, eConnectError);
+      else
+        sendRequest (connection);
+      break;
+
+    case cConnection::eReceiving:
+      recvResponse (connection);
+      break;
+
+    case cConnection::eIdle:
+      // server closed idle keep-alive, or sent something unasked for
+      closeConnection (connection);
+      break;
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::sendRequest (cConnection* connection) {
+
+  const string& sendString = connection->mRequest->mSendString;
+  while (connection->mSendOffset < sendString.size()) {
+    ssize_t bytesSent = ::send (connection->mSocket, sendString.data() + connection->mSendOffset,
+                                sendString.size() - connection->mSendOffset, MSG_NOSIGNAL);
+    if (bytesSent > 0)
+      connection->mSendOffset += bytesSent;
+    else if ((bytesSent < 0) && (errno == EINTR))
+      continue;
+    else if ((bytesSent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+      // socket full, wait for EPOLLOUT
+      setEvents (connection, EPOLLOUT);
+      return;
+      }
+    else {
+      retryOrFail (connection, eConnectError);
+      return;
+      }
+    }
+
+  connection->mState = cConnection::eReceiving;
+  setEvents (connection, EPOLLIN | EPOLLRDHUP);
+  }
+//}}}
+//{{{
+void cHttpEngine::recvResponse (cConnection* connection) {
+// recv until EAGAIN, parse, finish on complete response
+
+  cHttp& http = connection->mHttp;
+
+  auto headerCallback = [](const string& key, const string& value) { (void)key; (void)value; };
+
+  auto dataCallback = [connection](const uint8_t* data, int length) {
+    // cHttp only stores content length and chunked bodies
+    if (connection->mHttp.mState == cHttp::eStreamData)
+      connection->mStreamContent.insert (connection->mStreamContent.end(), data, data + length);
+    return true;
+    };
+
+  while (true) {
+    ssize_t bytesReceived = ::recv (connection->mSocket, mRecvBuffer.data(), mRecvBuffer.size(), 0);
+    if (bytesReceived < 0) {
+      if (errno == EINTR)
+        continue;
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        retryOrFail (connection, eRecvError);
+      return;
+      }
+
+    if (bytesReceived == 0) {
+      // closed by server, ends close delimited body
+      connection->mKeepAlive = false;
+      if (http.mState == cHttp::eStreamData)
+        finish (connection, http.getResponse());
+      else
+        retryOrFail (connection, eRecvError);
+      return;
+      }
+
+    const uint8_t* data = mRecvBuffer.data();
+    int length = (int)bytesReceived;
+
+    connection->mReceived = true;
+    while (length > 0) {
+      int bytesParsed;
+      bool needMoreData = http.parseData (data, length, bytesParsed, headerCallback, dataCallback);
+      data += bytesParsed;
+      length -= bytesParsed;
+
+      if (!needMoreData) {
+        if (length > 0)
+          // unasked for bytes after response, don't trust connection
+          connection->mKeepAlive = false;
+        finish (connection, (http.mState == cHttp::eError) ? eParseError : http.getResponse());
+        return;
+        }
+      }
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::setEvents (cConnection* connection, uint32_t events) {
+
+  if (events != connection->mEvents) {
+    connection->mEvents = events;
+
+    epoll_event event;
+    memset (&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = connection;
+    epoll_ctl (mEpoll, EPOLL_CTL_MOD, connection->mSocket, &event);
+    }
+  }
+//}}}
+//{{{
+void cHttpEngine::finish (cConnection* connection, int response) {
+// complete request, connection back to idle if reusable
+
+  cHttp& http = connection->mHttp;
+
+  cRequest* request = connection->mRequest;
+  connection->mRequest = nullptr;
+
+  bool streamed = http.mContentState == cHttp::eContentNone;
+  if (streamed)
+    complete (request, response, connection->mStreamContent.data(), (int)connection->mStreamContent.size());
+  else
+    complete (request, response, http.getContent(), http.getContentSize());
+
+  if (connection->mKeepAlive && http.getKeepAlive() && !streamed && (http.mState == cHttp::eClose)) {
+    connection->mState = cConnection::eIdle;
+    connection->mIdleExpiry = chrono::steady_clock::now() + kIdleTimeout;
+    connection->mHost->mIdle.push_back (connection);
+    setEvents (connection, EPOLLIN | EPOLLRDHUP);
+    }
+  else
+    closeConnection (connection);
+  }
+//}}}
+//{{{
+void cHttpEngine::retryOrFail (cConnection* connection, int response) {
+// close connection, resend once if reused connection died before any response
+
+  cRequest* request = connection->mRequest;
+  connection->mRequest = nullptr;
+  closeConnection (connection);
+
+  if (!request)
+    return;
+
+  if (connection->mReused && !connection->mReceived && !request->mRetried) {
+    request->mRetried = true;
+    mNumRetries++;
+    connection->mHost->mPending.push_front (request);
+    return;
+    }
+
+  complete (request, response, nullptr, 0);
+  }
+//}}}
+//{{{
+void cHttpEngine::closeConnection (cConnection* connection) {
+// close socket, delete deferred to end of engineThread loop
+
+  if (connection->mSocket >= 0) {
+    epoll_ctl (mEpoll, EPOLL_CTL_DEL, connection->mSocket, nullptr);
+    close (connection->mSocket);
+    connection->mSocket = -1;
+    }
+
+  cHost* host = connection->mHost;
+  auto it = find (host->mIdle.begin(), host->mIdle.end(), connection);
+  if (it != host->mIdle.end())
+    host->mIdle.erase (it);
+  host->mNumConnections--;
+
+  mConnections.erase (connection);
+  mClosed.push_back (connection);
+  }
+//}}}
+
+//{{{
+void cHttpEngine::complete (cRequest* request, int response, const uint8_t* content, int contentSize) {
+
+  if (response == eTimeoutError)
+    mNumTimeouts++;
+
+  request->mCallback (response, content, contentSize);
+
+  delete request;
+  mNumActive--;
+  }
+//}}}
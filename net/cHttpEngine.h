@@ -0,0 +1,145 @@
+// cHttpEngine.h - single thread epoll http/1.1 client, many concurrent non blocking GETs
+// - per host connection limit, queued requests wait for a free or idle keep-alive connection
+// - request timeout covers queueing, connect, send and receive
+// - callbacks run on the engine thread, content only valid during callback, keep them short
+// - linux only
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "cHttp.h"
+#include "cDnsCache.h"
+//}}}
+
+class cHttpEngine {
+public:
+  //{{{
+  enum eError {
+    eResolveError = -1,
+    eConnectError = -2,
+    eTimeoutError = -3,
+    eParseError = -4,
+    eRecvError = -5,
+    };
+  //}}}
+  using cCallback = std::function<void (int response, const uint8_t* content, int contentSize)>;
+
+  cHttpEngine (int maxHostConnections = 6);
+  ~cHttpEngine();
+
+  // thread safe, callback response is http response code or eError
+  void get (const std::string& host, const std::string& path, const std::string& header,
+            std::chrono::milliseconds timeout, cCallback callback);
+
+  // stats
+  int getNumActive() const { return mNumActive; }
+  int64_t getNumRequests() const { return mNumRequests; }
+  int64_t getNumConnects() const { return mNumConnects; }
+  int64_t getNumReuses() const { return mNumReuses; }
+  int64_t getNumRetries() const { return mNumRetries; }
+  int64_t getNumTimeouts() const { return mNumTimeouts; }
+  std::string getInfoString() const;
+
+private:
+  //{{{
+  class cRequest {
+  public:
+    std::string mHost;
+    std::string mSendString;
+    std::vector <cDnsCache::cAddress> mAddresses;
+    std::chrono::steady_clock::time_point mDeadline;
+    cCallback mCallback;
+    bool mRetried = false;
+    };
+  //}}}
+  class cHost;
+  //{{{
+  class cConnection {
+  public:
+    enum eState { eConnecting, eSending, eReceiving, eIdle };
+
+    cHost* mHost = nullptr;
+    int mSocket = -1;
+    eState mState = eConnecting;
+    uint32_t mEvents = 0;
+
+    std::vector <cDnsCache::cAddress> mAddresses;
+    size_t mAddressIndex = 0;
+
+    cRequest* mRequest = nullptr;
+    size_t mSendOffset = 0;
+    bool mReused = false;
+    bool mReceived = false;
+    bool mKeepAlive = true;
+
+    // response parser, close delimited body kept here
+    cHttp mHttp;
+    std::vector <uint8_t> mStreamContent;
+
+    std::chrono::steady_clock::time_point mIdleExpiry;
+    };
+  //}}}
+  //{{{
+  class cHost {
+  public:
+    std::string mName;
+    std::deque <cRequest*> mPending;
+    std::vector <cConnection*> mIdle;
+    int mNumConnections = 0;
+    };
+  //}}}
+
+  void engineThread();
+  int getWaitMs();
+  void takeSubmitted();
+  void dispatch();
+  void checkTimeouts();
+
+  // connection
+  bool connectNext (cConnection* connection);
+  void startRequest (cConnection* connection, cRequest* request);
+  void handleEvent (cConnection* connection, uint32_t events);
+  void sendRequest (cConnection* connection);
+  void recvResponse (cConnection* connection);
+  void setEvents (cConnection* connection, uint32_t events);
+  void finish (cConnection* connection, int response);
+  void retryOrFail (cConnection* connection, int response);
+  void closeConnection (cConnection* connection);
+
+  void complete (cRequest* request, int response, const uint8_t* content, int contentSize);
+
+  // vars
+  const int mMaxHostConnections;
+
+  int mEpoll = -1;
+  int mEventFd = -1;
+  std::thread mThread;
+  std::atomic <bool> mExit = false;
+
+  // get to engine thread
+  std::mutex mSubmitMutex;
+  std::vector <cRequest*> mSubmitted;
+
+  // engine thread only
+  std::map <std::string, cHost> mHosts;
+  std::set <cConnection*> mConnections;
+  std::vector <cConnection*> mClosed;
+  std::vector <uint8_t> mRecvBuffer;
+
+  std::atomic <int> mNumActive = 0;
+  std::atomic <int64_t> mNumRequests = 0;
+  std::atomic <int64_t> mNumConnects = 0;
+  std::atomic <int64_t> mNumReuses = 0;
+  std::atomic <int64_t> mNumRetries = 0;
+  std::atomic <int64_t> mNumTimeouts = 0;
+  };
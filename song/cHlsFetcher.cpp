@@ -0,0 +1,194 @@
+// cHlsFetcher.cpp - fetch hls ts chunks ahead of demux on a small pool of keep-alive cHttp threads
+//{{{  includes
+#include "cHlsFetcher.h"
+
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+
+#include "fmt/format.h"
+#include "../common/cLog.h"
+#include "../net/cHttp.h"
+
+using namespace std;
+//}}}
+
+// cHlsFetcher::cSegment
+//{{{
+cHlsFetcher::cSegment::~cSegment() {
+  free (mContent);
+  }
+//}}}
+
+// cHlsFetcher
+//{{{
+cHlsFetcher::cHlsFetcher (int numConnections, const function<string (int chunkNum)>& pathCallback)
+    : mNumConnections(numConnections), mPathCallback(pathCallback), mNumRunning(numConnections) {
+
+  for (int i = 0; i < mNumConnections; i++)
+    thread ([=,this](){ fetchThread (i); }).detach();
+  }
+//}}}
+//{{{
+cHlsFetcher::~cHlsFetcher() {
+
+  {
+  unique_lock<mutex> lock (mMutex);
+  mExit = true;
+  mCondition.notify_all();
+
+  // wait for fetchThreads to finish their current get
+  mCondition.wait (lock, [&]{ return mNumRunning == 0; });
+  }
+
+  for (auto& segment : mCompleted)
+    delete segment.second;
+  }
+//}}}
+
+//{{{
+string cHlsFetcher::getInfoString() {
+
+  unique_lock<mutex> lock (mMutex);
+  return fmt::format ("f:{}:{}:{} {}ms", mInFlight.size(), mPending.size(), mCompleted.size(), mLastMicroSeconds/1000);
+  }
+//}}}
+//{{{
+float cHlsFetcher::getFrac (int chunkNum) {
+
+  unique_lock<mutex> lock (mMutex);
+
+  auto it = mInFlight.find (chunkNum);
+  if (it != mInFlight.end())
+    return it->second->mFrac;
+
+  return mCompleted.count (chunkNum) ? 1.f : 0.f;
+  }
+//}}}
+
+//{{{
+void cHlsFetcher::setHost (const string& host) {
+
+  unique_lock<mutex> lock (mMutex);
+  mHost = host;
+  }
+//}}}
+//{{{
+void cHlsFetcher::fetch (const vector<int>& chunkNums) {
+// set wanted chunkNums, highest priority first, queue as many as connections allow
+
+  unique_lock<mutex> lock (mMutex);
+
+  // drop completed chunks no longer wanted, seeked away
+  for (auto it = mCompleted.begin(); it != mCompleted.end();)
+    if (find (chunkNums.begin(), chunkNums.end(), it->first) == chunkNums.end()) {
+      delete it->second;
+      it = mCompleted.erase (it);
+      }
+    else
+      ++it;
+
+  // requeue in priority order, skipping chunks inFlight, completed or backing off after failure
+  auto now = chrono::steady_clock::now();
+  mPending.clear();
+  for (auto chunkNum : chunkNums) {
+    if ((int)(mInFlight.size() + mPending.size()) >= mNumConnections)
+      break;
+
+    if (mInFlight.count (chunkNum) || mCompleted.count (chunkNum))
+      continue;
+
+    auto it = mRetryTime.find (chunkNum);
+    if (it != mRetryTime.end()) {
+      if (now < it->second)
+        continue;
+      mRetryTime.erase (it);
+      }
+
+    mPending.push_back (chunkNum);
+    }
+
+  if (!mPending.empty())
+    mCondition.notify_all();
+  }
+//}}}
+//{{{
+cHlsFetcher::cSegment* cHlsFetcher::waitSegment (int chunkNum, chrono::milliseconds timeout) {
+// return completed segment for chunkNum, caller deletes, nullptr if not completed within timeout
+
+  unique_lock<mutex> lock (mMutex);
+  if (!mCondition.wait_for (lock, timeout, [&]{ return mExit || mCompleted.count (chunkNum); }))
+    return nullptr;
+
+  auto it = mCompleted.find (chunkNum);
+  if (it == mCompleted.end())
+    return nullptr;
+
+  cSegment* segment = it->second;
+  mCompleted.erase (it);
+  return segment;
+  }
+//}}}
+
+// private
+//{{{
+void cHlsFetcher::fetchThread (int connection) {
+
+  cLog::setThreadName (fmt::format ("hls{}", connection));
+
+  // one keep-alive connection per thread
+  cHttp http;
+
+  while (true) {
+    cSegment* segment;
+    string host;
+    {
+    unique_lock<mutex> lock (mMutex);
+    mCondition.wait (lock, [&]{ return mExit || !mPending.empty(); });
+    if (mExit)
+      break;
+
+    segment = new cSegment (mPending.front());
+    mPending.pop_front();
+    mInFlight.insert (map<int,cSegment*>::value_type (segment->mChunkNum, segment));
+    host = mHost;
+    }
+
+    auto timePoint = chrono::steady_clock::now();
+    segment->mResponse = http.get (host, mPathCallback (segment->mChunkNum), "",
+                                   [](const string& key, const string& value) noexcept { (void)key; (void)value; },
+                                   [&](const uint8_t* data, int length) noexcept {
+                                     (void)data;
+                                     (void)length;
+                                     if (http.getHeaderContentSize() > 0)
+                                       segment->mFrac = float(http.getContentSize()) / http.getHeaderContentSize();
+                                     return true;
+                                     });
+    segment->mMicroSeconds =
+      chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - timePoint).count();
+
+    if (segment->mResponse == 200) {
+      // take content, no copy, http allocates afresh for next get
+      segment->mContentSize = http.getContentSize();
+      segment->mContent = http.takeContent();
+      segment->mFrac = 1.f;
+      }
+    http.freeContent();
+
+    {
+    unique_lock<mutex> lock (mMutex);
+    mInFlight.erase (segment->mChunkNum);
+    mLastMicroSeconds = segment->mMicroSeconds;
+    if (segment->mResponse != 200)
+      // not available yet, backoff before fetching this chunk again
+      mRetryTime[segment->mChunkNum] = chrono::steady_clock::now() + kRetryBackoff;
+    mCompleted.insert (map<int,cSegment*>::value_type (segment->mChunkNum, segment));
+    }
+    mCondition.notify_all();
+    }
+
+  unique_lock<mutex> lock (mMutex);
+  mNumRunning--;
+  mCondition.notify_all();
+  }
+//}}}
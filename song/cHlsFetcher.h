@@ -0,0 +1,63 @@
+// cHlsFetcher.h - fetch hls ts chunks ahead of demux on a small pool of keep-alive cHttp threads
+// - fetch() sets wanted chunkNums in priority order, waitSegment() hands back completed chunks
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+//}}}
+
+class cHlsFetcher {
+public:
+  //{{{
+  class cSegment {
+  public:
+    cSegment (int chunkNum) : mChunkNum(chunkNum) {}
+    ~cSegment();
+
+    const int mChunkNum;
+    int mResponse = 0;
+    uint8_t* mContent = nullptr;
+    int mContentSize = 0;
+    int64_t mMicroSeconds = 0;
+    std::atomic<float> mFrac = 0.f;
+    };
+  //}}}
+
+  cHlsFetcher (int numConnections, const std::function<std::string (int chunkNum)>& pathCallback);
+  ~cHlsFetcher();
+
+  std::string getInfoString();
+  float getFrac (int chunkNum);
+
+  void setHost (const std::string& host);
+  void fetch (const std::vector<int>& chunkNums);
+  cSegment* waitSegment (int chunkNum, std::chrono::milliseconds timeout);
+
+private:
+  void fetchThread (int connection);
+
+  static constexpr std::chrono::milliseconds kRetryBackoff = std::chrono::milliseconds(250);
+
+  const int mNumConnections;
+  const std::function<std::string (int chunkNum)> mPathCallback;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mExit = false;
+  int mNumRunning;
+
+  std::string mHost;
+  std::deque<int> mPending;
+  std::map<int,cSegment*> mInFlight;
+  std::map<int,cSegment*> mCompleted;
+  std::map<int,std::chrono::steady_clock::time_point> mRetryTime;
+  int64_t mLastMicroSeconds = 0;
+  };
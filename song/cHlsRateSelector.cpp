@@ -0,0 +1,99 @@
+// cHlsRateSelector.cpp - choose hls variant rate from segment download throughput and buffered play time
+//{{{  includes
+#include "cHlsRateSelector.h"
+
+#include <algorithm>
+
+#include "fmt/format.h"
+#include "../common/cLog.h"
+
+using namespace std;
+//}}}
+
+//{{{
+cHlsRateSelector::cHlsRateSelector (const vector<int>& rates, int rate, int overheadRate, bool adaptive)
+    : mRates(rates), mOverheadRate(overheadRate), mAdaptive(adaptive) {
+
+  auto it = find (mRates.begin(), mRates.end(), rate);
+  if (it == mRates.end()) {
+    // not a variant rate, pin it
+    mRates = { rate };
+    mAdaptive = false;
+    it = mRates.begin();
+    }
+
+  mIndex = (int)(it - mRates.begin());
+  }
+//}}}
+
+//{{{
+string cHlsRateSelector::getInfoString() const {
+
+  if (!mAdaptive)
+    return "";
+
+  return fmt::format ("abr:{}k est:{}k buf:{:.1f}s sw:{}",
+                      getRate()/1000, int(mEstimate/1000.f), mBufferSeconds.load(), mNumSwitches.load());
+  }
+//}}}
+
+//{{{
+void cHlsRateSelector::addSegment (int contentSize, int64_t microSeconds) {
+// add completed segment download to throughput averages
+
+  if ((contentSize < kMinSampleSize) || (microSeconds <= 0))
+    return;
+
+  mLastRate = contentSize * 8.f * 1000000.f / microSeconds;
+  if (mNumSamples++ == 0) {
+    mFastRate = mLastRate;
+    mSlowRate = mLastRate;
+    }
+  else {
+    mFastRate += kFastAlpha * (mLastRate - mFastRate);
+    mSlowRate += kSlowAlpha * (mLastRate - mSlowRate);
+    }
+
+  mEstimate = min (mFastRate, mSlowRate);
+  }
+//}}}
+//{{{
+bool cHlsRateSelector::select (float bufferSeconds, float chunkSeconds) {
+// choose rate for following chunks at segment boundary, return true if switched
+
+  mBufferSeconds = bufferSeconds;
+  if (!mAdaptive || !mNumSamples)
+    return false;
+
+  mHoldSegments++;
+
+  // highest rate estimate sustains with headroom
+  int safeIndex = 0;
+  for (int index = 1; index < (int)mRates.size(); index++)
+    if (mRates[index] + mOverheadRate <= mEstimate * kUpFraction)
+      safeIndex = index;
+
+  int index = mIndex;
+  int needed = mRates[index] + mOverheadRate;
+  if ((index > 0) && (needed > mEstimate * kDownFraction))
+    // estimate can't sustain current rate, drop straight to safe rate
+    index = min (safeIndex, index - 1);
+  else if ((index > 0) && (bufferSeconds < chunkSeconds * kLowBufferChunks) && (mLastRate < needed))
+    // running dry on last segment, drop one rate
+    index--;
+  else if ((safeIndex > index) &&
+           (mHoldSegments >= kHoldSegments) && (bufferSeconds >= chunkSeconds * kUpBufferChunks))
+    index++;
+
+  if (index == mIndex)
+    return false;
+
+  cLog::log (LOGINFO, fmt::format ("hls rate {}k -> {}k est:{}k last:{}k buf:{:.1f}s",
+                                   mRates[mIndex]/1000, mRates[index]/1000,
+                                   int(mEstimate/1000.f), int(mLastRate/1000.f), bufferSeconds));
+  mIndex = index;
+  mHoldSegments = 0;
+  mNumSwitches++;
+  return true;
+  }
+//}}}
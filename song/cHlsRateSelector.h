@@ -0,0 +1,50 @@
+// cHlsRateSelector.h - choose hls variant rate from segment download throughput and buffered play time
+// - throughput estimate is lower of fast and slow averages, quick to fall, slow to rise
+// - step down at once when estimate or buffer can't sustain current rate
+// - step up one rate at a time, with headroom, buffer to spare and kHoldSegments since last switch
+// - rates must share audio framing, chunk frameNums and frame pts durations stay the same across switches
+// - getRate() read by fetch threads, a switch takes effect from next chunk fetched, never mid chunk
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+//}}}
+
+class cHlsRateSelector {
+public:
+  cHlsRateSelector (const std::vector<int>& rates, int rate, int overheadRate, bool adaptive);
+
+  int getRate() const { return mRates[mIndex]; }
+  int getNumSwitches() const { return mNumSwitches; }
+  std::string getInfoString() const;
+
+  void addSegment (int contentSize, int64_t microSeconds);
+  bool select (float bufferSeconds, float chunkSeconds);
+
+private:
+  static constexpr int kMinSampleSize = 16000;
+  static constexpr float kFastAlpha = 0.5f;
+  static constexpr float kSlowAlpha = 0.15f;
+  static constexpr float kUpFraction = 0.7f;
+  static constexpr float kDownFraction = 0.9f;
+  static constexpr float kLowBufferChunks = 0.5f;
+  static constexpr float kUpBufferChunks = 1.f;
+  static constexpr int kHoldSegments = 3;
+
+  std::vector<int> mRates;
+  const int mOverheadRate;
+  bool mAdaptive;
+
+  std::atomic<int> mIndex = 0;
+  int mHoldSegments = 0;
+  std::atomic<int> mNumSwitches = 0;
+
+  int mNumSamples = 0;
+  float mLastRate = 0.f;
+  float mFastRate = 0.f;
+  float mSlowRate = 0.f;
+  std::atomic<float> mEstimate = 0.f;
+  std::atomic<float> mBufferSeconds = 0.f;
+  };
@@ -0,0 +1,272 @@
+// cPidParser.cpp - ts pid parser base, pooled pes assembly parser, pid indexed parser dispatch
+//{{{  includes
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "cPidParser.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#include "fmt/format.h"
+#include "../common/cLog.h"
+#include "../common/cDvbUtils.h"
+
+using namespace std;
+//}}}
+
+// cPidParser
+//{{{
+void cPidParser::payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront) {
+
+  (void)continuityCount;
+  (void)reuseFromFront;
+
+  string info;
+  for (int i = 0; i < tsLeft; i++) {
+    int value = ts[i];
+    info += fmt::format ("{:2x} ", value);
+    }
+
+  cLog::log (LOGINFO, fmt::format ("{} {} {}", mPidName, payloadStart ? "start ": "", info));
+  }
+//}}}
+
+// cPesParser::cPesBuffer
+//{{{
+cPesParser::cPesBuffer::cPesBuffer() {
+  mPes = (uint8_t*)malloc (mAllocSize);
+  }
+//}}}
+//{{{
+cPesParser::cPesBuffer::~cPesBuffer() {
+  free (mPes);
+  }
+//}}}
+//{{{
+bool cPesParser::cPesBuffer::add (uint8_t* buf, int size) {
+// return true if allocSize grew
+
+  bool grown = false;
+  while (mPesSize + size > mAllocSize) {
+    mAllocSize *= 2;
+    grown = true;
+    }
+  if (grown)
+    mPes = (uint8_t*)realloc (mPes, mAllocSize);
+
+  memcpy (mPes + mPesSize, buf, size);
+  mPesSize += size;
+  return grown;
+  }
+//}}}
+
+// cPesParser
+//{{{
+cPesParser::cPesParser (int pid, const string& name, bool useQueue) : cPidParser(pid, name), mUseQueue(useQueue) {
+
+  mPesBuffer = getFreeBuffer();
+  if (useQueue)
+    thread ([=,this](){ dequeThread(); }).detach(); // ,this
+  }
+//}}}
+//{{{
+cPesParser::~cPesParser() {
+
+  delete mPesBuffer;
+
+  cPesBuffer* pesBuffer;
+  while (mQueue.try_dequeue (pesBuffer))
+    delete pesBuffer;
+  while (mFreeQueue.try_dequeue (pesBuffer))
+    delete pesBuffer;
+  }
+//}}}
+
+//{{{
+string cPesParser::getPoolString() {
+// pool pressure, buffers allocated, in use high water mark, allocations avoided by reuse, waits for full pool
+
+  return fmt::format ("{}:{}/{} hw:{} reuse:{} wait:{}",
+                      mPidName, mNumInUse.load(), mNumAllocated.load(), mHighWaterMark.load(),
+                      mNumReused.load(), mNumWaits.load());
+  }
+//}}}
+
+//{{{
+void cPesParser::processLast (bool reuseFromFront) {
+
+  if (mPesBuffer->mPesSize) {
+    mPesBuffer->mReuseFromFront = reuseFromFront;
+    mPesBuffer->mPts = mPts;
+    mPesBuffer->mDts = mDts;
+    dispatchDecode (mPesBuffer);
+    }
+  }
+//}}}
+//{{{
+void cPesParser::exit() {
+
+  if (mUseQueue) {
+    mQueueExit = true;
+    //while (mQueueRunning)
+    this_thread::sleep_for (chrono::milliseconds (100));
+    }
+  }
+//}}}
+
+// cPesParser protected
+//{{{
+void cPesParser::payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront) {
+// ts[0],ts[1],ts[2],ts[3] = stream id 0x000001xx
+// ts[4],ts[5] = packetLength, 0 for video
+// ts[6] = 0x80 marker, 0x04 = dataAlignmentIndicator
+// ts[7] = 0x80 = pts, 0x40 = dts
+// ts[8] = optional header length
+
+  if ((mContinuityCount >= 0) &&
+      (continuityCount != ((mContinuityCount + 1) & 0xF))) // !!! should abandon pes here !!!!
+    cLog::log (LOGERROR, "continuity count error pid:%d %d %d", mPid, continuityCount, mContinuityCount);
+
+  mContinuityCount = continuityCount;
+
+  if (payloadStart) {
+    bool dataAlignmentIndicator = (ts[6] & 0x84) == 0x84;
+    if (dataAlignmentIndicator) {
+      processLast (reuseFromFront);
+
+      // get pts dts for next pes
+      if (ts[7] & 0x80)
+        mPts = cDvbUtils::getPts (ts+9);
+      if (ts[7] & 0x40)
+        mDts = cDvbUtils::getPts (ts+14);
+      }
+
+    int headerSize = 9 + ts[8];
+    ts += headerSize;
+    tsLeft -= headerSize;
+    }
+
+  // assemble directly into pooled pesBuffer
+  if (mPesBuffer->add (ts, tsLeft))
+    cLog::log (LOGINFO1, fmt::format ("{} pes allocSize doubled to{}", mPidName, mPesBuffer->mAllocSize));
+  }
+//}}}
+//{{{
+void cPesParser::dispatchDecode (cPesBuffer* pesBuffer) {
+// hand pesBuffer pointer to decode queue, assemble next pes into a free one
+
+  if (mUseQueue) {
+    mQueue.enqueue (pesBuffer);
+    mPesBuffer = getFreeBuffer();
+    }
+  else {
+    decode (pesBuffer->mReuseFromFront, pesBuffer->mPes, pesBuffer->mPesSize, pesBuffer->mPts, pesBuffer->mDts);
+    pesBuffer->mPesSize = 0;
+    }
+  }
+//}}}
+//{{{
+void cPesParser::dequeThread() {
+
+  cLog::setThreadName (mPidName + "Q");
+
+  mQueueRunning = true;
+
+  while (!mQueueExit) {
+    cPesBuffer* pesBuffer;
+    if (mQueue.wait_dequeue_timed (pesBuffer, 40000)) {
+      decode (pesBuffer->mReuseFromFront, pesBuffer->mPes, pesBuffer->mPesSize, pesBuffer->mPts, pesBuffer->mDts);
+      recycleBuffer (pesBuffer);
+      }
+    }
+
+  // !!! not sure this is empty the queue on exit !!!!
+
+  mQueueRunning = false;
+  }
+//}}}
+
+// cPesParser private
+//{{{
+cPesParser::cPesBuffer* cPesParser::getFreeBuffer() {
+// parser thread - reuse free pesBuffer, allocate until pool holds kMaxBuffers,
+// - then wait for decode to recycle one, backpressures demux while decode is behind
+
+  cPesBuffer* pesBuffer = nullptr;
+  if (mFreeQueue.try_dequeue (pesBuffer))
+    mNumReused++;
+  else if (!mUseQueue || (mNumAllocated < kMaxBuffers)) {
+    pesBuffer = new cPesBuffer();
+    mNumAllocated++;
+    }
+  else {
+    mNumWaits++;
+    while (!mFreeQueue.wait_dequeue_timed (pesBuffer, 40000))
+      if (mQueueExit) {
+        // dequeThread gone, nothing will recycle
+        pesBuffer = new cPesBuffer();
+        mNumAllocated++;
+        break;
+        }
+    }
+
+  int numInUse = ++mNumInUse;
+  if (numInUse > mHighWaterMark)
+    mHighWaterMark = numInUse;
+
+  pesBuffer->mPesSize = 0;
+  return pesBuffer;
+  }
+//}}}
+//{{{
+void cPesParser::recycleBuffer (cPesBuffer* pesBuffer) {
+// dequeue thread - return pesBuffer to pool, wakes getFreeBuffer waiting on full pool
+
+  mNumInUse--;
+  mFreeQueue.enqueue (pesBuffer);
+  }
+//}}}
+
+// cPidDispatch
+//{{{
+void cPidDispatch::add (int pid, cPidParser* parser) {
+// add parser, replaces ignored pid
+
+  pid &= kPidMask;
+  mParsers[pid] = parser;
+  mIgnored[pid] = false;
+  mParserList.push_back (parser);
+  }
+//}}}
+//{{{
+void cPidDispatch::ignore (int pid) {
+// drop pid without touching parser, leaves any parser owned by table
+
+  mIgnored[pid & kPidMask] = true;
+  }
+//}}}
+
+//{{{
+void cPidDispatch::processLast (bool reuseFromFront) {
+
+  for (auto parser : mParserList)
+    parser->processLast (reuseFromFront);
+  }
+//}}}
+//{{{
+void cPidDispatch::clear() {
+// stop and delete pidParsers
+
+  for (auto parser : mParserList) {
+    parser->exit();
+    delete parser;
+    }
+  mParserList.clear();
+
+  mParsers.fill (nullptr);
+  mIgnored.fill (false);
+  mIgnored[kNullPid] = true;
+  }
+//}}}
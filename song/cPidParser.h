@@ -0,0 +1,180 @@
+// cPidParser.h - ts pid parser base, pooled pes assembly parser, pid indexed parser dispatch
+// - cPesParser assembles pes into recycled cPesBuffers, decodes inline or on its own dequeThread
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <string>
+#include <array>
+#include <vector>
+#include <atomic>
+
+#include "../common/readerWriterQueue.h"
+//}}}
+
+//{{{
+class cPidParser {
+public:
+  cPidParser (int pid, const std::string& name) : mPid(pid), mPidName(name) {}
+  virtual ~cPidParser() = default;
+
+  virtual int getQueueSize() { return 0; }
+  virtual float getQueueFrac() { return 0.f; }
+  virtual std::string getPoolString() { return ""; }
+
+  //{{{
+  void parse (uint8_t* ts, bool reuseFromFront) {
+  // ignore any leading payload before a payloadStart
+
+    bool payloadStart = ts[1] & 0x40;
+    bool hasPayload = ts[3] & 0x10;
+
+    if (hasPayload && (payloadStart || mGotPayloadStart)) {
+      mGotPayloadStart = true;
+      int continuityCount = ts[3] & 0x0F;
+      int headerSize = 1 + ((ts[3] & 0x20) ? 4 + ts[4] : 3);
+      payload (ts + headerSize, 188 - headerSize, payloadStart, continuityCount, reuseFromFront);
+      }
+    }
+  //}}}
+
+  virtual void exit() {}
+  virtual void processLast (bool reuseFromFront) { (void)reuseFromFront; }
+
+protected:
+  virtual void payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront);
+
+  // vars
+  const int mPid;
+  const std::string mPidName;
+  bool mGotPayloadStart = false;
+  };
+//}}}
+//{{{
+class cPesParser : public cPidParser {
+//{{{
+class cPesBuffer {
+// recycled pes assembly buffer, keeps its allocation between pes
+public:
+  cPesBuffer();
+  ~cPesBuffer();
+
+  bool add (uint8_t* buf, int size);
+
+  uint8_t* mPes = nullptr;
+  int mAllocSize = kInitPesSize;
+  int mPesSize = 0;
+
+  bool mReuseFromFront = false;
+  int64_t mPts = 0;
+  int64_t mDts = 0;
+  };
+//}}}
+public:
+  cPesParser (int pid, const std::string& name, bool useQueue);
+  virtual ~cPesParser();
+
+  virtual int getQueueSize() { return (int)mQueue.size_approx(); }
+  virtual float getQueueFrac() { return (float)mQueue.size_approx() / mQueue.max_capacity(); }
+  virtual std::string getPoolString();
+
+  virtual void processLast (bool reuseFromFront);
+  virtual void exit();
+
+protected:
+  virtual void payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront);
+
+  virtual void decode (bool reuseFromFront, uint8_t* pes, int size, int64_t pts, int64_t dts) = 0;
+  void dispatchDecode (cPesBuffer* pesBuffer);
+  void dequeThread();
+
+  int64_t mPts = 0;
+  int64_t mDts = 0;
+  int mContinuityCount = -1;
+
+private:
+  static constexpr int kInitPesSize = 4096;
+  static constexpr int kMaxBuffers = 32;
+
+  cPesBuffer* getFreeBuffer();
+  void recycleBuffer (cPesBuffer* pesBuffer);
+
+  bool mUseQueue = true;
+  bool mQueueExit = false;
+  bool mQueueRunning = false;
+
+  // current assembly buffer
+  cPesBuffer* mPesBuffer = nullptr;
+
+  // pool stats
+  std::atomic<int> mNumInUse = 0;
+  std::atomic<int> mNumAllocated = 0;
+  std::atomic<int> mHighWaterMark = 0;
+  std::atomic<int64_t> mNumReused = 0;
+  std::atomic<int64_t> mNumWaits = 0;
+
+  // full pesBuffers to dequeThread, empty pesBuffers back to parser, at most kMaxBuffers in flight
+  readerWriterQueue::cBlockingReaderWriterQueue <cPesBuffer*> mQueue;
+  readerWriterQueue::cBlockingReaderWriterQueue <cPesBuffer*> mFreeQueue;
+  };
+//}}}
+
+//{{{
+class cPidDispatch {
+// flat pid indexed table of cPidParser, filled as PAT,PMT discover programs
+// - ignored pids are dropped before any parser is touched
+// - ignored pids stay unclaimed, a later PMT may still add a parser for them
+public:
+  cPidDispatch() { mIgnored[kNullPid] = true; }
+  ~cPidDispatch() { clear(); }
+
+  // gets
+  bool has (int pid) const { return mParsers[pid & kPidMask]; }
+  //{{{
+  int getQueueSize (int pid) const {
+    cPidParser* parser = (pid >= 0) ? mParsers[pid & kPidMask] : nullptr;
+    return parser ? parser->getQueueSize() : 0;
+    }
+  //}}}
+  //{{{
+  float getQueueFrac (int pid) const {
+    cPidParser* parser = (pid >= 0) ? mParsers[pid & kPidMask] : nullptr;
+    return parser ? parser->getQueueFrac() : 0.f;
+    }
+  //}}}
+  //{{{
+  std::string getPoolString (int pid) const {
+    cPidParser* parser = (pid >= 0) ? mParsers[pid & kPidMask] : nullptr;
+    return parser ? parser->getPoolString() : "";
+    }
+  //}}}
+
+  // sets
+  void add (int pid, cPidParser* parser);
+  void ignore (int pid);
+
+  // actions
+  //{{{
+  void parse (uint8_t* ts, bool reuseFromFront) {
+
+    int pid = ((ts[1] & 0x1F) << 8) | ts[2];
+    if (mIgnored[pid])
+      return;
+
+    cPidParser* parser = mParsers[pid];
+    if (parser)
+      parser->parse (ts, reuseFromFront);
+    }
+  //}}}
+  void processLast (bool reuseFromFront);
+  void clear();
+
+private:
+  static constexpr int kNumPids = 0x2000;
+  static constexpr int kPidMask = kNumPids - 1;
+  static constexpr int kNullPid = 0x1FFF;
+
+  std::array <cPidParser*, kNumPids> mParsers = {};
+  std::array <bool, kNumPids> mIgnored = {};
+  std::vector <cPidParser*> mParserList;
+  };
+//}}}
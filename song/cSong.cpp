@@ -4,6 +4,9 @@
 
 #include "cSong.h"
 
+#include <new>
+#include <numeric>
+
 #include "../date/include/date/date.h"
 #include "../common/utils.h"
 #include "../common/cLog.h"
@@ -15,31 +18,269 @@ using namespace std;
 //constexpr static float kMinPeakValue = 0.25f;
 //constexpr static float kMinFreqValue = 256.f;
 constexpr static int kSilenceWindowFrames = 4;
+constexpr static size_t kSpectrumBatchFrames = 32;
 //}}}
+//{{{  power,peak kernels
+// - sum of squares and absolute peak per channel over interleaved float samples
+// - simd kernels for 1,2,6 channels, any other numChannels uses the scalar reference
+// - lanes accumulate over a block of lcm(lanes,numChannels) floats, folded to channels at the end
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(_WIN32)
+  #define POWER_PEAK_SSE
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+  #define POWER_PEAK_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace {
+  //{{{
+  void powerPeakScalar (const float* samples, int numSamples, int numChannels, float* power, float* peak) {
+
+    for (int sample = 0; sample < numSamples; sample++)
+      for (int channel = 0; channel < numChannels; channel++) {
+        float value = *samples++;
+        power[channel] += value * value;
+        peak[channel] = max (peak[channel], fabsf (value));
+        }
+    }
+  //}}}
+  //{{{
+  template <int kNumChannels, int kLanes>
+  void foldLanes (const float* sumLanes, const float* maxLanes,
+                  const float* samples, int numFloats, int index, float* power, float* peak) {
+  // fold block lanes to channels, then scalar tail, index is a multiple of kNumChannels
+
+    constexpr int kBlock = std::lcm (kLanes, kNumChannels);
+    for (int lane = 0; lane < kBlock; lane++) {
+      power[lane % kNumChannels] += sumLanes[lane];
+      peak[lane % kNumChannels] = max (peak[lane % kNumChannels], maxLanes[lane]);
+      }
 
-//{{{  cSong::cFrame
-//{{{
-cSong::cFrame::cFrame (int numChannels, int numFreqBytes, float* samples, int64_t pts)
-   : mSamples(samples), mPts(pts), mMuted(false), mSilence(false) {
+    for (; index < numFloats; index++) {
+      float value = samples[index];
+      power[index % kNumChannels] += value * value;
+      peak[index % kNumChannels] = max (peak[index % kNumChannels], fabsf (value));
+      }
+    }
+  //}}}
+
+  #if defined(POWER_PEAK_SSE)
+    //{{{
+    bool useSse41() {
+      static const bool kSse41 = __builtin_cpu_supports ("sse4.1");
+      return kSse41;
+      }
+    //}}}
+    //{{{
+    bool useAvx2() {
+      static const bool kAvx2 = __builtin_cpu_supports ("avx2");
+      return kAvx2;
+      }
+    //}}}
+    //{{{
+    template <int kNumChannels> __attribute__((target("sse4.1")))
+    void powerPeakSse41 (const float* samples, int numSamples, float* power, float* peak) {
+
+      constexpr int kLanes = 4;
+      constexpr int kBlock = std::lcm (kLanes, kNumChannels);
+      constexpr int kVectors = kBlock / kLanes;
+
+      const __m128 absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7FFFFFFF));
+      __m128 sums[kVectors];
+      __m128 maxs[kVectors];
+      for (int vector = 0; vector < kVectors; vector++) {
+        sums[vector] = _mm_setzero_ps();
+        maxs[vector] = _mm_setzero_ps();
+        }
+
+      int numFloats = numSamples * kNumChannels;
+      int index = 0;
+      for (; index + kBlock <= numFloats; index += kBlock)
+        for (int vector = 0; vector < kVectors; vector++) {
+          __m128 value = _mm_loadu_ps (samples + index + (vector * kLanes));
+          sums[vector] = _mm_add_ps (sums[vector], _mm_mul_ps (value, value));
+          maxs[vector] = _mm_max_ps (maxs[vector], _mm_and_ps (value, absMask));
+          }
+
+      float sumLanes[kBlock];
+      float maxLanes[kBlock];
+      for (int vector = 0; vector < kVectors; vector++) {
+        _mm_storeu_ps (sumLanes + (vector * kLanes), sums[vector]);
+        _mm_storeu_ps (maxLanes + (vector * kLanes), maxs[vector]);
+        }
+
+      foldLanes <kNumChannels, kLanes> (sumLanes, maxLanes, samples, numFloats, index, power, peak);
+      }
+    //}}}
+    //{{{
+    template <int kNumChannels> __attribute__((target("avx2")))
+    void powerPeakAvx2 (const float* samples, int numSamples, float* power, float* peak) {
+
+      constexpr int kLanes = 8;
+      constexpr int kBlock = std::lcm (kLanes, kNumChannels);
+      constexpr int kVectors = kBlock / kLanes;
+
+      const __m256 absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7FFFFFFF));
+      __m256 sums[kVectors];
+      __m256 maxs[kVectors];
+      for (int vector = 0; vector < kVectors; vector++) {
+        sums[vector] = _mm256_setzero_ps();
+        maxs[vector] = _mm256_setzero_ps();
+        }
+
+      int numFloats = numSamples * kNumChannels;
+      int index = 0;
+      for (; index + kBlock <= numFloats; index += kBlock)
+        for (int vector = 0; vector < kVectors; vector++) {
+          __m256 value = _mm256_loadu_ps (samples + index + (vector * kLanes));
+          sums[vector] = _mm256_add_ps (sums[vector], _mm256_mul_ps (value, value));
+          maxs[vector] = _mm256_max_ps (maxs[vector], _mm256_and_ps (value, absMask));
+          }
+
+      float sumLanes[kBlock];
+      float maxLanes[kBlock];
+      for (int vector = 0; vector < kVectors; vector++) {
+        _mm256_storeu_ps (sumLanes + (vector * kLanes), sums[vector]);
+        _mm256_storeu_ps (maxLanes + (vector * kLanes), maxs[vector]);
+        }
 
-  mPowerValues = (float*)malloc (numChannels * 4);
-  memset (mPowerValues, 0, numChannels * 4);
+      foldLanes <kNumChannels, kLanes> (sumLanes, maxLanes, samples, numFloats, index, power, peak);
+      }
+    //}}}
 
-  mPeakValues = (float*)malloc (numChannels * 4);
-  memset (mPeakValues, 0, numChannels * 4);
+  #elif defined(POWER_PEAK_NEON)
+    //{{{
+    template <int kNumChannels>
+    void powerPeakNeon (const float* samples, int numSamples, float* power, float* peak) {
+
+      constexpr int kLanes = 4;
+      constexpr int kBlock = std::lcm (kLanes, kNumChannels);
+      constexpr int kVectors = kBlock / kLanes;
+
+      float32x4_t sums[kVectors];
+      float32x4_t maxs[kVectors];
+      for (int vector = 0; vector < kVectors; vector++) {
+        sums[vector] = vdupq_n_f32 (0.f);
+        maxs[vector] = vdupq_n_f32 (0.f);
+        }
+
+      int numFloats = numSamples * kNumChannels;
+      int index = 0;
+      for (; index + kBlock <= numFloats; index += kBlock)
+        for (int vector = 0; vector < kVectors; vector++) {
+          float32x4_t value = vld1q_f32 (samples + index + (vector * kLanes));
+          sums[vector] = vmlaq_f32 (sums[vector], value, value);
+          maxs[vector] = vmaxq_f32 (maxs[vector], vabsq_f32 (value));
+          }
 
-  mFreqValues = (uint8_t*)malloc (numFreqBytes);
-  mFreqLuma = (uint8_t*)malloc (numFreqBytes);
+      float sumLanes[kBlock];
+      float maxLanes[kBlock];
+      for (int vector = 0; vector < kVectors; vector++) {
+        vst1q_f32 (sumLanes + (vector * kLanes), sums[vector]);
+        vst1q_f32 (maxLanes + (vector * kLanes), maxs[vector]);
+        }
+
+      foldLanes <kNumChannels, kLanes> (sumLanes, maxLanes, samples, numFloats, index, power, peak);
+      }
+    //}}}
+  #endif
+
+  //{{{
+  template <int kNumChannels>
+  void powerPeakSimd (const float* samples, int numSamples, float* power, float* peak) {
+
+    #if defined(POWER_PEAK_SSE)
+      if (useAvx2())
+        powerPeakAvx2 <kNumChannels> (samples, numSamples, power, peak);
+      else if (useSse41())
+        powerPeakSse41 <kNumChannels> (samples, numSamples, power, peak);
+      else
+        powerPeakScalar (samples, numSamples, kNumChannels, power, peak);
+    #elif defined(POWER_PEAK_NEON)
+      powerPeakNeon <kNumChannels> (samples, numSamples, power, peak);
+    #else
+      powerPeakScalar (samples, numSamples, kNumChannels, power, peak);
+    #endif
+    }
+  //}}}
+  //{{{
+  void powerPeak (const float* samples, int numSamples, int numChannels, float* power, float* peak) {
+  // accumulate into power,peak, caller zeroes
+
+    switch (numChannels) {
+      case 1: powerPeakSimd<1> (samples, numSamples, power, peak); break;
+      case 2: powerPeakSimd<2> (samples, numSamples, power, peak); break;
+      case 6: powerPeakSimd<6> (samples, numSamples, power, peak); break;
+      default: powerPeakScalar (samples, numSamples, numChannels, power, peak); break;
+      }
+    }
+  //}}}
+  }
+
+//{{{
+string cSong::getPowerPeakKernelName() {
+
+  #if defined(POWER_PEAK_SSE)
+    return useAvx2() ? "avx2" : useSse41() ? "sse4" : "scalar";
+  #elif defined(POWER_PEAK_NEON)
+    return "neon";
+  #else
+    return "scalar";
+  #endif
   }
 //}}}
 //{{{
-cSong::cFrame::~cFrame() {
+bool cSong::checkPowerPeakKernel() {
+// selected kernel against scalar reference, 1,2,6 and odd numChannels, lengths with and without a tail
+// - power differs only by summation order, relative tolerance, peak exact
+
+  constexpr float kPowerTolerance = 1e-4f;
+  const int kNumChannels[] = { 1, 2, 3, 6 };
+  const int kNumSamples[] = { 1, 7, 1023, 1024, 2048 };
+
+  vector <float> samples (2048 * 6);
+  uint32_t noise = 1;
+  for (auto& sample : samples) {
+    noise = (noise * 1664525) + 1013904223;
+    sample = ((noise >> 8) / 8388608.f) - 1.f;
+    }
+
+  bool ok = true;
+  for (int numChannels : kNumChannels)
+    for (int numSamples : kNumSamples) {
+      float power[6] = { 0.f };
+      float peak[6] = { 0.f };
+      powerPeak (samples.data(), numSamples, numChannels, power, peak);
+
+      float scalarPower[6] = { 0.f };
+      float scalarPeak[6] = { 0.f };
+      powerPeakScalar (samples.data(), numSamples, numChannels, scalarPower, scalarPeak);
+
+      for (int channel = 0; channel < numChannels; channel++)
+        if ((fabsf (power[channel] - scalarPower[channel]) > kPowerTolerance * max (1.f, scalarPower[channel])) ||
+            (peak[channel] != scalarPeak[channel])) {
+          cLog::log (LOGERROR, fmt::format ("powerPeak {} mismatch channels:{} samples:{} channel:{} {}:{} {}:{}",
+                                            getPowerPeakKernelName(), numChannels, numSamples, channel,
+                                            power[channel], scalarPower[channel], peak[channel], scalarPeak[channel]));
+          ok = false;
+          }
+      }
 
-  free (mSamples);
-  free (mPowerValues);
-  free (mPeakValues);
-  free (mFreqValues);
-  free (mFreqLuma);
+  return ok;
+  }
+//}}}
+//}}}
+
+//{{{  cSong::cFrame
+//{{{
+void cSong::cFrame::reset (int64_t pts) {
+// ready slab frame for new samples
+
+  mPts = pts;
+  mMuted = false;
+  mSilence = false;
+  mFreqReady = false;
+  mTitle.clear();
   }
 //}}}
 //}}}
@@ -160,6 +401,361 @@ void cSong::cSelect::end() {
 //}}}
 //}}}
 
+//{{{  cSong::cFrameStore
+//{{{
+bool cSong::cFrameStore::insert (int64_t frameNum, cFrame* frame) {
+// insert frame at frameNum, return false if frameNum already has a frame
+
+  int64_t chunkNum = frameNum >> kChunkBits;
+  if (mChunks.empty()) {
+    mFirstChunkNum = chunkNum;
+    mChunks.push_back (nullptr);
+    }
+  else if (chunkNum < mFirstChunkNum) {
+    // grow chunks at front
+    for (int64_t i = chunkNum; i < mFirstChunkNum; i++)
+      mChunks.push_front (nullptr);
+    mFirstChunkNum = chunkNum;
+    }
+  else {
+    // grow chunks at back
+    while (chunkNum >= mFirstChunkNum + (int64_t)mChunks.size())
+      mChunks.push_back (nullptr);
+    }
+
+  cChunk*& chunk = mChunks[(size_t)(chunkNum - mFirstChunkNum)];
+  if (!chunk)
+    chunk = new cChunk();
+
+  cFrame*& slot = chunk->mFrames[frameNum & kChunkMask];
+  if (slot)
+    return false;
+
+  slot = frame;
+  chunk->mNumFrames++;
+
+  if (!mNumFrames) {
+    mFirstFrameNum = frameNum;
+    mLastFrameNum = frameNum;
+    }
+  else {
+    mFirstFrameNum = std::min (mFirstFrameNum, frameNum);
+    mLastFrameNum = std::max (mLastFrameNum, frameNum);
+    }
+  mNumFrames++;
+
+  return true;
+  }
+//}}}
+//{{{
+cSong::cFrame* cSong::cFrameStore::removeFirst() {
+  return empty() ? nullptr : remove (mFirstFrameNum);
+  }
+//}}}
+//{{{
+cSong::cFrame* cSong::cFrameStore::removeLast() {
+  return empty() ? nullptr : remove (mLastFrameNum);
+  }
+//}}}
+//{{{
+void cSong::cFrameStore::clear() {
+// delete chunks, frames belong to the frameSlab
+
+  for (auto chunk : mChunks)
+    delete chunk;
+  mChunks.clear();
+
+  mFirstChunkNum = 0;
+  mNumFrames = 0;
+  mFirstFrameNum = 0;
+  mLastFrameNum = 0;
+  }
+//}}}
+
+//{{{
+cSong::cFrame* cSong::cFrameStore::remove (int64_t frameNum) {
+// remove frame from store, release chunk if empty, trim null chunks from ends
+
+  int64_t chunkIndex = (frameNum >> kChunkBits) - mFirstChunkNum;
+  if ((chunkIndex < 0) || (chunkIndex >= (int64_t)mChunks.size()))
+    return nullptr;
+
+  cChunk*& chunk = mChunks[(size_t)chunkIndex];
+  if (!chunk)
+    return nullptr;
+
+  cFrame* frame = chunk->mFrames[frameNum & kChunkMask];
+  if (!frame)
+    return nullptr;
+
+  chunk->mFrames[frameNum & kChunkMask] = nullptr;
+  mNumFrames--;
+  if (--chunk->mNumFrames == 0) {
+    delete chunk;
+    chunk = nullptr;
+    }
+
+  // trim empty chunks
+  while (!mChunks.empty() && !mChunks.front()) {
+    mChunks.pop_front();
+    mFirstChunkNum++;
+    }
+  while (!mChunks.empty() && !mChunks.back())
+    mChunks.pop_back();
+
+  updateFirstLast();
+  return frame;
+  }
+//}}}
+//{{{
+void cSong::cFrameStore::updateFirstLast() {
+// first,last frameNum are in front,back chunks, both non null after trim
+
+  if (mChunks.empty()) {
+    mFirstChunkNum = 0;
+    mFirstFrameNum = 0;
+    mLastFrameNum = 0;
+    return;
+    }
+
+  cChunk* front = mChunks.front();
+  for (int64_t i = 0; i < kChunkSize; i++)
+    if (front->mFrames[i]) {
+      mFirstFrameNum = (mFirstChunkNum << kChunkBits) + i;
+      break;
+      }
+
+  cChunk* back = mChunks.back();
+  for (int64_t i = kChunkSize-1; i >= 0; i--)
+    if (back->mFrames[i]) {
+      mLastFrameNum = ((mFirstChunkNum + (int64_t)mChunks.size() - 1) << kChunkBits) + i;
+      break;
+      }
+  }
+//}}}
+//}}}
+//{{{  cSong::cFrameSlab
+//{{{
+void cSong::cFrameSlab::init (int numChannels, int samplesPerFrame, int numFreqBytes) {
+
+  clear();
+
+  mNumChannels = numChannels;
+  mNumSamplesBytes = samplesPerFrame * numChannels * sizeof(float);
+  mNumFreqBytes = numFreqBytes;
+
+  mRecordBytes = align (sizeof(cFrame)) +
+                 align (mNumSamplesBytes) +
+                 align (2 * numChannels * sizeof(float)) +
+                 align (2 * mNumFreqBytes);
+  }
+//}}}
+//{{{
+cSong::cFrame* cSong::cFrameSlab::allocFrame (int64_t pts) {
+
+  if (mFreeFrames.empty())
+    addSlab();
+
+  cFrame* frame = mFreeFrames.back();
+  mFreeFrames.pop_back();
+
+  frame->reset (pts);
+  return frame;
+  }
+//}}}
+//{{{
+void cSong::cFrameSlab::freeFrame (cFrame* frame) {
+  mFreeFrames.push_back (frame);
+  }
+//}}}
+//{{{
+void cSong::cFrameSlab::clear() {
+// destruct every record, release slabs
+
+  for (auto slab : mSlabs) {
+    uint8_t* record = (uint8_t*)align ((size_t)slab);
+    for (int i = 0; i < kSlabFrames; i++, record += mRecordBytes)
+      ((cFrame*)record)->~cFrame();
+    ::free (slab);
+    }
+
+  mSlabs.clear();
+  mFreeFrames.clear();
+  mNumAllocated = 0;
+  }
+//}}}
+
+//{{{
+void cSong::cFrameSlab::addSlab() {
+// allocate kSlabFrames records, construct each cFrame pointing at its own arrays
+
+  uint8_t* slab = (uint8_t*)malloc ((kSlabFrames * mRecordBytes) + kAlign);
+  mSlabs.push_back (slab);
+
+  // records on descending address freeList, allocFrame pops lowest first
+  uint8_t* record = (uint8_t*)align ((size_t)slab) + ((kSlabFrames-1) * mRecordBytes);
+  for (int i = 0; i < kSlabFrames; i++, record -= mRecordBytes) {
+    uint8_t* samples = record + align (sizeof(cFrame));
+    uint8_t* values = samples + align (mNumSamplesBytes);
+    uint8_t* freq = values + align (2 * mNumChannels * sizeof(float));
+    memset (values, 0, 2 * mNumChannels * sizeof(float));
+
+    mFreeFrames.push_back (new (record) cFrame ((float*)samples,
+                                               (float*)values, (float*)values + mNumChannels,
+                                               freq, freq + mNumFreqBytes));
+    }
+
+  mNumAllocated += kSlabFrames;
+  }
+//}}}
+//}}}
+//{{{  cSong::cWaveSummary
+//{{{
+void cSong::cWaveSummary::cBucket::add (const cFrame* frame, int numChannels) {
+
+  if (!frame || !frame->mPowerValues)
+    return;
+
+  for (int channel = 0; channel < min (numChannels, 2); channel++) {
+    float power = frame->mPowerValues[channel];
+    mMinPower[channel] = mNumFrames ? min (mMinPower[channel], power) : power;
+    mMaxPower[channel] = max (mMaxPower[channel], power);
+    mMaxPeak[channel] = max (mMaxPeak[channel], frame->mPeakValues[channel]);
+    mSumSquares[channel] += power * power;
+    }
+
+  mSilence |= frame->isSilence();
+  mNumFrames++;
+  }
+//}}}
+//{{{
+void cSong::cWaveSummary::cBucket::add (const cBucket& bucket) {
+
+  if (!bucket.mNumFrames)
+    return;
+
+  for (int channel = 0; channel < 2; channel++) {
+    mMinPower[channel] = mNumFrames ? min (mMinPower[channel], bucket.mMinPower[channel]) : bucket.mMinPower[channel];
+    mMaxPower[channel] = max (mMaxPower[channel], bucket.mMaxPower[channel]);
+    mMaxPeak[channel] = max (mMaxPeak[channel], bucket.mMaxPeak[channel]);
+    mSumSquares[channel] += bucket.mSumSquares[channel];
+    }
+
+  mSilence |= bucket.mSilence;
+  mNumFrames += bucket.mNumFrames;
+  }
+//}}}
+
+//{{{
+cSong::cWaveSummary::cBucket cSong::cWaveSummary::get (const cFrameStore& frameStore,
+                                                       int64_t firstFrameNum, int64_t lastFrameNum,
+                                                       int numChannels) const {
+// walk range using largest aligned bucket that fits at each step
+
+  cBucket summary;
+
+  int64_t frameNum = firstFrameNum;
+  while (frameNum < lastFrameNum) {
+    int level = 0;
+    while ((level < kNumLevels) &&
+           !(frameNum & ((int64_t(2) << level) - 1)) &&
+           (frameNum + (int64_t(2) << level) <= lastFrameNum))
+      level++;
+
+    if (level == 0)
+      summary.add (frameStore.find (frameNum), numChannels);
+    else {
+      const cBucket* bucket = findBucket (level, frameNum >> level);
+      if (bucket)
+        summary.add (*bucket);
+      }
+
+    frameNum += int64_t(1) << level;
+    }
+
+  return summary;
+  }
+//}}}
+
+//{{{
+void cSong::cWaveSummary::update (const cFrameStore& frameStore, int64_t frameNum, int numChannels) {
+// recalc buckets containing frameNum from their two children, bottom up
+
+  for (int level = 1; level <= kNumLevels; level++) {
+    cLevel& levelBuckets = mLevels[level-1];
+    int64_t bucketNum = frameNum >> level;
+
+    // recalc bucket from children
+    cBucket bucket;
+    int64_t childNum = bucketNum << 1;
+    if (level == 1) {
+      bucket.add (frameStore.find (childNum), numChannels);
+      bucket.add (frameStore.find (childNum+1), numChannels);
+      }
+    else {
+      const cBucket* child = findBucket (level-1, childNum);
+      if (child)
+        bucket.add (*child);
+      child = findBucket (level-1, childNum+1);
+      if (child)
+        bucket.add (*child);
+      }
+
+    if (bucket.mNumFrames) {
+      // grow level to include bucketNum
+      if (levelBuckets.mBuckets.empty()) {
+        levelBuckets.mFirstBucketNum = bucketNum;
+        levelBuckets.mBuckets.push_back (cBucket());
+        }
+      else if (bucketNum < levelBuckets.mFirstBucketNum) {
+        for (int64_t i = bucketNum; i < levelBuckets.mFirstBucketNum; i++)
+          levelBuckets.mBuckets.push_front (cBucket());
+        levelBuckets.mFirstBucketNum = bucketNum;
+        }
+      else
+        while (bucketNum >= levelBuckets.mFirstBucketNum + (int64_t)levelBuckets.mBuckets.size())
+          levelBuckets.mBuckets.push_back (cBucket());
+
+      levelBuckets.mBuckets[(size_t)(bucketNum - levelBuckets.mFirstBucketNum)] = bucket;
+      }
+
+    else if (findBucket (level, bucketNum)) {
+      // now empty, trim empty buckets from ends
+      levelBuckets.mBuckets[(size_t)(bucketNum - levelBuckets.mFirstBucketNum)] = bucket;
+      while (!levelBuckets.mBuckets.empty() && !levelBuckets.mBuckets.front().mNumFrames) {
+        levelBuckets.mBuckets.pop_front();
+        levelBuckets.mFirstBucketNum++;
+        }
+      while (!levelBuckets.mBuckets.empty() && !levelBuckets.mBuckets.back().mNumFrames)
+        levelBuckets.mBuckets.pop_back();
+      }
+    }
+  }
+//}}}
+//{{{
+void cSong::cWaveSummary::clear() {
+
+  for (auto& level : mLevels) {
+    level.mBuckets.clear();
+    level.mFirstBucketNum = 0;
+    }
+  }
+//}}}
+
+//{{{
+const cSong::cWaveSummary::cBucket* cSong::cWaveSummary::findBucket (int level, int64_t bucketNum) const {
+
+  const cLevel& levelBuckets = mLevels[level-1];
+
+  int64_t index = bucketNum - levelBuckets.mFirstBucketNum;
+  if ((index < 0) || (index >= (int64_t)levelBuckets.mBuckets.size()))
+    return nullptr;
+
+  return &levelBuckets.mBuckets[(size_t)index];
+  }
+//}}}
+//}}}
+
 // cSong
 //{{{
 cSong::cSong (eAudioFrameType frameType, int numChannels, int sampleRate, int samplesPerFrame, int maxMapSize)
@@ -167,23 +763,31 @@ cSong::cSong (eAudioFrameType frameType, int numChannels, int sampleRate, int sa
       mFrameType(frameType), mNumChannels(numChannels),
       mMaxMapSize(maxMapSize) {
 
-  mFftrConfig = kiss_fftr_alloc (mSamplesPerFrame, 0, 0, 0);
+  mFrameSlab.init (mNumChannels, mSamplesPerFrame, getNumFreqBytes());
+  mSpectrumThread = thread ([=,this]() { spectrumThread(); });
   }
 //}}}
 //{{{
 cSong::~cSong() {
 
+  {
+  unique_lock<mutex> lock (mSpectrumMutex);
+  mSpectrumExit = true;
+  }
+  mSpectrumCondition.notify_one();
+  mSpectrumThread.join();
+
   unique_lock<shared_mutex> lock (mSharedMutex);
 
   // reset frames
   mSelect.clearAll();
 
-  for (auto frame : mFrameMap)
-    delete (frame.second);
-  mFrameMap.clear();
+  mFrameStore.clear();
+  mFrameSlab.clear();
+  mWaveSummary.clear();
 
-  // delloc this???
-  // kiss_fftr_alloc (mSamplesPerFrame, 0, 0, 0);
+  mQuietRuns.clear();
+  mSilenceRuns.clear();
   }
 //}}}
 
@@ -223,6 +827,68 @@ string cSong::getLastTimeString (int daylightSeconds) const {
   }
 //}}}
 
+//{{{
+bool cSong::isFreqReady (int64_t frameNum) const {
+
+  shared_lock<shared_mutex> lock (mSharedMutex);
+  cFrame* frame = findFrameByFrameNum (frameNum);
+  return frame && frame->isFreqReady();
+  }
+//}}}
+
+//{{{
+bool cSong::isSilenceFrame (int64_t frameNum) const {
+
+  shared_lock<shared_mutex> lock (mSharedMutex);
+  return findRun (mSilenceRuns, frameNum) != nullptr;
+  }
+//}}}
+//{{{
+vector <pair <int64_t,int64_t>> cSong::getSilenceRuns (int64_t firstFrameNum, int64_t lastFrameNum) const {
+// return silenceRuns overlapping firstFrameNum to lastFrameNum
+
+  vector <pair <int64_t,int64_t>> silenceRuns;
+
+  shared_lock<shared_mutex> lock (mSharedMutex);
+  auto it = mSilenceRuns.upper_bound (firstFrameNum);
+  if ((it != mSilenceRuns.begin()) && (prev (it)->second >= firstFrameNum))
+    --it;
+  for (; (it != mSilenceRuns.end()) && (it->first <= lastFrameNum); ++it)
+    silenceRuns.push_back (*it);
+
+  return silenceRuns;
+  }
+//}}}
+
+// cSong - spectrum
+//{{{
+void cSong::setSpectrum (bool spectrum) {
+// turning on queues any loaded frames still without a spectrum
+
+  vector <int64_t> frameNums;
+  if (spectrum) {
+    shared_lock<shared_mutex> lock (mSharedMutex);
+    if (!mFrameStore.empty())
+      for (int64_t frameNum = getFirstFrameNum(); frameNum <= getLastFrameNum(); frameNum++) {
+        cFrame* frame = findFrameByFrameNum (frameNum);
+        if (frame && !frame->isFreqReady())
+          frameNums.push_back (frameNum);
+        }
+    }
+
+  {
+  unique_lock<mutex> lock (mSpectrumMutex);
+  mSpectrum = spectrum;
+  if (spectrum)
+    mSpectrumPending.insert (frameNums.begin(), frameNums.end());
+  else
+    mSpectrumPending.clear();
+  }
+
+  mSpectrumCondition.notify_one();
+  }
+//}}}
+
 // cSong - play
 //{{{
 void cSong::setPlayPts (int64_t pts) {
@@ -262,6 +928,7 @@ void cSong::incPlaySec (int seconds, bool useSelectRange) {
 //{{{
 void cSong::prevSilencePlayFrame() {
 
+  shared_lock<shared_mutex> lock (mSharedMutex);
   mPlayPts = skipPrev (mPlayPts, false);
   mPlayPts = skipPrev (mPlayPts, true);
   mPlayPts = skipPrev (mPlayPts, false);
@@ -270,6 +937,7 @@ void cSong::prevSilencePlayFrame() {
 //{{{
 void cSong::nextSilencePlayFrame() {
 
+  shared_lock<shared_mutex> lock (mSharedMutex);
   mPlayPts = skipNext (mPlayPts, true);
   mPlayPts = skipNext (mPlayPts, false);
   mPlayPts = skipNext (mPlayPts, true);
@@ -278,37 +946,78 @@ void cSong::nextSilencePlayFrame() {
 
 // cSong - add
 //{{{
-void cSong::addFrame (bool reuseFront, int64_t pts, float* samples, int64_t totalFrames) {
+void cSong::copyFrame (bool reuseFront, int64_t pts, const float* samples, int64_t totalFrames) {
+
+  cFrame* frame = getFreeFrame (reuseFront, pts);
+  memcpy (frame->mSamples, samples, mFrameSlab.getNumSamplesBytes());
+  addFrame (frame, totalFrames);
+  }
+//}}}
+//{{{
+bool cSong::decodeFrame (iAudioDecoder* decoder, bool reuseFront, const uint8_t* frameData, int frameSize,
+                         int64_t pts, int64_t totalFrames) {
+// decoder writes samples straight into a frame record, frame not matching song dropped
+
+  cFrame* frame = nullptr;
+  int numSamples = decoder->decodeFrame (frameData, frameSize, pts,
+    [&](int numChannels, int numSamples) noexcept -> float* {
+      if ((numChannels != mNumChannels) || (numSamples > mSamplesPerFrame)) {
+        if (!mNumMismatchedFrames++)
+          cLog::log (LOGERROR, fmt::format ("decodeFrame channels:{} samples:{} not song channels:{} samples:{}",
+                                            numChannels, numSamples, mNumChannels, mSamplesPerFrame));
+        return nullptr;
+        }
+      frame = getFreeFrame (reuseFront, pts);
+      return frame->mSamples;
+      });
+
+  if (!frame)
+    return false;
+
+  if (!numSamples) {
+    // nothing decoded into frame, back to slab
+    mFrameSlab.freeFrame (frame);
+    return false;
+    }
+
+  if (numSamples < mSamplesPerFrame)
+    memset (frame->mSamples + (numSamples * mNumChannels), 0,
+            (mSamplesPerFrame - numSamples) * mNumChannels * sizeof(float));
+
+  addFrame (frame, totalFrames);
+  return true;
+  }
+//}}}
+
+// cSong - private
+//{{{
+cSong::cFrame* cSong::getFreeFrame (bool reuseFront, int64_t pts) {
+// frame record to fill, reuse first or last frame once past maxMapSize, else from slab
 
   cFrame* frame;
-  if (mMaxMapSize && (int(mFrameMap.size()) > mMaxMapSize)) { // reuse a cFrame
+  if (mMaxMapSize && (mFrameStore.size() > mMaxMapSize)) { // reuse a cFrame
     //{{{  remove with lock
     {
     unique_lock<shared_mutex> lock (mSharedMutex);
-    if (reuseFront) {
-      //{{{  remove frame from map begin, reuse it
-      auto it = mFrameMap.begin();
-      frame = (*it).second;
-      mFrameMap.erase (it);
-      }
-      //}}}
-    else {
-      //{{{  remove frame from map end, reuse it
-      auto it = prev (mFrameMap.end());
-      frame = (*it).second;
-      mFrameMap.erase (it);
-      }
-      //}}}
+    // remove frame from frameStore first or last, reuse it
+    frame = reuseFront ? mFrameStore.removeFirst() : mFrameStore.removeLast();
+    mWaveSummary.update (mFrameStore, frame->mPts / getFramePtsDuration(), mNumChannels);
+    removeSilenceFrame (frame->mPts / getFramePtsDuration());
     } // end of locked mutex
     //}}}
-    //{{{  reuse power,peak,fft buffers, but free samples if we own them
-    free (frame->mSamples);
-    frame->mSamples = samples;
-    frame->mPts = pts;
-    //}}}
+    frame->reset (pts);
     }
-  else // allocate new cFrame
-    frame = new cFrame (mNumChannels, getNumFreqBytes(), samples, pts);
+  else // allocate slab frame
+    frame = mFrameSlab.allocFrame (pts);
+
+  return frame;
+  }
+//}}}
+//{{{
+void cSong::addFrame (cFrame* frame, int64_t totalFrames) {
+// filled frame, calc power,peak, insert, queue for spectrum
+
+  int64_t pts = frame->mPts;
 
   //{{{  calc power,peak
   for (auto channel = 0; channel < mNumChannels; channel++) {
@@ -316,16 +1025,7 @@ void cSong::addFrame (bool reuseFront, int64_t pts, float* samples, int64_t tota
     frame->mPeakValues[channel] = 0.f;
     }
 
-  auto samplePtr = samples;
-  for (int sample = 0; sample < mSamplesPerFrame; sample++) {
-    mTimeBuf[sample] = 0;
-    for (auto channel = 0; channel < mNumChannels; channel++) {
-      auto value = *samplePtr++;
-      mTimeBuf[sample] += value;
-      frame->mPowerValues[channel] += value * value;
-      frame->mPeakValues[channel] = max (abs(frame->mPeakValues[channel]), value);
-      }
-    }
+  powerPeak (frame->mSamples, mSamplesPerFrame, mNumChannels, frame->mPowerValues, frame->mPeakValues);
 
   // max
   for (auto channel = 0; channel < mNumChannels; channel++) {
@@ -335,97 +1035,292 @@ void cSong::addFrame (bool reuseFront, int64_t pts, float* samples, int64_t tota
     }
   //}}}
 
-  // ??? lock against init fftrConfig recalc???
-  kiss_fftr (mFftrConfig, mTimeBuf, mFreqBuf);
-  //{{{  calc frequency values,luma
-  float freqScale = 255.f / mMaxFreqValue;
-  auto freqBufPtr = mFreqBuf;
-  auto freqValuesPtr = frame->mFreqValues;
-  auto lumaValuesPtr = frame->mFreqLuma + getNumFreqBytes() - 1;
-  for (uint32_t i = 0; i < getNumFreqBytes(); i++) {
-    float value = sqrtf (((*freqBufPtr).r * (*freqBufPtr).r) + ((*freqBufPtr).i * (*freqBufPtr).i));
-    mMaxFreqValue = max (mMaxFreqValue, value);
-
-    // freq scaled to byte, used by gui
-    value *= freqScale;
-    *freqValuesPtr++ = value > 255 ? 255 : uint8_t(value);
+  { // insert with lock
+  unique_lock<shared_mutex> lock (mSharedMutex);
+  if (!mFrameStore.insert (pts/getFramePtsDuration(), frame)) {
+    // already have frame for this frameNum, discard duplicate
+    cLog::log (LOGINFO1, fmt::format ("addFrame duplicate frameNum:{}", pts/getFramePtsDuration()));
+    mFrameSlab.freeFrame (frame);
+    }
+  else {
+    mWaveSummary.update (mFrameStore, pts/getFramePtsDuration(), mNumChannels);
+    if (frame->isQuiet())
+      addQuietFrame (pts/getFramePtsDuration());
+    }
+  mTotalFrames = totalFrames;
+  }
 
-    // crush luma, reverse index, used by gui copy to bitmap
-    value *= 4.f;
-    *lumaValuesPtr-- = value > 255 ? 255 : uint8_t(value);
+  //{{{  queue frame for spectrum worker
+  {
+  unique_lock<mutex> lock (mSpectrumMutex);
+  mSpectrumPtsDuration = getFramePtsDuration();
+  if (mSpectrum)
+    mSpectrumPending.insert (pts/getFramePtsDuration());
+  }
 
-    freqBufPtr++;
-    }
+  mSpectrumCondition.notify_one();
   //}}}
+  }
+//}}}
+//{{{
+const pair<const int64_t,int64_t>* cSong::findRun (const map <int64_t,int64_t>& runs, int64_t frameNum) {
+// return run containing frameNum, nullptr if none
 
-  { // insert with lock
-  unique_lock<shared_mutex> lock (mSharedMutex);
-  mFrameMap.insert (map<int64_t,cFrame*>::value_type (pts/getFramePtsDuration(), frame));
-  mTotalFrames = totalFrames;
+  auto it = runs.upper_bound (frameNum);
+  if (it == runs.begin())
+    return nullptr;
+
+  --it;
+  return (it->second >= frameNum) ? &(*it) : nullptr;
   }
+//}}}
+//{{{
+void cSong::splitRun (map <int64_t,int64_t>& runs, int64_t frameNum) {
+// remove frameNum from its run, splitting it
+
+  auto run = findRun (runs, frameNum);
+  if (!run)
+    return;
 
-  checkSilenceWindow (pts);
+  int64_t firstFrameNum = run->first;
+  int64_t lastFrameNum = run->second;
+  runs.erase (firstFrameNum);
+
+  if (firstFrameNum < frameNum)
+    runs[firstFrameNum] = frameNum - 1;
+  if (lastFrameNum > frameNum)
+    runs[frameNum + 1] = lastFrameNum;
   }
 //}}}
 
-// cSong - private
 //{{{
 int64_t cSong::skipPrev (int64_t fromPts, bool silence) {
+// return pts of nearest frame before fromPts whose silence differs, locked by caller
+
+  int64_t frameNum = getFrameNumFromPts (fromPts) - 1;
+
+  if (silence) {
+    // skip back over silenceRuns and missing frames, to a loaded frame outside any silenceRun
+    while (frameNum >= getFirstFrameNum()) {
+      auto run = findRun (mSilenceRuns, frameNum);
+      if (run)
+        frameNum = run->first - 1;
+      else if (findFrameByFrameNum (frameNum))
+        return getPtsFromFrameNum (frameNum);
+      else
+        frameNum--;
+      }
+    }
 
-  int64_t fromFrame = getFrameNumFromPts (fromPts);
-
-  for (int64_t frameNum = fromFrame-1; frameNum >= getFirstFrameNum(); frameNum--) {
-    auto framePtr = findFrameByFrameNum (frameNum);
-    if (framePtr && (framePtr->isSilence() ^ silence))
-      return getPtsFromFrameNum (frameNum);
-   }
+  else {
+    // last frame of silenceRun containing or before frameNum
+    auto it = mSilenceRuns.upper_bound (frameNum);
+    if (it != mSilenceRuns.begin())
+      return getPtsFromFrameNum (min (frameNum, prev (it)->second));
+    }
 
   return fromPts;
   }
 //}}}
 //{{{
 int64_t cSong::skipNext (int64_t fromPts, bool silence) {
+// return pts of nearest frame from fromPts whose silence differs, locked by caller
+
+  int64_t frameNum = getFrameNumFromPts (fromPts);
+
+  if (silence) {
+    // skip forward over silenceRuns and missing frames, to a loaded frame outside any silenceRun
+    while (frameNum <= getLastFrameNum()) {
+      auto run = findRun (mSilenceRuns, frameNum);
+      if (run)
+        frameNum = run->second + 1;
+      else if (findFrameByFrameNum (frameNum))
+        return getPtsFromFrameNum (frameNum);
+      else
+        frameNum++;
+      }
+    }
 
-  int64_t fromFrame = getFrameNumFromPts (fromPts);
-
-  for (int64_t frameNum = fromFrame; frameNum <= getLastFrameNum(); frameNum++) {
-    auto framePtr = findFrameByFrameNum (frameNum);
-    if (framePtr && (framePtr->isSilence() ^ silence))
+  else {
+    // first frame of silenceRun containing or after frameNum
+    auto run = findRun (mSilenceRuns, frameNum);
+    if (run)
       return getPtsFromFrameNum (frameNum);
+
+    auto it = mSilenceRuns.upper_bound (frameNum);
+    if (it != mSilenceRuns.end())
+      return getPtsFromFrameNum (it->first);
     }
 
   return fromPts;
   }
 //}}}
+
 //{{{
-void cSong::checkSilenceWindow (int64_t pts) {
+void cSong::addQuietFrame (int64_t frameNum) {
+// merge frameNum with neighbouring quietRuns, runs over kSilenceWindowFrames become silence, locked by caller
 
-  unique_lock<shared_mutex> lock (mSharedMutex);
+  if (findRun (mQuietRuns, frameNum))
+    return;
 
-  // walk backwards looking for continuous loaded quiet frames
-  int64_t frameNum = getFrameNumFromPts (pts);
+  int64_t firstFrameNum = frameNum;
+  int64_t lastFrameNum = frameNum;
 
-  auto windowSize = 0;
-  while (true) {
-    auto frame = findFrameByFrameNum (frameNum);
-    if (frame && frame->isQuiet()) {
-      windowSize++;
-      frameNum--;
+  auto it = mQuietRuns.upper_bound (frameNum);
+  if ((it != mQuietRuns.end()) && (it->first == frameNum + 1)) {
+    lastFrameNum = it->second;
+    it = mQuietRuns.erase (it);
+    }
+  if ((it != mQuietRuns.begin()) && (prev (it)->second == frameNum - 1)) {
+    firstFrameNum = prev (it)->first;
+    mQuietRuns.erase (prev (it));
+    }
+  mQuietRuns[firstFrameNum] = lastFrameNum;
+
+  if (lastFrameNum - firstFrameNum + 1 <= kSilenceWindowFrames)
+    return;
+
+  //{{{
+  auto setSilence = [&](int64_t fromFrameNum, int64_t toFrameNum) {
+
+    for (int64_t silenceFrameNum = fromFrameNum; silenceFrameNum <= toFrameNum; silenceFrameNum++) {
+      cFrame* frame = findFrameByFrameNum (silenceFrameNum);
+      if (frame && !frame->isSilence()) {
+        frame->setSilence (true);
+        mWaveSummary.update (mFrameStore, silenceFrameNum, mNumChannels);
+        }
       }
-    else
-      break;
     };
+  //}}}
 
-  if (windowSize > kSilenceWindowFrames) {
-    // walk forward setting silence for continuous loaded quiet frames
-    while (true) {
-      auto frame = findFrameByFrameNum (++frameNum);
-      if (frame && frame->isQuiet())
-        frame->setSilence (true);
-      else
-        break;
+  // silenceRuns lie within quietRuns, absorb those inside this run, set silence on the frames between
+  int64_t silenceFrameNum = firstFrameNum;
+  auto silenceIt = mSilenceRuns.lower_bound (firstFrameNum);
+  while ((silenceIt != mSilenceRuns.end()) && (silenceIt->first <= lastFrameNum)) {
+    setSilence (silenceFrameNum, silenceIt->first - 1);
+    silenceFrameNum = silenceIt->second + 1;
+    silenceIt = mSilenceRuns.erase (silenceIt);
+    }
+  setSilence (silenceFrameNum, lastFrameNum);
+
+  mSilenceRuns[firstFrameNum] = lastFrameNum;
+  }
+//}}}
+//{{{
+void cSong::removeSilenceFrame (int64_t frameNum) {
+// frame leaving frameStore, split its runs, locked by caller
+
+  splitRun (mQuietRuns, frameNum);
+  splitRun (mSilenceRuns, frameNum);
+  }
+//}}}
+
+//{{{
+void cSong::spectrumThread() {
+// own fft plan and buffers, frames filled a batch at a time under shared lock
+
+  cLog::setThreadName ("spec");
+
+  kiss_fftr_cfg fftrConfig = kiss_fftr_alloc (mSamplesPerFrame, 0, 0, 0);
+  vector <kiss_fft_scalar> timeBuf (kMaxNumSamplesPerFrame);
+  vector <kiss_fft_cpx> freqBuf (kMaxFreq);
+
+  vector <int64_t> batch;
+  batch.reserve (kSpectrumBatchFrames);
+
+  while (true) {
+    {
+    unique_lock<mutex> lock (mSpectrumMutex);
+    mSpectrumCondition.wait (lock, [&]() { return mSpectrumExit || !mSpectrumPending.empty(); });
+    if (mSpectrumExit)
+      break;
+    takeSpectrumBatch (batch);
+    }
+
+    {
+    shared_lock<shared_mutex> lock (mSharedMutex);
+    for (int64_t frameNum : batch) {
+      // frame may have gone or been reused since it was queued
+      cFrame* frame = findFrameByFrameNum (frameNum);
+      if (frame && !frame->isFreqReady())
+        calcSpectrum (frame, fftrConfig, timeBuf.data(), freqBuf.data());
+      }
+    }
+    }
+
+  kiss_fftr_free (fftrConfig);
+  }
+//}}}
+//{{{
+void cSong::takeSpectrumBatch (vector <int64_t>& batch) {
+// take pending frameNums nearest play, then view, frameNum, locked by caller
+
+  batch.clear();
+
+  //{{{
+  auto takeNearest = [&](int64_t frameNum, size_t numFrames) {
+  // take up to numFrames nearest frameNum, ahead wins a tie
+
+    while (numFrames-- && !mSpectrumPending.empty()) {
+      auto it = mSpectrumPending.lower_bound (frameNum);
+      if ((it == mSpectrumPending.end()) ||
+          ((it != mSpectrumPending.begin()) && ((frameNum - *prev (it)) < (*it - frameNum))))
+        --it;
+
+      batch.push_back (*it);
+      mSpectrumPending.erase (it);
       }
+    };
+  //}}}
+
+  int64_t playFrameNum = mPlayPts / mSpectrumPtsDuration;
+  int64_t viewFrameNum = mViewFrameNum;
+
+  if (viewFrameNum < 0) {
+    takeNearest (playFrameNum, kSpectrumBatchFrames);
+    return;
+    }
+
+  takeNearest (playFrameNum, kSpectrumBatchFrames / 2);
+  takeNearest (viewFrameNum, kSpectrumBatchFrames - batch.size());
+  }
+//}}}
+//{{{
+void cSong::calcSpectrum (cFrame* frame, kiss_fftr_cfg fftrConfig, kiss_fft_scalar* timeBuf, kiss_fft_cpx* freqBuf) {
+
+  // mono mix
+  auto samplePtr = frame->mSamples;
+  for (int sample = 0; sample < mSamplesPerFrame; sample++) {
+    float value = 0.f;
+    for (auto channel = 0; channel < mNumChannels; channel++)
+      value += *samplePtr++;
+    timeBuf[sample] = value;
+    }
+
+  kiss_fftr (fftrConfig, timeBuf, freqBuf);
+
+  //{{{  calc frequency values,luma
+  float freqScale = 255.f / mMaxFreqValue;
+  auto freqBufPtr = freqBuf;
+  auto freqValuesPtr = frame->mFreqValues;
+  auto lumaValuesPtr = frame->mFreqLuma + getNumFreqBytes() - 1;
+  for (uint32_t i = 0; i < getNumFreqBytes(); i++) {
+    float value = sqrtf (((*freqBufPtr).r * (*freqBufPtr).r) + ((*freqBufPtr).i * (*freqBufPtr).i));
+    mMaxFreqValue = max (mMaxFreqValue, value);
+
+    // freq scaled to byte, used by gui
+    value *= freqScale;
+    *freqValuesPtr++ = value > 255 ? 255 : uint8_t(value);
+
+    // crush luma, reverse index, used by gui copy to bitmap
+    value *= 4.f;
+    *lumaValuesPtr-- = value > 255 ? 255 : uint8_t(value);
+
+    freqBufPtr++;
     }
+  //}}}
+
+  frame->mFreqReady = true;
   }
 //}}}
 
@@ -490,46 +1385,50 @@ cHlsSong::cHlsSong (eAudioFrameType frameType, int numChannels,
 //}}}
 
 //{{{
-int cHlsSong::getLoadChunkNum (int64_t& loadPts, bool& reuseFromFront) const {
-// return chunkNum needed to play or preload playPts
-
-  // get frameNumOffset of playPts from basePts
-  int64_t frameNumOffset = getFrameNumFromPts (mPlayPts) - getFrameNumFromPts (mBasePts);
-
-  // chunkNumOffset, handle -v offsets correctly
-  int64_t chunkNumOffset = frameNumOffset / mFramesPerChunk;
-  if (frameNumOffset < 0)
-    chunkNumOffset -= mFramesPerChunk - 1;
+int64_t cHlsSong::getChunkPts (int chunkNum) const {
+// return pts of first frame of chunkNum
 
-  int chunkNum = mBaseChunkNum + (int)chunkNumOffset;
-  loadPts = mBasePts + ((chunkNum - mBaseChunkNum) * mFramesPerChunk) * mFramePtsDuration;
-
-  // test for chunkNum available now
+  return mBasePts + ((chunkNum - mBaseChunkNum) * mFramesPerChunk) * mFramePtsDuration;
+  }
+//}}}
+//{{{
+vector<int> cHlsSong::getLoadChunkNums (int ahead, int behind) const {
+// return chunkNums needed to play or preload playPts, playPts chunk first, then ahead, then behind
+
+  int64_t frameNumOffset;
+  int playChunkNum = getPlayChunkNum (frameNumOffset);
+  int64_t chunkNumOffset = playChunkNum - mBaseChunkNum;
+
+  // check firstFrame of each chunk loaded
+  vector<int> chunkNums;
+  for (int chunkNum = playChunkNum; chunkNum <= playChunkNum + ahead; chunkNum++)
+    if (!findFrameByPts (getChunkPts (chunkNum)))
+      chunkNums.push_back (chunkNum);
+  for (int chunkNum = playChunkNum - 1; chunkNum >= playChunkNum - behind; chunkNum--)
+    if (!findFrameByPts (getChunkPts (chunkNum)))
+      chunkNums.push_back (chunkNum);
+
+  if (!chunkNums.empty())
+    cLog::log (LOGINFO1, fmt::format ("getLoadChunkNums - offset:{} {} play:{} first:{} num:{}",
+                                      frameNumOffset, chunkNumOffset, playChunkNum,
+                                      chunkNums.front(), chunkNums.size()));
+  return chunkNums;
+  }
+//}}}
+//{{{
+int64_t cHlsSong::getBufferedPts (int ahead) const {
+// return pts loaded ahead of playPts, up to first chunk not loaded, looking at most ahead chunks past play chunk
 
-  // check playPts chunkNum for firstFrame of chunk loaded
-  if (!findFrameByPts (loadPts)) {
-    reuseFromFront = loadPts >= mPlayPts;
-    cLog::log (LOGINFO1, fmt::format ("getLoadChunk - load offset:{} {} chunkNum{} pts{} {}",
-                           frameNumOffset, chunkNumOffset,chunkNum, utils::getPtsFramesString (loadPts, getFramePtsDuration()),
-                           (reuseFromFront ? " front" : " back")));
-    return chunkNum;
-    }
+  int64_t frameNumOffset;
+  int playChunkNum = getPlayChunkNum (frameNumOffset);
+  if (!findFrameByPts (getChunkPts (playChunkNum)))
+    return 0;
 
-  // check preload chunkNum+1
-  chunkNum++;
-  loadPts += mFramesPerChunk * mFramePtsDuration;
-  if (!findFrameByPts (loadPts))  {
-    reuseFromFront = loadPts >= mPlayPts;
-    cLog::log (LOGINFO1, fmt::format ("getLoadChunk - preload+1 offset:{} {} chunkNum{} pts{} {}",
-                         frameNumOffset,chunkNumOffset, chunkNum, utils::getPtsFramesString (loadPts, getFramePtsDuration()),
-                         (reuseFromFront ? " front" : " back")));
-    return chunkNum;
-    }
+  int chunkNum = playChunkNum + 1;
+  while ((chunkNum <= playChunkNum + ahead) && findFrameByPts (getChunkPts (chunkNum)))
+    chunkNum++;
 
-  // return no chunkNum to load
-  loadPts = -1;
-  reuseFromFront = false;
-  return 0;
+  return max (getChunkPts (chunkNum) - mPlayPts, (int64_t)0);
   }
 //}}}
 //{{{
@@ -548,3 +1447,18 @@ void cHlsSong::setBaseHls (int64_t pts, chrono::system_clock::time_point timePoi
   mBaseChunkNum = chunkNum;
   }
 //}}}
+
+//{{{
+int cHlsSong::getPlayChunkNum (int64_t& frameNumOffset) const {
+// return chunkNum holding playPts, frameNumOffset of playPts from basePts
+
+  frameNumOffset = getFrameNumFromPts (mPlayPts) - getFrameNumFromPts (mBasePts);
+
+  // chunkNumOffset, handle -v offsets correctly
+  int64_t chunkNumOffset = frameNumOffset / mFramesPerChunk;
+  if (frameNumOffset < 0)
+    chunkNumOffset -= mFramesPerChunk - 1;
+
+  return mBaseChunkNum + (int)chunkNumOffset;
+  }
+//}}}
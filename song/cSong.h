@@ -6,10 +6,17 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
+#include <array>
 #include <functional>
 #include <algorithm>
+#include <cmath>
+#include <set>
+#include <atomic>
+#include <thread>
 #include <mutex>
 #include <shared_mutex>
+#include <condition_variable>
 
 #include "../decoders/cAudioParser.h"
 
@@ -22,8 +29,10 @@ public:
   //{{{
   class cFrame {
   public:
-    cFrame (int numChannels, int numFreqBytes, float* samples, int64_t pts);
-    virtual ~cFrame();
+    cFrame (float* samples, float* powerValues, float* peakValues, uint8_t* freqValues, uint8_t* freqLuma)
+      : mSamples(samples), mPowerValues(powerValues), mPeakValues(peakValues),
+        mFreqValues(freqValues), mFreqLuma(freqLuma) {}
+    virtual ~cFrame() = default;
 
     // gets
     float* getSamples() const { return mSamples; }
@@ -33,31 +42,34 @@ public:
     float* getPeakValues() const { return mPeakValues;  }
     uint8_t* getFreqValues() const { return mFreqValues; }
     uint8_t* getFreqLuma() const { return mFreqLuma; }
+    bool isFreqReady() const { return mFreqReady; }
 
     bool isQuiet() const { return mPeakValues[0] + mPeakValues[1] < kQuietThreshold; }
 
     bool isMuted() const { return mMuted; }
     bool isSilence() const { return mSilence; }
     void setSilence (bool silence) { mSilence = silence; }
+    void reset (int64_t pts);
 
     bool hasTitle() const { return !mTitle.empty(); }
     std::string getTitle() const { return mTitle; }
 
     // vars
     float* mSamples;
-    int64_t mPts;
+    int64_t mPts = 0;
 
     float* mPowerValues;
     float* mPeakValues;
     uint8_t* mFreqValues;
     uint8_t* mFreqLuma;
+    std::atomic <bool> mFreqReady = false;
 
   private:
     static constexpr float kQuietThreshold = 0.01f;
 
     // vars
-    bool mMuted;
-    bool mSilence;
+    bool mMuted = false;
+    bool mSilence = false;
 
     std::string mTitle;
     };
@@ -123,6 +135,147 @@ public:
     int mItemNum = 0;
     };
   //}}}
+  //{{{
+  class cFrameStore {
+  // frameNum indexed cFrame store, deque of fixed size chunks of cFrame pointers
+  // - O(1) find, missing frames are null slots, empty chunks are released
+  public:
+    cFrameStore() = default;
+    ~cFrameStore() { clear(); }
+
+    // gets
+    bool empty() const { return mNumFrames == 0; }
+    int64_t size() const { return mNumFrames; }
+    int64_t getFirstFrameNum() const { return mFirstFrameNum; }
+    int64_t getLastFrameNum() const { return mLastFrameNum; }
+    cFrame* getFirstFrame() const { return find (mFirstFrameNum); }
+    cFrame* getLastFrame() const { return find (mLastFrameNum); }
+
+    //{{{
+    cFrame* find (int64_t frameNum) const {
+
+      int64_t chunkIndex = (frameNum >> kChunkBits) - mFirstChunkNum;
+      if ((chunkIndex < 0) || (chunkIndex >= (int64_t)mChunks.size()))
+        return nullptr;
+
+      cChunk* chunk = mChunks[(size_t)chunkIndex];
+      return chunk ? chunk->mFrames[frameNum & kChunkMask] : nullptr;
+      }
+    //}}}
+
+    // actions
+    bool insert (int64_t frameNum, cFrame* frame);
+    cFrame* removeFirst();
+    cFrame* removeLast();
+    void clear();
+
+  private:
+    static constexpr int kChunkBits = 10;
+    static constexpr int64_t kChunkSize = int64_t(1) << kChunkBits;
+    static constexpr int64_t kChunkMask = kChunkSize - 1;
+
+    //{{{
+    struct cChunk {
+      std::array <cFrame*, kChunkSize> mFrames = {};
+      int mNumFrames = 0;
+      };
+    //}}}
+
+    cFrame* remove (int64_t frameNum);
+    void updateFirstLast();
+
+    // chunk of frameNum is at mChunks[(frameNum >> kChunkBits) - mFirstChunkNum], null if empty
+    std::deque <cChunk*> mChunks;
+    int64_t mFirstChunkNum = 0;
+
+    int64_t mNumFrames = 0;
+    int64_t mFirstFrameNum = 0;
+    int64_t mLastFrameNum = 0;
+    };
+  //}}}
+  //{{{
+  class cFrameSlab {
+  // cFrame records allocated kSlabFrames at a time, frames are owned by the slab
+  // - record is cFrame,samples,powerValues,peakValues,freqValues,freqLuma in one cache line aligned block
+  // - freed frames go on a freeList for reuse, memory released with the slab
+  public:
+    cFrameSlab() = default;
+    ~cFrameSlab() { clear(); }
+
+    void init (int numChannels, int samplesPerFrame, int numFreqBytes);
+
+    // gets
+    int64_t getNumAllocated() const { return mNumAllocated; }
+    int64_t getNumFree() const { return (int64_t)mFreeFrames.size(); }
+    size_t getRecordBytes() const { return mRecordBytes; }
+    size_t getNumSamplesBytes() const { return mNumSamplesBytes; }
+
+    // actions
+    cFrame* allocFrame (int64_t pts);
+    void freeFrame (cFrame* frame);
+    void clear();
+
+  private:
+    static constexpr int kSlabFrames = 256;
+    static constexpr size_t kAlign = 64;
+    static size_t align (size_t bytes) { return (bytes + kAlign - 1) & ~(kAlign - 1); }
+
+    void addSlab();
+
+    int mNumChannels = 0;
+    size_t mNumSamplesBytes = 0;
+    size_t mNumFreqBytes = 0;
+    size_t mRecordBytes = 0;
+
+    int64_t mNumAllocated = 0;
+    std::vector <uint8_t*> mSlabs;
+    std::vector <cFrame*> mFreeFrames;
+    };
+  //}}}
+  //{{{
+  class cWaveSummary {
+  // mip pyramid of frame power,peak, level n bucket summarises 2^n frames
+  // - maintained as frames are inserted, removed or change silence
+  // - any frameNum range summarised from at most 2 buckets per level
+  public:
+    //{{{
+    class cBucket {
+    public:
+      void add (const cFrame* frame, int numChannels);
+      void add (const cBucket& bucket);
+
+      float getRms (int channel) const { return mNumFrames ? sqrtf (mSumSquares[channel] / mNumFrames) : 0.f; }
+
+      int mNumFrames = 0;
+      bool mSilence = false;
+      std::array <float,2> mMinPower = { 0.f };
+      std::array <float,2> mMaxPower = { 0.f };
+      std::array <float,2> mMaxPeak = { 0.f };
+      std::array <float,2> mSumSquares = { 0.f };
+      };
+    //}}}
+
+    cBucket get (const cFrameStore& frameStore, int64_t firstFrameNum, int64_t lastFrameNum, int numChannels) const;
+
+    void update (const cFrameStore& frameStore, int64_t frameNum, int numChannels);
+    void clear();
+
+  private:
+    static constexpr int kNumLevels = 24;
+
+    //{{{
+    struct cLevel {
+      std::deque <cBucket> mBuckets;
+      int64_t mFirstBucketNum = 0;
+      };
+    //}}}
+
+    const cBucket* findBucket (int level, int64_t bucketNum) const;
+
+    // level n at mLevels[n-1], level 0 is the frames themselves
+    std::array <cLevel, kNumLevels> mLevels;
+    };
+  //}}}
   cSong (eAudioFrameType frameType, int numChannels, int sampleRate, int samplesPerFrame, int maxMapSize);
   virtual ~cSong();
 
@@ -148,11 +301,11 @@ public:
 
   // get frameNum
   int64_t getPlayFrameNum() const { return getFrameNumFromPts (mPlayPts); }
-  int64_t getFirstFrameNum() const { return mFrameMap.empty() ? 0 : mFrameMap.begin()->first; }
-  int64_t getLastFrameNum() const { return mFrameMap.empty() ? 0 : mFrameMap.rbegin()->first;  }
+  int64_t getFirstFrameNum() const { return mFrameStore.getFirstFrameNum(); }
+  int64_t getLastFrameNum() const { return mFrameStore.getLastFrameNum(); }
   //{{{
   int64_t getNumFrames() const {
-    return mFrameMap.empty() ? 0 : (mFrameMap.rbegin()->first - mFrameMap.begin()->first+1);
+    return mFrameStore.empty() ? 0 : (mFrameStore.getLastFrameNum() - mFrameStore.getFirstFrameNum() + 1);
     }
   //}}}
   int64_t getTotalFrames() const { return mTotalFrames; }
@@ -162,6 +315,9 @@ public:
   virtual std::string getPlayTimeString (int daylightSeconds = 0) const;
   virtual std::string getLastTimeString (int daylightSeconds= 0) const;
 
+  static std::string getPowerPeakKernelName();
+  static bool checkPowerPeakKernel();
+
   //{{{
   void setPlayCallback (std::function <void(int64_t)>& playCallback) {
     mPlayCallback = playCallback;
@@ -180,10 +336,11 @@ public:
   uint32_t getNumFreqBytes() const { return kMaxFreqBytes; }
   //}}}
 
+  cFrame* findFrameByFrameNum (int64_t frameNum) const { return mFrameStore.find (frameNum); }
   //{{{
-  cFrame* findFrameByFrameNum (int64_t frameNum) const {
-    auto it = mFrameMap.find (frameNum);
-    return (it == mFrameMap.end()) ? nullptr : it->second;
+  cWaveSummary::cBucket getWaveSummary (int64_t firstFrameNum, int64_t lastFrameNum) const {
+  // summary of frames firstFrameNum up to, not including, lastFrameNum
+    return mWaveSummary.get (mFrameStore, firstFrameNum, lastFrameNum, mNumChannels);
     }
   //}}}
   virtual cFrame* findFrameByPts (int64_t pts) const { return findFrameByFrameNum (pts); }
@@ -202,11 +359,29 @@ public:
   void nextSilencePlayFrame();
   //}}}
 
-  void addFrame (bool reuseFront, int64_t pts, float* samples, int64_t totalFrames);
+  //{{{  silence
+  // - runs of more than kSilenceWindowFrames loaded quiet frames, ordered firstFrameNum,lastFrameNum intervals
+  bool isSilenceFrame (int64_t frameNum) const;
+  std::vector <std::pair <int64_t,int64_t>> getSilenceRuns (int64_t firstFrameNum, int64_t lastFrameNum) const;
+  //}}}
+  //{{{  spectrum
+  // - freqValues,freqLuma calculated in batches by a worker, nearest play,view frameNum first
+  bool getSpectrum() const { return mSpectrum; }
+  bool isFreqReady (int64_t frameNum) const;
+
+  void setSpectrum (bool spectrum);
+  void setViewFrameNum (int64_t frameNum) { mViewFrameNum = frameNum; }
+  //}}}
+
+  // copyFrame copies caller's samples into a frame record
+  // decodeFrame has decoder write samples straight into a frame record, false if nothing decoded
+  void copyFrame (bool reuseFront, int64_t pts, const float* samples, int64_t totalFrames);
+  bool decodeFrame (iAudioDecoder* decoder, bool reuseFront, const uint8_t* frameData, int frameSize,
+                    int64_t pts, int64_t totalFrames);
 
 protected:
   //{{{  vars
-  std::shared_mutex mSharedMutex;
+  mutable std::shared_mutex mSharedMutex;
 
   const int mSampleRate = 0;
   const int mSamplesPerFrame = 0;
@@ -215,7 +390,9 @@ protected:
   int64_t mPlayPts = 0;
   cSelect mSelect;
 
-  std::map <int64_t, cFrame*> mFrameMap;
+  cFrameSlab mFrameSlab;
+  cFrameStore mFrameStore;
+  cWaveSummary mWaveSummary;
   //}}}
 
 private:
@@ -225,23 +402,44 @@ private:
   inline static const uint32_t kMaxFreq = (kMaxNumSamplesPerFrame / 2) + 1; // fft max
   inline static const uint32_t kMaxFreqBytes = 512;                         // arbitrary graphics max
   //}}}
+  static const std::pair<const int64_t,int64_t>* findRun (const std::map <int64_t,int64_t>& runs, int64_t frameNum);
+  static void splitRun (std::map <int64_t,int64_t>& runs, int64_t frameNum);
+
   int64_t skipPrev (int64_t fromPts, bool silence);
   int64_t skipNext (int64_t fromPts, bool silence);
-  void checkSilenceWindow (int64_t pts);
+
+  cFrame* getFreeFrame (bool reuseFront, int64_t pts);
+  void addFrame (cFrame* frame, int64_t totalFrames);
+  void addQuietFrame (int64_t frameNum);
+  void removeSilenceFrame (int64_t frameNum);
+
+  void spectrumThread();
+  void takeSpectrumBatch (std::vector <int64_t>& batch);
+  void calcSpectrum (cFrame* frame, kiss_fftr_cfg fftrConfig, kiss_fft_scalar* timeBuf, kiss_fft_cpx* freqBuf);
   //{{{  vars
   const eAudioFrameType mFrameType;
   const int mNumChannels;
 
-  // map of frames keyed by frame pts/ptsDuration
+  // frameStore of frames indexed by frame pts/ptsDuration
   // - frameNum offset by firstFrame pts/ptsDuration
   int mMaxMapSize = 0;
   int64_t mTotalFrames = 0;
+  int64_t mNumMismatchedFrames = 0;
   bool mPlaying = false;
 
-  // fft vars
-  kiss_fftr_cfg mFftrConfig;
-  kiss_fft_scalar mTimeBuf[kMaxNumSamplesPerFrame];
-  kiss_fft_cpx mFreqBuf[kMaxFreq];
+  // frameNum runs of loaded quiet frames, silenceRuns those over kSilenceWindowFrames
+  std::map <int64_t,int64_t> mQuietRuns;
+  std::map <int64_t,int64_t> mSilenceRuns;
+
+  // spectrum worker, frameNums waiting for freqValues
+  bool mSpectrum = true;
+  bool mSpectrumExit = false;
+  std::thread mSpectrumThread;
+  std::mutex mSpectrumMutex;
+  std::condition_variable mSpectrumCondition;
+  std::set <int64_t> mSpectrumPending;
+  std::atomic <int64_t> mSpectrumPtsDuration = 1;
+  std::atomic <int64_t> mViewFrameNum = -1;
 
   // max stuff for ui
   float mMaxPowerValue = 0.f;
@@ -265,8 +463,8 @@ public:
   virtual int64_t getFrameNumFromPts (int64_t pts) const final { return pts / mFramePtsDuration; }
   virtual int64_t getPtsFromFrameNum (int64_t frameNum) const final { return frameNum * mFramePtsDuration; }
 
-  virtual int64_t getFirstPts() const final { return mFrameMap.empty() ? 0 : mFrameMap.begin()->second->getPts(); }
-  virtual int64_t getLastPts() const final { return mFrameMap.empty() ? 0 : mFrameMap.rbegin()->second->getPts();  }
+  virtual int64_t getFirstPts() const final { return mFrameStore.empty() ? 0 : mFrameStore.getFirstFrame()->getPts(); }
+  virtual int64_t getLastPts() const final { return mFrameStore.empty() ? 0 : mFrameStore.getLastFrame()->getPts();  }
 
   virtual bool getPlayFinished()const final;
   virtual std::string getFirstTimeString (int daylightSeconds) const final;
@@ -300,7 +498,9 @@ public:
 
   // gets
   int64_t getBasePlayPts() const { return mPlayPts - mBasePts; }
-  int getLoadChunkNum (int64_t& loadPts, bool& reuseFromFront) const;
+  int64_t getChunkPts (int chunkNum) const;
+  std::vector<int> getLoadChunkNums (int ahead, int behind) const;
+  int64_t getBufferedPts (int ahead) const;
   int64_t getLengthPts() const { return getLastPts(); }
 
   // sets
@@ -309,6 +509,8 @@ public:
                    int chunkNum);
 
 private:
+  int getPlayChunkNum (int64_t& frameNumOffset) const;
+
   // vars
   const int mFramesPerChunk = 0;
   int mBaseChunkNum = 0;
@@ -5,9 +5,15 @@
 #define WIN32_LEAN_AND_MEAN
 
 // c++
+#include <array>
+#include <atomic>
 #include <map>
+#include <deque>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
+#include <vector>
 
 // c
 #include "sys/stat.h"
@@ -19,12 +25,17 @@
 #include "../common/cLog.h"
 #include "../common/cDvbUtils.h"
 #include "../common/readerWriterQueue.h"
+#include "../common/cMappedFile.h"
 
 // song
 #include "cSong.h"
 #include "cSongLoader.h"
 #include "cSongPlayer.h"
 #include "iVideoPool.h"
+#include "cTsIndex.h"
+#include "cHlsFetcher.h"
+#include "cHlsRateSelector.h"
+#include "cPidParser.h"
 
 // decoder
 #include "../decoders/cAudioParser.h"
@@ -33,6 +44,7 @@
 
 // net
 #include "../net/cHttp.h"
+#include "../net/cDnsCache.h"
 
 // dvb
 #include "cDvbSource.h"
@@ -105,58 +117,7 @@ private:
   };
 //}}}
 
-// cPidParser
-//{{{
-class cPidParser {
-public:
-  cPidParser (int pid, const string& name) : mPid(pid), mPidName(name) {}
-  virtual ~cPidParser() = default;
-
-  virtual int getQueueSize() { return 0; }
-  virtual float getQueueFrac() { return 0.f; }
-
-  //{{{
-  void parse (uint8_t* ts, bool reuseFromFront) {
-  // ignore any leading payload before a payloadStart
-
-    bool payloadStart = ts[1] & 0x40;
-    bool hasPayload = ts[3] & 0x10;
-
-    if (hasPayload && (payloadStart || mGotPayloadStart)) {
-      mGotPayloadStart = true;
-      int continuityCount = ts[3] & 0x0F;
-      int headerSize = 1 + ((ts[3] & 0x20) ? 4 + ts[4] : 3);
-      payload (ts + headerSize, 188 - headerSize, payloadStart, continuityCount, reuseFromFront);
-      }
-    }
-  //}}}
-
-  virtual void exit() {}
-  virtual void processLast (bool reuseFromFront) { (void)reuseFromFront; }
-
-protected:
-  //{{{
-  virtual void payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront) {
-
-    (void)continuityCount;
-    (void)reuseFromFront;
-
-    string info;
-    for (int i = 0; i < tsLeft; i++) {
-      int value = ts[i];
-      info += fmt::format ("{:2x} ", value);
-      }
-
-    cLog::log (LOGINFO, fmt::format ("{} {} {}", mPidName, payloadStart ? "start ": "", info));
-    }
-  //}}}
-
-  // vars
-  const int mPid;
-  const string mPidName;
-  bool mGotPayloadStart = false;
-  };
-//}}}
+// cPidParser derived section parsers
 //{{{
 class cPatParser : public cPidParser {
 // assumes section length fits in this packet, no need to buffer
@@ -679,168 +640,13 @@ private:
   };
 //}}}
 
-//{{{
-class cPesParser : public cPidParser {
-//{{{
-class cPesItem {
-public:
-  //{{{
-  cPesItem (bool reuseFromFront, uint8_t* pes, int size, int64_t pts, int64_t dts)
-      : mReuseFromFront(reuseFromFront), mPesSize(size), mPts(pts), mDts(dts) {
-    mPes = (uint8_t*)malloc (size);
-    memcpy (mPes, pes, size);
-    }
-  //}}}
-  //{{{
-  ~cPesItem() {
-    free (mPes);
-    }
-  //}}}
-
-  bool mReuseFromFront;
-  uint8_t* mPes;
-  const int mPesSize;
-  const int64_t mPts;
-  const int64_t mDts;
-  };
-//}}}
-public:
-  //{{{
-  cPesParser (int pid, const string& name, bool useQueue) : cPidParser(pid, name), mUseQueue(useQueue) {
-
-    mPes = (uint8_t*)malloc (kInitPesSize);
-    if (useQueue)
-      thread ([=,this](){ dequeThread(); }).detach(); // ,this
-    }
-  //}}}
-  //{{{
-  virtual ~cPesParser() {
-    free (mPes);
-    }
-  //}}}
-
-  virtual int getQueueSize() { return (int)mQueue.size_approx(); }
-  virtual float getQueueFrac() { return (float)mQueue.size_approx() / mQueue.max_capacity(); }
-
-  //{{{
-  virtual void processLast (bool reuseFromFront) {
-
-    if (mPesSize) {
-      dispatchDecode (reuseFromFront, mPes, mPesSize, mPts, mDts);
-      mPesSize = 0;
-      }
-    }
-  //}}}
-  //{{{
-  virtual void exit() {
-
-    if (mUseQueue) {
-      mQueueExit = true;
-      //while (mQueueRunning)
-      this_thread::sleep_for (100ms);
-      }
-    }
-  //}}}
-
-protected:
-  //{{{
-  virtual void payload (uint8_t* ts, int tsLeft, bool payloadStart, int continuityCount, bool reuseFromFront) {
-  // ts[0],ts[1],ts[2],ts[3] = stream id 0x000001xx
-  // ts[4],ts[5] = packetLength, 0 for video
-  // ts[6] = 0x80 marker, 0x04 = dataAlignmentIndicator
-  // ts[7] = 0x80 = pts, 0x40 = dts
-  // ts[8] = optional header length
-
-    if ((mContinuityCount >= 0) &&
-        (continuityCount != ((mContinuityCount + 1) & 0xF))) // !!! should abandon pes here !!!!
-      cLog::log (LOGERROR, "continuity count error pid:%d %d %d", mPid, continuityCount, mContinuityCount);
-
-    mContinuityCount = continuityCount;
-
-    if (payloadStart) {
-      bool dataAlignmentIndicator = (ts[6] & 0x84) == 0x84;
-      if (dataAlignmentIndicator) {
-        processLast (reuseFromFront);
-
-        // get pts dts for next pes
-        if (ts[7] & 0x80)
-          mPts = cDvbUtils::getPts (ts+9);
-        if (ts[7] & 0x40)
-          mDts = cDvbUtils::getPts (ts+14);
-        }
-
-      int headerSize = 9 + ts[8];
-      ts += headerSize;
-      tsLeft -= headerSize;
-      }
-
-    if (mPesSize + tsLeft > mAllocSize) {
-      mAllocSize *= 2;
-      mPes = (uint8_t*)realloc (mPes, mAllocSize);
-      cLog::log (LOGINFO1, fmt::format ("{} pes allocSize doubled to{}", mPidName, mAllocSize));
-      }
-
-    memcpy (mPes + mPesSize, ts, tsLeft);
-    mPesSize += tsLeft;
-    }
-  //}}}
-
-  virtual void decode (bool reuseFromFront, uint8_t* pes, int size, int64_t pts, int64_t dts) = 0;
-  //{{{
-  void dispatchDecode (bool reuseFromFront, uint8_t* pes, int size, int64_t pts, int64_t dts) {
-
-    if (mUseQueue)
-      mQueue.enqueue (new cPesParser::cPesItem (reuseFromFront, pes, size, pts, dts));
-    else
-      decode (reuseFromFront, pes, size, pts, dts);
-    }
-  //}}}
-  //{{{
-  void dequeThread() {
-
-    cLog::setThreadName (mPidName + "Q");
-
-    mQueueRunning = true;
-
-    while (!mQueueExit) {
-      cPesItem* pesItem;
-      if (mQueue.wait_dequeue_timed (pesItem, 40000)) {
-        decode (pesItem->mReuseFromFront, pesItem->mPes, pesItem->mPesSize, pesItem->mPts, pesItem->mDts);
-        delete pesItem;
-        }
-      }
-
-    // !!! not sure this is empty the queue on exit !!!!
-
-    mQueueRunning = false;
-    }
-  //}}}
-
-  int mAllocSize = kInitPesSize;
-
-  uint8_t* mPes;
-  int mPesSize = 0;
-  int64_t mPts = 0;
-  int64_t mDts = 0;
-  int mContinuityCount = -1;
-
-private:
-  static constexpr int kInitPesSize = 4096;
-
-  bool mUseQueue = true;
-  bool mQueueExit = false;
-  bool mQueueRunning = false;
-
-  readerWriterQueue::cBlockingReaderWriterQueue <cPesItem*> mQueue;
-  };
-//}}}
 //{{{
 class cAudioPesParser : public cPesParser {
 public:
   //{{{
-  cAudioPesParser (int pid, iAudioDecoder* audioDecoder, bool useQueue,
-                   function <void (bool reuseFromFront, float* samples, int64_t pts)> callback)
-      : cPesParser(pid, "aud", useQueue), mAudioDecoder(audioDecoder), mCallback(callback) {
+  cAudioPesParser (int pid, iAudioDecoder* audioDecoder, cSong* song, bool useQueue,
+                   function <void (int64_t pts)> callback)
+      : cPesParser(pid, "aud", useQueue), mAudioDecoder(audioDecoder), mSong(song), mCallback(callback) {
     }
   //}}}
   virtual ~cAudioPesParser() = default;
@@ -852,10 +658,9 @@ protected:
     uint8_t* framePes = pes;
     int frameSize;
     while (cAudioParser::parseFrame (framePes, pes + size, frameSize)) {
-      // decode a single frame from pes
-      float* samples = mAudioDecoder->decodeFrame (framePes, frameSize, pts);
-      if (samples) {
-        mCallback (reuseFromFront, samples, pts);
+      // decode a single frame from pes straight into song
+      if (mSong->decodeFrame (mAudioDecoder, reuseFromFront, framePes, frameSize, pts, mSong->getNumFrames()+1)) {
+        mCallback (pts);
         // pts of next frame in pes, assumes 90kz pts, 48khz sample rate
         pts += (mAudioDecoder->getNumSamplesPerFrame() * 90) / 48;
         }
@@ -869,7 +674,8 @@ protected:
 
 private:
   iAudioDecoder* mAudioDecoder;
-  function <void (bool reuseFromFront, float* samples, int64_t pts)> mCallback;
+  cSong* mSong;
+  function <void (int64_t pts)> mCallback;
   };
 //}}}
 //{{{
@@ -1038,21 +844,20 @@ public:
 
     int audioQueueSize = 0;
     int videoQueueSize = 0;
+    string poolString;
 
     if (mCurSid > 0) {
       cDvbService* service = mServices[mCurSid];
       if (service) {
-        auto audioIt = mPidParsers.find (service->getAudioPid());
-        if (audioIt != mPidParsers.end())
-          audioQueueSize = (*audioIt).second->getQueueSize();
-
-        auto videoIt = mPidParsers.find (service->getVideoPid());
-        if (videoIt != mPidParsers.end())
-          videoQueueSize = (*videoIt).second->getQueueSize();
+        audioQueueSize = mPidParsers.getQueueSize (service->getAudioPid());
+        videoQueueSize = mPidParsers.getQueueSize (service->getVideoPid());
+        poolString = mPidParsers.getPoolString (service->getVideoPid());
+        if (mVideoPool)
+          poolString += " " + mVideoPool->getPoolString();
         }
       }
 
-    return fmt::format ("sid:{} aq:{} vq:{}", mCurSid, audioQueueSize, videoQueueSize);
+    return fmt::format ("sid:{} aq:{} vq:{} {}", mCurSid, audioQueueSize, videoQueueSize, poolString);
     }
   //}}}
   //{{{
@@ -1067,13 +872,8 @@ public:
       int audioPid = service->getAudioPid();
       int videoPid = service->getVideoPid();
 
-      auto audioIt = mPidParsers.find (audioPid);
-      if (audioIt != mPidParsers.end())
-        audioFrac = (*audioIt).second->getQueueFrac();
-
-      auto videoIt = mPidParsers.find (videoPid);
-      if (videoIt != mPidParsers.end())
-        videoFrac = (*videoIt).second->getQueueFrac();
+      audioFrac = mPidParsers.getQueueFrac (audioPid);
+      videoFrac = mPidParsers.getQueueFrac (videoPid);
       }
 
     return mLoadFrac;
@@ -1103,7 +903,15 @@ public:
     auto dvb = new cDvbSource (mFrequency, 0);
 
     mPtsSong = new cPtsSong (eAudioFrameType::eAacAdts, mNumChannels, mSampleRate, 1024, 1920, 0);
-    mPtsSong->setPlayCallback (playCallback);
+    // play position also drives video pool frame recycling
+    function <void(int64_t)> songPlayCallback = [&](int64_t pts) noexcept {
+      iVideoPool* videoPool = mVideoPool;
+      if (videoPool)
+        videoPool->setPlayPts (pts);
+      if (playCallback)
+        playCallback (pts);
+      };
+    mPtsSong->setPlayCallback (songPlayCallback);
     iAudioDecoder* audioDecoder = nullptr;
 
     bool waitForPts = false;
@@ -1121,9 +929,7 @@ public:
       };
     //}}}
     //{{{
-    auto audioFrameCallback = [&](bool reuseFromFront, float* samples, int64_t pts) noexcept {
-      mPtsSong->addFrame (reuseFromFront, pts, samples, mPtsSong->getNumFrames()+1);
-
+    auto audioFrameCallback = [&](int64_t pts) noexcept {
       if (loadPts < 0)
         // firstTime, setBasePts, sets playPts
         mPtsSong->setBasePts (pts);
@@ -1143,7 +949,7 @@ public:
     //}}}
     //{{{
     auto streamCallback = [&](int sid, int pid, int type) noexcept {
-      if (mPidParsers.find (pid) == mPidParsers.end()) {
+      if (!mPidParsers.has (pid)) {
         // new stream pid
         auto it = mServices.find (sid);
         if (it != mServices.end()) {
@@ -1155,9 +961,11 @@ public:
 
               if (service->isSelected()) {
                 audioDecoder = createAudioDecoder (eAudioFrameType::eAacAdts);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid,
-                  new cAudioPesParser (pid, audioDecoder, true, audioFrameCallback)));
+                mPidParsers.add (pid,
+                  new cAudioPesParser (pid, audioDecoder, mPtsSong, true, audioFrameCallback));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
@@ -1167,9 +975,11 @@ public:
 
               if (service->isSelected()) {
                 audioDecoder = createAudioDecoder (eAudioFrameType::eAacLatm);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid,
-                  new cAudioPesParser (pid, audioDecoder, true, audioFrameCallback)));
+                mPidParsers.add (pid,
+                  new cAudioPesParser (pid, audioDecoder, mPtsSong, true, audioFrameCallback));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
@@ -1179,36 +989,44 @@ public:
 
               if (service->isSelected()) {
                 mVideoPool = iVideoPool::create (true, 100, mPtsSong);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cVideoPesParser (pid, mVideoPool, true)));
+                mPidParsers.add (pid, new cVideoPesParser (pid, mVideoPool, true));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
             //{{{
             case 6:  // do nothing - subtitle
               //cLog::log (LOGINFO, "subtitle %d %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 2:  // do nothing - ISO 13818-2 video
               //cLog::log (LOGERROR, "mpeg2 video %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 3:  // do nothing - ISO 11172-3 audio
               //cLog::log (LOGINFO, "mp2 audio %d %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 5:  // do nothing - private mpeg2 tabled data
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 11: // do nothing - dsm cc u_n
+              mPidParsers.ignore (pid);
               break;
             //}}}
             default:
               cLog::log (LOGERROR, "loadTs - unrecognised stream type %d %d", pid, type);
+              mPidParsers.ignore (pid);
             }
           }
         else
@@ -1218,9 +1036,9 @@ public:
     //}}}
     //{{{
     auto programCallback = [&](int pid, int sid) noexcept {
-      if ((sid > 0) && (mPidParsers.find (pid) == mPidParsers.end())) {
+      if ((sid > 0) && (!mPidParsers.has (pid))) {
         cLog::log (LOGINFO, "PAT adding pid:service %d::%d", pid, sid);
-        mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cPmtParser (pid, sid, streamCallback)));
+        mPidParsers.add (pid, new cPmtParser (pid, sid, streamCallback));
 
         // select first service in PAT
         mServices.insert (map<int,cDvbService*>::value_type (sid, new cDvbService (sid, mCurSid == -1)));
@@ -1234,9 +1052,9 @@ public:
       mTimeString = timeString;
       };
     //}}}
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x00, new cPatParser (programCallback)));
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x11, new cSdtParser (sdtCallback)));
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x14, new cTdtParser (tdtCallback)));
+    mPidParsers.add (0x00, new cPatParser (programCallback));
+    mPidParsers.add (0x11, new cSdtParser (sdtCallback));
+    mPidParsers.add (0x14, new cTdtParser (tdtCallback));
 
     uint8_t* buffer = (uint8_t*)malloc (1024 * 188);
     do {
@@ -1246,9 +1064,7 @@ public:
       // process tsBlock
       uint8_t* ts = buffer;
       while (!mExit && (bytesLeft >= 188) && (ts[0] == 0x47)) {
-        auto it = mPidParsers.find (((ts[1] & 0x1F) << 8) | ts[2]);
-        if (it != mPidParsers.end())
-          it->second->parse (ts, true);
+        mPidParsers.parse (ts, true);
         ts += 188;
         bytesLeft -= 188;
         }
@@ -1261,12 +1077,6 @@ public:
       mSongPlayer->wait();
     delete mSongPlayer;
 
-    for (auto parser : mPidParsers) {
-      //{{{  stop and delete pidParsers
-      parser.second->exit();
-      delete parser.second;
-      }
-      //}}}
     mPidParsers.clear();
 
     auto tempSong =  mPtsSong;
@@ -1290,7 +1100,7 @@ private:
 
   int mFrequency = 0;
   string mMultiplexName;
-  map <int, cPidParser*> mPidParsers;
+  cPidDispatch mPidParsers;
 
   cPtsSong* mPtsSong = nullptr;
   iVideoPool* mVideoPool = nullptr;
@@ -1364,14 +1174,25 @@ public:
 
             int frameSize;
             while (cAudioParser::parseFrame (buffer, bufferEnd, frameSize)) {
-              auto samples = audioDecoder->decodeFrame (buffer, frameSize, pts);
-              if (samples) {
-                if (!mSong) {
+              bool decoded;
+              if (mSong)
+                decoded = mSong->decodeFrame (audioDecoder, true, buffer, frameSize, pts, mSong->getNumFrames()+1);
+              else {
+                // first decoded frame gives song format, copied in, rest decode straight into song
+                vector <float> samples;
+                decoded = audioDecoder->decodeFrame (buffer, frameSize, pts, [&](int frameChannels, int frameSamples) noexcept {
+                  samples.resize (frameChannels * frameSamples);
+                  return samples.data();
+                  });
+                if (decoded) {
                   mSong = new cSong (frameType, audioDecoder->getNumChannels(), audioDecoder->getSampleRate(),
                                      audioDecoder->getNumSamplesPerFrame(), 0);
                   mSong->setPlayCallback (playCallback);
+                  mSong->copyFrame (true, pts, samples.data(), 1);
                   }
-                mSong->addFrame (true, pts, samples,  mSong->getNumFrames()+1);
+                }
+
+              if (decoded) {
                 pts += mSong->getFramePtsDuration();
 
                 if (!mSongPlayer)
@@ -1486,33 +1307,18 @@ public:
   //{{{
   virtual string getInfoString() override {
 
-    int audioQueueSize = 0;
-    auto audioIt = mPidParsers.find (mAudioPid);
-    if (audioIt != mPidParsers.end())
-       audioQueueSize = (*audioIt).second->getQueueSize();
-
-    int videoQueueSize = 0;
-    auto videoIt = mPidParsers.find (mVideoPid);
-    if (videoIt != mPidParsers.end())
-      videoQueueSize = (*videoIt).second->getQueueSize();
+    int audioQueueSize = mPidParsers.getQueueSize (mAudioPid);
+    int videoQueueSize = mPidParsers.getQueueSize (mVideoPid);
 
-    return fmt::format ("aq:{} vq:{}", audioQueueSize, videoQueueSize);
+    return fmt::format ("aq:{} vq:{} {}", audioQueueSize, videoQueueSize, mPidParsers.getPoolString (mVideoPid));
     }
   //}}}
   //{{{
   virtual float getFracs (float& audioFrac, float& videoFrac) final {
   // return fracs for spinner graphic, true if ok to display
 
-    audioFrac = 0.f;
-    videoFrac = 0.f;
-
-    auto audioIt = mPidParsers.find (mAudioPid);
-    if (audioIt != mPidParsers.end())
-      audioFrac = (*audioIt).second->getQueueFrac();
-
-    auto videoIt = mPidParsers.find (mVideoPid);
-    if (videoIt != mPidParsers.end())
-      videoFrac = (*videoIt).second->getQueueFrac();
+    audioFrac = mPidParsers.getQueueFrac (mAudioPid);
+    videoFrac = mPidParsers.getQueueFrac (mVideoPid);
 
     return mLoadFrac;
     }
@@ -1525,7 +1331,7 @@ protected:
   int mLoadSize = 0;
   int mAudioPid = -1;
   int mVideoPid = -1;
-  map <int, cPidParser*> mPidParsers;
+  cPidDispatch mPidParsers;
   };
 //}}}
 //{{{
@@ -1545,19 +1351,23 @@ public:
   //{{{
   virtual string getInfoString() final {
 
-    int audioQueueSize = 0;
-    auto audioIt = mPidParsers.find (mAudioPid);
-    if (audioIt != mPidParsers.end())
-       audioQueueSize = (*audioIt).second->getQueueSize();
+    int audioQueueSize = mPidParsers.getQueueSize (mAudioPid);
 
     int videoQueueSize = 0;
+    string poolString;
     if (!mRadio && mVideoRate) {
-      auto videoIt = mPidParsers.find (mVideoPid);
-      if (videoIt != mPidParsers.end())
-        videoQueueSize = (*videoIt).second->getQueueSize();
+      videoQueueSize = mPidParsers.getQueueSize (mVideoPid);
+      poolString = mPidParsers.getPoolString (mVideoPid);
+      if (mVideoPool)
+        poolString += " " + mVideoPool->getPoolString();
       }
 
-    return fmt::format ("{} {}k aq:{} vq:{}", mChannel, mLoadSize/1000, audioQueueSize, videoQueueSize);
+    // fetcher,rateSelector live on load's stack, held while load clears them
+    unique_lock<mutex> lock (mInfoMutex);
+    return fmt::format ("{} {}k aq:{} vq:{} {} {} {} {}", mChannel, mLoadSize/1000, audioQueueSize, videoQueueSize,
+                        mFetcher ? mFetcher->getInfoString() : "",
+                        mRateSelector ? mRateSelector->getInfoString() : "", poolString,
+                        cDnsCache::getInfoString());
     }
   //}}}
 
@@ -1565,7 +1375,11 @@ public:
   virtual bool recognise (const vector<string>& params) final {
   //  parse params to recognise load
 
-    for (auto& param : params) {
+    // akamai unless host param, loopback test server
+    string host = "as-hls-uk-live.akamaized.net";
+
+    for (auto it = params.begin(); it < params.end(); ++it) {
+      const string& param = *it;
       if (param == "bbc1") mChannel = "bbc_one_hd";
       else if (param == "bbc2") mChannel = "bbc_two_hd";
       else if (param == "bbc4") mChannel = "bbc_four_hd";
@@ -1583,6 +1397,20 @@ public:
       else if (param == "r6") { mRadio = true; mChannel = "bbc_6music"; }
 
       else if (param == "mfx") mFfmpeg = false;
+      else if (param == "sws") mYuvSimd = false;
+      else if (param == "yuv2") mYuvBands = 2;
+      else if (param == "yuv4") mYuvBands = 4;
+      else if (param == "single") mDecodeThreads = eDecodeThreads::eSingle;
+      else if (param == "frame") mDecodeThreads = eDecodeThreads::eFrame;
+      else if (param == "slice") mDecodeThreads = eDecodeThreads::eSlice;
+      else if (param == "dec2") mNumDecodeThreads = 2;
+      else if (param == "dec4") mNumDecodeThreads = 4;
+      else if (param == "dec8") mNumDecodeThreads = 8;
+
+      else if (param == "serial") { mFetchConnections = 1; mFetchAhead = 1; mFetchBehind = 0; }
+      else if (param == "fetch4") mFetchConnections = 4;
+      else if (param == "fixed") mAdaptiveRate = false;
+      else if ((param == "host") && (it+1 < params.end())) host = *++it;
 
       else if (param == "v0") mVideoRate = 0;
       else if (param == "v1") mVideoRate = 827008;
@@ -1603,8 +1431,11 @@ public:
     mSamplesPerFrame = mLowAudioRate ? 2048 : 1024;
     mPtsDurationPerFrame = mLowAudioRate ? 3840 : 1920;
     mFramesPerChunk = mLowAudioRate ? (mRadio ? 150 : 180) : (mRadio ? 300 : 360);
+    if (!mRadio)
+      // video song maxMapSize only holds ~3 chunks, don't load behind to avoid thrashing
+      mFetchBehind = 0;
 
-    mHost = "as-hls-uk-live.akamaized.net";
+    mHost = host;
     string pathFormat = mRadio ? "pool_904/live/uk/{0}/{0}.isml/{0}-audio={1}"
                                : fmt::format ("pool_902/live/uk/{{0}}/{{0}}.isml/{{0}}-pa{0}={{1}}{1}",
                                               mLowAudioRate ? 3 : 4, mVideoRate ? "-video={2}" : "");
@@ -1622,14 +1453,22 @@ public:
     mHlsSong = new cHlsSong (eAudioFrameType::eAacAdts, mNumChannels, mSampleRate,
                              mSamplesPerFrame, mPtsDurationPerFrame,
                              mRadio ? 0 : 1000, mFramesPerChunk);
-    mHlsSong->setPlayCallback (playCallback);
+    // play position also drives video pool frame recycling
+    function <void(int64_t)> songPlayCallback = [&](int64_t pts) noexcept {
+      iVideoPool* videoPool = mVideoPool;
+      if (videoPool)
+        videoPool->setPlayPts (pts);
+      if (playCallback)
+        playCallback (pts);
+      };
+    mHlsSong->setPlayCallback (songPlayCallback);
 
     iAudioDecoder* audioDecoder = nullptr;
 
     // add parsers, callbacks
     //{{{
-    auto audioFrameCallback = [&](bool reuseFromFront, float* samples, int64_t pts) noexcept {
-      mHlsSong->addFrame (reuseFromFront, pts, samples, mHlsSong->getNumFrames()+1);
+    auto audioFrameCallback = [&](int64_t pts) noexcept {
+      (void)pts;
       if (!mSongPlayer)
         mSongPlayer = new cSongPlayer (mHlsSong, true);
       };
@@ -1637,42 +1476,73 @@ public:
     //{{{
     auto streamCallback = [&](int sid, int pid, int type) noexcept {
       (void)sid;
-      if (mPidParsers.find (pid) == mPidParsers.end()) {
+      if (!mPidParsers.has (pid)) {
         // new stream, add stream parser
         switch (type) {
           case 15: // aacAdts
             mAudioPid  = pid;
             audioDecoder = createAudioDecoder (mAudioFrameType);
-            mPidParsers.insert (
-              map<int,cPidParser*>::value_type (pid,
-                new cAudioPesParser (pid, audioDecoder, true, audioFrameCallback)));
+            mPidParsers.add (pid, new cAudioPesParser (pid, audioDecoder, mHlsSong, true, audioFrameCallback));
             break;
 
           case 27: // h264video
             if (mVideoRate) {
               mVideoPid  = pid;
               mVideoPool = iVideoPool::create (mFfmpeg, 192, mHlsSong);
-              mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cVideoPesParser (pid, mVideoPool, true)));
+              mVideoPool->setYuvConvert (mYuvSimd, mYuvBands);
+              mVideoPool->setDecodeThreads (mDecodeThreads, mNumDecodeThreads);
+              mPidParsers.add (pid, new cVideoPesParser (pid, mVideoPool, true));
               }
+            else
+              mPidParsers.ignore (pid);
             break;
 
           default:
             cLog::log (LOGERROR, "hls - unrecognised stream pid:type %d:%d", pid, type);
+            mPidParsers.ignore (pid);
           }
         }
       };
     //}}}
     //{{{
     auto programCallback = [&](int pid, int sid) noexcept {
-      if (mPidParsers.find (pid) == mPidParsers.end()) {
+      if (!mPidParsers.has (pid)) {
         // new PMT, add parser and new service
-        mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cPmtParser (pid, sid, streamCallback)));
+        mPidParsers.add (pid, new cPmtParser (pid, sid, streamCallback));
         }
       };
     //}}}
 
     // add PAT parser
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x00, new cPatParser (programCallback)));
+    mPidParsers.add (0x00, new cPatParser (programCallback));
+
+    //{{{  adaptive rate, video variants share audio, audio variants only within same frame size
+    // - mixing 1024 and 2048 sample audio frames would renumber chunk frames, never switch between them
+    bool videoRates = !mRadio && mVideoRate;
+    vector<int> rates;
+    if (videoRates)
+      rates = { 827008, 1604032, 2812032, 5070016 };
+    else if (mLowAudioRate)
+      rates = { 48000, 96000 };
+    else
+      rates = { 128000, 320000 };
+
+    cHlsRateSelector rateSelector (rates, videoRates ? mVideoRate : mAudioRate, videoRates ? mAudioRate : 0,
+                                   mAdaptiveRate);
+    //}}}
+
+    // fetch chunks in parallel, ahead and behind playPts, at rate selected when fetch starts
+    cHlsFetcher fetcher (mFetchConnections, [&](int chunkNum) noexcept {
+      int rate = rateSelector.getRate();
+      int audioRate = videoRates ? mAudioRate : rate;
+      int videoRate = videoRates ? rate : mVideoRate;
+      return fmt::vformat (mTsPathFormat, fmt::make_format_args(mChannel, audioRate, videoRate, chunkNum)); });
+
+    {
+    unique_lock<mutex> lock (mInfoMutex);
+    mFetcher = &fetcher;
+    mRateSelector = &rateSelector;
+    }
 
     while (!mExit) {
       cHttp http;
@@ -1698,69 +1568,66 @@ public:
         mHlsSong->setBaseHls (mpegTimestamp, extXProgramDateTimePoint, -37s, extXMediaSequence);
         http.freeContent();
         //}}}
+        fetcher.setHost (mHost);
 
         while (!mExit) {
-          int64_t loadPts;
-          bool reuseFromFront;
-          int chunkNum = mHlsSong->getLoadChunkNum (loadPts, reuseFromFront);
-          if (chunkNum > 0) {
-            // get chunkNum ts file
-            int contentParsed = 0;
-
-            string tsPath = fmt::vformat (mTsPathFormat, fmt::make_format_args(mChannel, mAudioRate, mVideoRate, chunkNum));
-            if (http.get (mHost, tsPath, "",
-                          [&](const string& key, const string& value) noexcept {
-                            //{{{  header callback lambda
-                            (void)value;
-                            if (key == "content-length")
-                              cLog::log (LOGINFO1, fmt::format ("chunk:{} pts:{} size:{}k",
-                                         chunkNum,
-                                         utils::getPtsFramesString (loadPts, mHlsSong->getFramePtsDuration()),
-                                         http.getHeaderContentSize()/1000));
-                            },
-                            //}}}
-                          [&](const uint8_t* data, int length) noexcept {
-                            //{{{  data callback lambda
-                            (void)data;
-                            (void)length;
-                            mLoadSize = http.getContentSize();
-                            mLoadFrac = float(http.getContentSize()) / http.getHeaderContentSize();
-
-                            // parse ts packets as we receive them
-                            while (http.getContentSize() - contentParsed >= 188) {
-                              uint8_t* ts = http.getContent() + contentParsed;
-                              if (ts[0] == 0x47) {
-                                auto it = mPidParsers.find (((ts[1] & 0x1F) << 8) | ts[2]);
-                                if (it != mPidParsers.end())
-                                  it->second->parse (ts, reuseFromFront);
-                                ts += 188;
-                                }
-                              else
-                                cLog::log (LOGERROR, "ts packet sync:%d", contentParsed);
-                              contentParsed += 188;
-                              }
-
-                            return true;
-                            }
-                            //}}}
-                          ) == 200) {
-              for (auto parser : mPidParsers)
-                parser.second->processLast (reuseFromFront);
-              http.freeContent();
-              }
-            else {
-              //{{{  failed to load chunk, backoff for 250ms
-              cLog::log (LOGERROR, fmt::format ("late {}", chunkNum));
-              this_thread::sleep_for (250ms);
+          vector<int> chunkNums = mHlsSong->getLoadChunkNums (mFetchAhead, mFetchBehind);
+          if (chunkNums.empty()) {
+            // nothing to load, backoff for 100ms
+            this_thread::sleep_for (100ms);
+            continue;
+            }
+
+          // demux in priority order, wait for first wanted chunk while others fetch
+          fetcher.fetch (chunkNums);
+          int chunkNum = chunkNums.front();
+          cHlsFetcher::cSegment* segment = fetcher.waitSegment (chunkNum, 100ms);
+          if (!segment) {
+            mLoadFrac = fetcher.getFrac (chunkNum);
+            continue;
+            }
+
+          if (segment->mResponse == 200) {
+            int64_t loadPts = mHlsSong->getChunkPts (chunkNum);
+            bool reuseFromFront = loadPts >= mHlsSong->getPlayPts();
+            cLog::log (LOGINFO1, fmt::format ("chunk:{} pts:{} size:{}k {}ms",
+                                              chunkNum,
+                                              utils::getPtsFramesString (loadPts, mHlsSong->getFramePtsDuration()),
+                                              segment->mContentSize/1000, segment->mMicroSeconds/1000));
+            mLoadSize = segment->mContentSize;
+            mLoadFrac = 1.f;
+
+            // parse ts packets
+            for (int contentParsed = 0; segment->mContentSize - contentParsed >= 188; contentParsed += 188) {
+              uint8_t* ts = segment->mContent + contentParsed;
+              if (ts[0] == 0x47)
+                mPidParsers.parse (ts, reuseFromFront);
+              else
+                cLog::log (LOGERROR, "ts packet sync:%d", contentParsed);
               }
-              //}}}
+            mPidParsers.processLast (reuseFromFront);
+
+            // choose rate for chunks still to fetch
+            rateSelector.addSegment (segment->mContentSize, segment->mMicroSeconds);
+            rateSelector.select (mHlsSong->getBufferedPts (mFetchAhead) / 90000.f,
+                                 (mFramesPerChunk * mPtsDurationPerFrame) / 90000.f);
             }
-          else // no chunk available yet, backoff for 100ms
-            this_thread::sleep_for (100ms);
+          else
+            // failed to load chunk, fetcher backs off before retrying it
+            cLog::log (LOGERROR, fmt::format ("late {} {}", chunkNum, segment->mResponse));
+
+          delete segment;
           }
         }
       }
 
+    {
+    // no getInfoString still using them once fetcher,rateSelector go out of scope
+    unique_lock<mutex> lock (mInfoMutex);
+    mFetcher = nullptr;
+    mRateSelector = nullptr;
+    }
+
     //{{{  delete resources
     if (mSongPlayer)
       mSongPlayer->wait();
@@ -1770,12 +1637,6 @@ public:
     mVideoPool = nullptr;
     delete tempVideoPool;
 
-    for (auto parser : mPidParsers) {
-      //{{{  stop and delete pidParsers
-      parser.second->exit();
-      delete parser.second;
-      }
-      //}}}
     mPidParsers.clear();
 
     auto tempSong = mHlsSong;
@@ -1807,6 +1668,23 @@ private:
   int mVideoRate = 827008;
   int mAudioRate = 128000;
   bool mFfmpeg = true;
+  bool mYuvSimd = true;
+  int mYuvBands = 1;
+  eDecodeThreads mDecodeThreads = eDecodeThreads::eFrameSlice;
+  int mNumDecodeThreads = 0;
+
+  // fetch
+  int mFetchConnections = 3;
+  int mFetchAhead = 1;
+  int mFetchBehind = 1;
+
+  // rate
+  bool mAdaptiveRate = true;
+
+  // load's stack fetcher,rateSelector, guarded for getInfoString on ui thread
+  mutex mInfoMutex;
+  cHlsFetcher* mFetcher = nullptr;
+  cHlsRateSelector* mRateSelector = nullptr;
 
   // http
   string mHost;
@@ -1953,7 +1831,7 @@ private:
     //auto streamCallback = [&](int sid, int pid, int type) noexcept {
 
       //(void)sid;
-      //if (mPidParsers.find (pid) == mPidParsers.end()) {
+      //if (!mPidParsers.has (pid)) {
         //// new stream pid
         //switch (type) {
           //case  2: // ISO 13818-2 video
@@ -1977,7 +1855,7 @@ private:
             //mVideoPid = pid;
 
             //mVideoPool = iVideoPool::create (true, 100, mPtsSong);
-            //mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cVideoPesParser (pid, mVideoPool, true)));
+            //mPidParsers.add (pid, new cVideoPesParser (pid, mVideoPool, true));
 
             //break;
           //}}}
@@ -1990,9 +1868,9 @@ private:
     //{{{
     //auto programCallback = [&](int pid, int sid) noexcept {
 
-      //if ((sid > 0) && (mPidParsers.find (pid) == mPidParsers.end())) {
+      //if ((sid > 0) && (!mPidParsers.has (pid))) {
         //cLog::log (LOGINFO, "PAT adding pid:service %d::%d", pid, sid);
-        //mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cPmtParser (pid, sid, streamCallback)));
+        //mPidParsers.add (pid, new cPmtParser (pid, sid, streamCallback));
         //}
       //};
     //}}}
@@ -2041,10 +1919,10 @@ private:
       //mTimeString = timeString;
       //};
     //}}}
-    //mPidParsers.insert (map<int,cPidParser*>::value_type (0x00, new cPatParser (programCallback)));
-    //mPidParsers.insert (map<int,cPidParser*>::value_type (0x11, new cSdtParser (sdtCallback)));
-    //mPidParsers.insert (map<int,cPidParser*>::value_type (0x12, new cEitParser (eitCallback)));
-    //mPidParsers.insert (map<int,cPidParser*>::value_type (0x14, new cTdtParser (tdtCallback)));
+    //mPidParsers.add (0x00, new cPatParser (programCallback));
+    //mPidParsers.add (0x11, new cSdtParser (sdtCallback));
+    //mPidParsers.add (0x12, new cEitParser (eitCallback));
+    //mPidParsers.add (0x14, new cTdtParser (tdtCallback));
 
     //constexpr int kUdpBufferSize = 2048;
     //char buffer[kUdpBufferSize];
@@ -2208,21 +2086,22 @@ public:
 
     int audioQueueSize = 0;
     int videoQueueSize = 0;
+    string poolString;
 
     if (mCurSid > 0) {
       cDvbService* service = mServices[mCurSid];
       if (service) {
-        auto audioIt = mPidParsers.find (service->getAudioPid());
-        if (audioIt != mPidParsers.end())
-          audioQueueSize = (*audioIt).second->getQueueSize();
-
-        auto videoIt = mPidParsers.find (service->getVideoPid());
-        if (videoIt != mPidParsers.end())
-          videoQueueSize = (*videoIt).second->getQueueSize();
+        audioQueueSize = mPidParsers.getQueueSize (service->getAudioPid());
+        videoQueueSize = mPidParsers.getQueueSize (service->getVideoPid());
+        poolString = mPidParsers.getPoolString (service->getVideoPid());
+        if (mVideoPool)
+          poolString += " " + mVideoPool->getPoolString();
         }
       }
 
-    return fmt::format ("{}packets sid:{} aq:{} vq:{}", mStreamPos/188, mCurSid, audioQueueSize, videoQueueSize);
+    return fmt::format ("{}packets sid:{} aq:{} vq:{} {} idx:{}:{}",
+                        mStreamPos/188, mCurSid, audioQueueSize, videoQueueSize, poolString,
+                        mTsIndex.getNumEntries(), mTsIndex.getNumKeyFrames());
     }
   //}}}
   //{{{
@@ -2238,13 +2117,8 @@ public:
       int audioPid = service->getAudioPid();
       int videoPid = service->getVideoPid();
 
-      auto audioIt = mPidParsers.find (audioPid);
-      if (audioIt != mPidParsers.end())
-        audioFrac = (*audioIt).second->getQueueFrac();
-
-      auto videoIt = mPidParsers.find (videoPid);
-      if (videoIt != mPidParsers.end())
-        videoFrac = (*videoIt).second->getQueueFrac();
+      audioFrac = mPidParsers.getQueueFrac (audioPid);
+      videoFrac = mPidParsers.getQueueFrac (videoPid);
       }
 
     return mLoadFrac;
@@ -2292,20 +2166,29 @@ public:
   //}}}
   //{{{
   virtual void load (function <void(int64_t)>& playCallback) final {
-  // manage our own file read, block on > 100 frames after playPts, manage kipping
-  // - can't mmap because of commmon case of growing ts file size
-  // - chunks are ts packet aligned
+  // parse mapped file, block on > 100 frames after playPts, seek skips using audio pts index
+  // - remap as a recording grows the file, finish when it stops growing
 
     mExit = false;
     mRunning = true;
 
-    // get first fileChunk
-    FILE* file = fopen (mFilename.c_str(), "rb");
-    uint8_t buffer[kFileChunkSize];
-    size_t bytesLeft = fread (buffer, 1, kFileChunkSize, file);
+    cMappedFile mappedFile;
+    if (!mappedFile.open (mFilename)) {
+      mRunning = false;
+      return;
+      }
+    mTsIndex.clear();
 
     mPtsSong = new cPtsSong (eAudioFrameType::eAacAdts, mNumChannels, mSampleRate, 1024, 1920, 0);
-    mPtsSong->setPlayCallback (playCallback);
+    // play position also drives video pool frame recycling
+    function <void(int64_t)> songPlayCallback = [&](int64_t pts) noexcept {
+      iVideoPool* videoPool = mVideoPool;
+      if (videoPool)
+        videoPool->setPlayPts (pts);
+      if (playCallback)
+        playCallback (pts);
+      };
+    mPtsSong->setPlayCallback (songPlayCallback);
 
     iAudioDecoder* audioDecoder = nullptr;
 
@@ -2315,9 +2198,7 @@ public:
 
     // init parsers, callbacks
     //{{{
-    auto audioFrameCallback = [&](bool reuseFromFront, float* samples, int64_t pts) noexcept {
-
-      mPtsSong->addFrame (reuseFromFront, pts, samples, mPtsSong->getNumFrames()+1);
+    auto audioFrameCallback = [&](int64_t pts) noexcept {
 
       if (loadPts < 0)
         // firstTime, setBasePts, sets playPts
@@ -2339,8 +2220,9 @@ public:
     //{{{
     auto streamCallback = [&](int sid, int pid, int type) noexcept {
 
-      if (mPidParsers.find (pid) == mPidParsers.end()) {
+      if (!mPidParsers.has (pid)) {
         // new stream pid
+        mTsIndex.addStream (sid, pid, type);
         auto it = mServices.find (sid);
         if (it != mServices.end()) {
           cDvbService* service = (*it).second;
@@ -2351,9 +2233,11 @@ public:
 
               if (service->isSelected()) {
                 audioDecoder = createAudioDecoder (eAudioFrameType::eAacAdts);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid,
-                  new cAudioPesParser (pid, audioDecoder, true, audioFrameCallback)));
+                mPidParsers.add (pid,
+                  new cAudioPesParser (pid, audioDecoder, mPtsSong, true, audioFrameCallback));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
@@ -2363,9 +2247,11 @@ public:
 
               if (service->isSelected()) {
                 audioDecoder = createAudioDecoder (eAudioFrameType::eAacLatm);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid,
-                  new cAudioPesParser (pid, audioDecoder, true, audioFrameCallback)));
+                mPidParsers.add (pid,
+                  new cAudioPesParser (pid, audioDecoder, mPtsSong, true, audioFrameCallback));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
@@ -2375,36 +2261,44 @@ public:
 
               if (service->isSelected()) {
                 mVideoPool = iVideoPool::create (true, 100, mPtsSong);
-                mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cVideoPesParser (pid, mVideoPool, true)));
+                mPidParsers.add (pid, new cVideoPesParser (pid, mVideoPool, true));
                 }
+              else
+                mPidParsers.ignore (pid);
 
               break;
             //}}}
             //{{{
             case 6:  // do nothing - subtitle
               //cLog::log (LOGINFO, "subtitle %d %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 2:  // do nothing - ISO 13818-2 video
               //cLog::log (LOGERROR, "mpeg2 video %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 3:  // do nothing - ISO 11172-3 audio
               //cLog::log (LOGINFO, "mp2 audio %d %d", pid, type);
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 5:  // do nothing - private mpeg2 tabled data
+              mPidParsers.ignore (pid);
               break;
             //}}}
             //{{{
             case 11: // do nothing - dsm cc u_n
+              mPidParsers.ignore (pid);
               break;
             //}}}
             default:
               cLog::log (LOGERROR, "loadTs - unrecognised stream type %d %d", pid, type);
+              mPidParsers.ignore (pid);
             }
           }
         else
@@ -2426,9 +2320,10 @@ public:
     //{{{
     auto programCallback = [&](int pid, int sid) noexcept {
 
-      if ((sid > 0) && (mPidParsers.find (pid) == mPidParsers.end())) {
+      if ((sid > 0) && (!mPidParsers.has (pid))) {
         cLog::log (LOGINFO, "PAT adding pid:service %d::%d", pid, sid);
-        mPidParsers.insert (map<int,cPidParser*>::value_type (pid, new cPmtParser (pid, sid, streamCallback)));
+        mPidParsers.add (pid, new cPmtParser (pid, sid, streamCallback));
+        mTsIndex.addProgram (sid, pid);
 
         // select first service in PAT
         mServices.insert (map<int,cDvbService*>::value_type (sid, new cDvbService (sid, mCurSid == -1)));
@@ -2437,89 +2332,103 @@ public:
         }
       };
     //}}}
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x00, new cPatParser (programCallback)));
-    mPidParsers.insert (map<int,cPidParser*>::value_type (0x11, new cSdtParser (sdtCallback)));
+    mPidParsers.add (0x00, new cPatParser (programCallback));
+    mPidParsers.add (0x11, new cSdtParser (sdtCallback));
+
+    if (mTsIndex.load (mFilename, mappedFile.getData(), mappedFile.getSize())) {
+      //{{{  create services, parsers from sidecar service,pid table, before PAT,PMT arrive
+      auto programs = mTsIndex.getPrograms();
+      for (auto& program : programs)
+        programCallback (program.mPmtPid, program.mSid);
+
+      auto streams = mTsIndex.getStreams();
+      for (auto& stream : streams)
+        streamCallback (stream.mSid, stream.mPid, stream.mStreamType);
+      }
+      //}}}
 
-    do {
-      // process fileChunk
-      uint8_t* ts = buffer;
-      while (!mExit && (bytesLeft >= 188) && (ts[0] == 0x47)) {
-        auto it = mPidParsers.find (((ts[1] & 0x1F) << 8) | ts[2]);
-        if (it != mPidParsers.end())
-          it->second->parse (ts, true);
-        ts += 188;
-        bytesLeft -= 188;
+    int growWaits = 0;
+    while (!mExit) {
+      if (mStreamPos + 188 > mappedFile.getSize()) {
+        //{{{  end of mapped file, remap if growing, else finish
+        if (mappedFile.remap()) {
+          mFileSize = mappedFile.getSize();
+          growWaits = 0;
+          continue;
+          }
 
-        mStreamPos += 188;
-        mLoadFrac = float(mStreamPos) / mFileSize;
+        if (++growWaits > kMaxGrowWaits)
+          break;
+        this_thread::sleep_for (kGrowWait);
+        continue;
+        }
+        //}}}
+
+      const uint8_t* ts = mappedFile.getData() + mStreamPos;
+      if (ts[0] != 0x47) {
+        // lost sync, hunt forward
+        mStreamPos++;
+        continue;
+        }
 
-        // block load if loadPts > xx audio frames ahead of playPts
-        while (!mExit && (mTargetPts == -1) && !waitForPts &&
-               (loadPts > mPtsSong->getPlayPts() + (100 * mPtsSong->getFramePtsDuration()))) {
-          //cLog::log (LOGINFO, "blocked loadPts:" + getPtsFramesString (loadPts, mPtsSong->getFramePtsDuration()) +
-          //                    " playPts:" + getPtsFramesString (mPtsSong->getPlayPts(), mPtsSong->getFramePtsDuration()));
-          this_thread::sleep_for (40ms);
+      if (mTsIndex.getAudioPid() < 0) {
+        //{{{  index selected service audio,video pids, once known
+        auto it = mServices.find (mCurSid);
+        if ((it != mServices.end()) && ((*it).second->getAudioPid() > 0)) {
+          cDvbService* service = (*it).second;
+          mTsIndex.setPids (service->getAudioPid(), service->getVideoPid() > 0 ? service->getVideoPid() : -1);
           }
+        }
+        //}}}
+      mTsIndex.add (ts, mStreamPos);
+      if (mTsIndex.isSaveDue())
+        mTsIndex.save (mFilename);
+
+      // parsers take non const ts, they don't write it
+      mPidParsers.parse ((uint8_t*)ts, true);
+      mStreamPos += 188;
+      mLoadFrac = float(mStreamPos) / mappedFile.getSize();
+
+      // block load if loadPts > xx audio frames ahead of playPts
+      while (!mExit && (mTargetPts == -1) && !waitForPts &&
+             (loadPts > mPtsSong->getPlayPts() + (100 * mPtsSong->getFramePtsDuration()))) {
+        //cLog::log (LOGINFO, "blocked loadPts:" + getPtsFramesString (loadPts, mPtsSong->getFramePtsDuration()) +
+        //                    " playPts:" + getPtsFramesString (mPtsSong->getPlayPts(), mPtsSong->getFramePtsDuration()));
+        this_thread::sleep_for (40ms);
+        }
 
-        if (mTargetPts > -1) {
-          int64_t diffPts = mTargetPts - mPtsSong->getPlayPts();
-          cLog::log (LOGINFO, "diffPts:%d", (int)diffPts);
-          if (diffPts > 100000) {
-            //{{{  skip forward
-            mStreamPos += (((diffPts * 50) / 9) / 188) * 188;
-            //{{{  fseek
-            #ifdef _WIN32
-              _fseeki64 (file, mStreamPos, SEEK_SET);
-            #endif
-
-            #ifdef __linux__
-              fseek (file, mStreamPos, SEEK_SET);
-            #endif
-            //}}}
-            bytesLeft = 0;
+      if (mTargetPts > -1) {
+        int64_t diffPts = mTargetPts - mPtsSong->getPlayPts();
+        cLog::log (LOGINFO, "diffPts:%d", (int)diffPts);
+        if ((diffPts > 100000) || (diffPts < -100000)) {
+          //{{{  skip to indexed offset
+          int64_t offset = mTsIndex.seek (mappedFile.getData(), mappedFile.getSize(), mTargetPts);
+          if (offset >= 0) {
+            cLog::log (LOGINFO, fmt::format ("seek pts:{} offset:{} from:{} index:{}",
+                                             utils::getPtsFramesString (mTargetPts, mPtsSong->getFramePtsDuration()),
+                                             offset, mStreamPos, mTsIndex.getNumEntries()));
+            mStreamPos = offset;
             waitForPts = true;
-            mVideoPool->flush (mTargetPts);
+            if (mVideoPool)
+              mVideoPool->flush (mTargetPts);
             }
-            //}}}
-          else if (diffPts < -100000) {
-            //{{{  skip back
-            mStreamPos += (((diffPts * 50) / 9) / 188) * 188;
-            //{{{  fseek
-            #ifdef _WIN32
-              _fseeki64 (file, mStreamPos, SEEK_SET);
-            #endif
-
-            #ifdef __linux__
-              fseek (file, mStreamPos, SEEK_SET);
-            #endif
-            //}}}
-            bytesLeft = 0;
-            waitForPts = true;
-            mVideoPool->flush (mTargetPts);
-            }
-            //}}}
-          else
-            mPtsSong->setPlayPts (mTargetPts);
-          mTargetPts = -1;
           }
+          //}}}
+        else
+          mPtsSong->setPlayPts (mTargetPts);
+        mTargetPts = -1;
         }
-
-      // get next fileChunk
-      bytesLeft = fread (buffer, 1, kFileChunkSize, file);
-      } while (!mExit && (bytesLeft > 188));
+      }
     mLoadFrac = 0.f;
 
+    if (mTsIndex.getAudioPid() >= 0)
+      mTsIndex.save (mFilename);
+
     //{{{  delete resources
     if (mSongPlayer)
       mSongPlayer->wait();
     delete mSongPlayer;
 
-    for (auto parser : mPidParsers) {
-      //{{{  stop and delete pidParsers
-      parser.second->exit();
-      delete parser.second;
-      }
-      //}}}
     mPidParsers.clear();
 
     auto tempSong =  mPtsSong;
@@ -2532,23 +2441,26 @@ public:
 
     delete audioDecoder;
     //}}}
-    fclose (file);
+    mappedFile.close();
     mRunning = false;
     }
   //}}}
 
 private:
-  static constexpr int kFileChunkSize = 16 * 188;
+  // wait for a growing recording before finishing
+  static constexpr chrono::milliseconds kGrowWait = 100ms;
+  static constexpr int kMaxGrowWaits = 20;
 
   cPtsSong* mPtsSong = nullptr;
   iVideoPool* mVideoPool = nullptr;
 
-  map <int, cPidParser*> mPidParsers;
+  cPidDispatch mPidParsers;
 
   int mCurSid = -1;
   map <int, cDvbService*> mServices;
 
   int64_t mTargetPts = -1;
+  cTsIndex mTsIndex;
   };
 //}}}
 //{{{
@@ -2612,10 +2524,8 @@ public:
       // process fileChunk
       while (!mExit &&
              ((kWavFrameSamples * mNumChannels * 4) <= (int)bytesLeft)) {
-        // read samples from fileChunk
-        float* samples = (float*)malloc (kWavFrameSamples * mNumChannels * 4);
-        memcpy (samples, frame, kWavFrameSamples * mNumChannels * 4);
-        mSong->addFrame (true, pts, samples, mSong->getNumFrames()+1);
+        // copy samples from fileChunk
+        mSong->copyFrame (true, pts, (const float*)frame, mSong->getNumFrames()+1);
         if (!mSongPlayer)
           mSongPlayer = new cSongPlayer (mSong, false);
 
@@ -2725,20 +2635,30 @@ public:
       while (!mExit &&
              cAudioParser::parseFrame (frame, frame + chunkBytesLeft, frameSize)) {
         // process frame in fileChunk
-        float* samples = decoder->decodeFrame (frame, frameSize, pts);
-        frame += frameSize;
-        chunkBytesLeft -= frameSize;
-        mStreamPos += frameSize;
-        if (samples) {
-          if (!mSong) {
-            // first decoded frame gives aacHE sampleRate,samplesPerFrame
+        bool decoded;
+        if (mSong)
+          // decode straight into song
+          decoded = mSong->decodeFrame (decoder, true, frame, frameSize, pts,
+                                        (mFileSize * mSong->getNumFrames()) / (mStreamPos + frameSize));
+        else {
+          // first decoded frame gives aacHE sampleRate,samplesPerFrame, copied in
+          vector <float> samples;
+          decoded = decoder->decodeFrame (frame, frameSize, pts, [&](int frameChannels, int frameSamples) noexcept {
+            samples.resize (frameChannels * frameSamples);
+            return samples.data();
+            });
+          if (decoded) {
             mSong = new cSong (mAudioFrameType, decoder->getNumChannels(), decoder->getSampleRate(),
                                decoder->getNumSamplesPerFrame(), 0);
             mSong->setPlayCallback (playCallback);
+            mSong->copyFrame (true, pts, samples.data(), (mFileSize * mSong->getNumFrames()) / (mStreamPos + frameSize));
             }
+          }
+        frame += frameSize;
+        chunkBytesLeft -= frameSize;
+        mStreamPos += frameSize;
 
-          // add frame to song
-          mSong->addFrame (true, pts, samples, (mFileSize * mSong->getNumFrames()) / mStreamPos);
+        if (decoded) {
           pts += mSong->getFramePtsDuration();
 
           if (!mSongPlayer)
@@ -49,13 +49,16 @@ bool cSongLoaderBox::prox (bool inClient, cPoint pos) {
 //{{{
 bool cSongLoaderBox::down (bool right, cPoint pos) {
 
-  (void)right;
-
   cSong* song = mSongLoader.getSong();
   if (song) {
     //std::shared_lock<std::shared_mutex> lock (song->getSharedMutex());
     pos.y += mRect.top;
-    if (pos.y > mDstOverviewTop) {
+    if (right && (pos.y < mDstWaveTop)) {
+      // toggle spectrum worker, turning on catches up loaded frames
+      song->setSpectrum (!song->getSpectrum());
+      changed();
+      }
+    else if (pos.y > mDstOverviewTop) {
       mPressedFrameNum = song->getFirstFrameNum() + ((pos.x * song->getTotalFrames()) / getWidth());
       song->setPlayPts (song->getPtsFromFrameNum (int64_t(mPressedFrameNum)));
       mOverviewPressed = true;
@@ -64,6 +67,7 @@ bool cSongLoaderBox::down (bool right, cPoint pos) {
     else if (pos.y > mDstRangeTop) {
       mPressedFrameNum = song->getPlayFrameNum() + ((pos.x - (getWidth()/2.f)) * mFrameStep / mFrameWidth);
       song->getSelect().start (int64_t(mPressedFrameNum));
+      song->setViewFrameNum (int64_t(mPressedFrameNum));
       mRangePressed = true;
       changed();
       }
@@ -94,6 +98,7 @@ bool cSongLoaderBox::move (bool right, cPoint pos, cPoint inc, int pressure, int
     else if (mRangePressed) {
       mPressedFrameNum += (inc.x / mFrameWidth) * mFrameStep;
       song->getSelect().move (int64_t(mPressedFrameNum));
+      song->setViewFrameNum (int64_t(mPressedFrameNum));
       changed();
       }
     else {
@@ -115,8 +120,10 @@ bool cSongLoaderBox::up (bool right, bool mouseMoved, cPoint pos) {
   //cWidget::up();
 
   cSong* song = mSongLoader.getSong();
-  if (song)
+  if (song) {
     song->getSelect().end();
+    song->setViewFrameNum (-1);
+    }
 
   mOverviewPressed = false;
   mRangePressed = false;
@@ -160,7 +167,8 @@ void cSongLoaderBox::draw() {
     drawWaveform (song, playFrame, leftWaveFrame, rightWaveFrame, mono);
     if (mShowOverview)
       drawOverview (song, playFrame, mono);
-    drawFrequencies (song, playFrame);
+    if (song->getSpectrum())
+      drawFrequencies (song, playFrame);
     }
 
   drawRange (song, playFrame, leftWaveFrame, rightWaveFrame);
@@ -233,13 +241,17 @@ void cSongLoaderBox::drawWaveform (cSong* song, int64_t playFrame, int64_t leftF
   float width = (float)mFrameStep;
   if (mFrameStep == 1) {
     //{{{  draw all peak values
+    // draw red silence runs
+    for (auto& silenceRun : song->getSilenceRuns (leftFrame, rightFrame-1)) {
+      float silenceLeft = (max (silenceRun.first, leftFrame) - leftFrame) * width;
+      float silenceRight = (min (silenceRun.second + 1, rightFrame) - leftFrame) * width;
+      drawRectangleUnclipped (kRed, {silenceLeft, mDstWaveCentre - 1.f, silenceRight, mDstWaveCentre + 1.f});
+      }
+
     float left = 0;
     for (int64_t frame = leftFrame; frame < rightFrame; frame += mFrameStep, left += width) {
       cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
       if (framePtr && framePtr->getPowerValues()) {
-        if (framePtr->isSilence()) // draw red silence
-          drawRectangleUnclipped (kRed, {left, mDstWaveCentre - 1.f, left  + width, mDstWaveCentre + 1.f});
-
         // draw frame peak values scaled to maxPeak
         float* peakValuesPtr = framePtr->getPeakValues();
         values[0] = *peakValuesPtr * peakValueScale;
@@ -252,39 +264,27 @@ void cSongLoaderBox::drawWaveform (cSong* song, int64_t playFrame, int64_t leftF
 
   float left = mRect.left;
   //float top = mRect.top;
-  //{{{  draw powerValues before playFrame, summed if zoomed out
+  //{{{  draw powerValues before playFrame, summarised if zoomed out
   for (int64_t frame = leftFrame; frame < playFrame; frame += mFrameStep, left += width) {
-    cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
-    if (framePtr) {
-      if (mFrameStep == 1) {
-        // power scaled to maxPeak
-        if (framePtr->getPowerValues()) {
-         float* powerValuesPtr = framePtr->getPowerValues();
-          values[0] = powerValuesPtr[0] * peakValueScale;
-          values[1] = powerValuesPtr[1] * peakValueScale;
-          }
+    if (mFrameStep == 1) {
+      // power scaled to maxPeak
+      cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
+      if (framePtr && framePtr->getPowerValues()) {
+        float* powerValuesPtr = framePtr->getPowerValues();
+        values[0] = powerValuesPtr[0] * peakValueScale;
+        values[1] = powerValuesPtr[1] * peakValueScale;
+        drawRectangleUnclipped (kDarkBlue, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
         }
-      else {
-        // sum mFrameStep frames, mFrameStep aligned, scaled to maxPower
-        values[0] = 0.f;
-        values[1] = 0.f;
-
-        int64_t alignedFrame = frame - (frame % mFrameStep);
-        int64_t toSumFrame = min (alignedFrame + mFrameStep, rightFrame);
-        for (int64_t sumFrame = alignedFrame; sumFrame < toSumFrame; sumFrame++) {
-          cSong::cFrame* sumFramePtr = song->findFrameByFrameNum (sumFrame);
-          if (sumFramePtr && sumFramePtr->getPowerValues()) {
-            float* powerValuesPtr = sumFramePtr->getPowerValues();
-            values[0] += powerValuesPtr[0] * powerValueScale;
-            values[1] += powerValuesPtr[1] * powerValueScale;
-            }
-          }
-
-        values[0] /= toSumFrame - alignedFrame + 1;
-        values[1] /= toSumFrame - alignedFrame + 1;
+      }
+    else {
+      // rms of mFrameStep frames, mFrameStep aligned, scaled to maxPower
+      int64_t alignedFrame = frame - (frame % mFrameStep);
+      cSong::cWaveSummary::cBucket summary = song->getWaveSummary (alignedFrame, min (alignedFrame + mFrameStep, rightFrame));
+      if (summary.mNumFrames) {
+        values[0] = summary.getRms (0) * powerValueScale;
+        values[1] = summary.getRms (1) * powerValueScale;
+        drawRectangleUnclipped (kDarkBlue, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
         }
-
-      drawRectangleUnclipped (kDarkBlue, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
       }
     }
   //}}}
@@ -304,37 +304,27 @@ void cSongLoaderBox::drawWaveform (cSong* song, int64_t playFrame, int64_t leftF
 
   left += width;
   //}}}
-  //{{{  draw powerValues after playFrame, summed if zoomed out
+  //{{{  draw powerValues after playFrame, summarised if zoomed out
   for (int64_t frame = playFrame + mFrameStep; frame < rightFrame; frame += mFrameStep, left += width) {
-    cSong::cFrame* sumFramePtr = song->findFrameByFrameNum (frame);
-    if (sumFramePtr && sumFramePtr->getPowerValues()) {
-      if (mFrameStep == 1) {
-        // power scaled to maxPeak
-        float* powerValuesPtr = sumFramePtr->getPowerValues();
+    if (mFrameStep == 1) {
+      // power scaled to maxPeak
+      cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
+      if (framePtr && framePtr->getPowerValues()) {
+        float* powerValuesPtr = framePtr->getPowerValues();
         values[0] = powerValuesPtr[0] * peakValueScale;
         values[1] = powerValuesPtr[1] * peakValueScale;
+        drawRectangleUnclipped (kLightGray, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
         }
-      else {
-        // sum mFrameStep frames, mFrameStep aligned, scaled to maxPower
-        values[0] = 0.f;
-        values[1] = 0.f;
-
-        int64_t alignedFrame = frame - (frame % mFrameStep);
-        int64_t toSumFrame = min (alignedFrame + mFrameStep, rightFrame);
-        for (int64_t sumFrame = alignedFrame; sumFrame < toSumFrame; sumFrame++) {
-          cSong::cFrame* toSumFramePtr = song->findFrameByFrameNum (sumFrame);
-          if (toSumFramePtr && toSumFramePtr->getPowerValues()) {
-            float* powerValuesPtr = toSumFramePtr->getPowerValues();
-            values[0] += powerValuesPtr[0] * powerValueScale;
-            values[1] += powerValuesPtr[1] * powerValueScale;
-            }
-          }
-
-        values[0] /= toSumFrame - alignedFrame + 1;
-        values[1] /= toSumFrame - alignedFrame + 1;
+      }
+    else {
+      // rms of mFrameStep frames, mFrameStep aligned, scaled to maxPower
+      int64_t alignedFrame = frame - (frame % mFrameStep);
+      cSong::cWaveSummary::cBucket summary = song->getWaveSummary (alignedFrame, min (alignedFrame + mFrameStep, rightFrame));
+      if (summary.mNumFrames) {
+        values[0] = summary.getRms (0) * powerValueScale;
+        values[1] = summary.getRms (1) * powerValueScale;
+        drawRectangleUnclipped (kLightGray, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
         }
-
-      drawRectangleUnclipped (kLightGray, {left, mDstWaveCentre - values[0], left + width, mDstWaveCentre + values[1]});
       }
     }
   //}}}
@@ -387,90 +377,32 @@ void cSongLoaderBox::drawRange (cSong* song, int64_t playFrame, int64_t leftFram
 //}}}
 //{{{
 void cSongLoaderBox::drawWaveformOverview (cSong* song, int64_t firstFrame, int64_t playFrame, float playFrameX, float valueScale, bool mono) {
-// use simple overview cache, invalidate if anything changed
+// draw whole song, one waveSummary per pixel column
 
   (void)playFrame;
   (void)playFrameX;
   int64_t lastFrame = song->getLastFrameNum();
   int64_t totalFrames = song->getTotalFrames();
 
-  bool changed = mChanged ||
-                 (mOverviewTotalFrames != totalFrames) ||
-                 (mOverviewFirstFrame != firstFrame) ||
-                 (mOverviewLastFrame != lastFrame) ||
-                 (mOverviewValueScale != valueScale);
-
-  mOverviewTotalFrames = totalFrames;
-  mOverviewLastFrame = lastFrame;
-  mOverviewFirstFrame = firstFrame;
-  mOverviewValueScale = valueScale;
-
   float left = mRect.left;
   float width = 1.f;
 
-  if (!changed) {
-    //{{{  draw overview cache, return
-    for (uint32_t x = 0; x < static_cast<uint32_t>(getWidth()); x++, left += 1.f)
-      drawRectangleUnclipped (kGray, {left, mDstOverviewCentre - mOverviewValuesL[x],
-                             left + width, mDstOverviewCentre - mOverviewValuesL[x] + mOverviewValuesR[x]});
-    return;
-    }
-    //}}}
-
-  array <float,2> values;
   for (uint32_t x = 0; x < getWidth(); x++, left += 1.f) {
     // iterate window width
     int64_t frame = firstFrame + ((x * totalFrames) / static_cast<uint32_t>(getWidth()));
     int64_t toFrame = firstFrame + (((x+1) * totalFrames) / static_cast<uint32_t>(getWidth()));
-    if (toFrame > lastFrame)
-      toFrame = lastFrame+1;
+    toFrame = min (max (toFrame, frame+1), lastFrame+1);
 
-    bool silence = false;
-    cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
-    if (framePtr && framePtr->getPowerValues()) {
-      //{{{  accumulate frame,silence
-      if (framePtr->isSilence())
-        silence = true;
+    cSong::cWaveSummary::cBucket summary = song->getWaveSummary (frame, toFrame);
+    if (!summary.mNumFrames)
+      continue;
 
-      float* powerValues = framePtr->getPowerValues();
-      values[0] = powerValues[0];
-      values[1] = mono ? 0 : powerValues[1];
-
-      if (frame < toFrame) {
-        int numSummedFrames = 1;
-        frame++;
-        while (frame < toFrame) {
-          framePtr = song->findFrameByFrameNum (frame);
-          if (framePtr) {
-            if (framePtr->isSilence())
-              silence = true;
-            if (framePtr->getPowerValues()) {
-              float* sumPowerValues = framePtr->getPowerValues();
-              values[0] += sumPowerValues[0];
-              values[1] += mono ? 0 : sumPowerValues[1];
-              numSummedFrames++;
-              }
-            }
-          frame++;
-          }
-
-        values[0] /= numSummedFrames;
-        values[1] /= numSummedFrames;
-        }
-
-      values[0] *= valueScale;
-      values[1] *= valueScale;
+    if (summary.mSilence) // draw red silence
+      drawRectangleUnclipped (kRed, {left, mDstOverviewCentre - 1.f, left + width, mDstOverviewCentre + 1.f});
 
-      mOverviewValuesL[x] = values[0];
-      mOverviewValuesR[x] = values[0] + values[1];
-      }
-      //}}}
-
-    if (silence) // draw red silence
-      drawRectangleUnclipped (kRed, {left, mDstOverviewCentre - 1.f,
-                            left + width, mDstOverviewCentre + 1.f});
-    drawRectangleUnclipped (kGray, {left, mDstOverviewCentre - mOverviewValuesL[x],
-                           left + width, mDstOverviewCentre - mOverviewValuesL[x] + mOverviewValuesR[x]});
+    float valueL = summary.getRms (0) * valueScale;
+    float valueR = mono ? 0.f : summary.getRms (1) * valueScale;
+    drawRectangleUnclipped (kGray, {left, mDstOverviewCentre - valueL, left + width, mDstOverviewCentre + valueR});
     }
   }
 //}}}
@@ -496,16 +428,8 @@ void cSongLoaderBox::drawOverviewLens (cSong* song, int64_t playFrame, float cen
   rightFrame = min (rightFrame, song->getLastFrameNum());
 
   // calc lens max power
-  float maxPowerValue = 0.f;
-  for (int64_t frame = int(leftFrame); frame <= rightFrame; frame++) {
-    cSong::cFrame* framePtr = song->findFrameByFrameNum (frame);
-    if (framePtr && framePtr->getPowerValues()) {
-      float* powerValues = framePtr->getPowerValues();
-      maxPowerValue = max (maxPowerValue, powerValues[0]);
-      if (!mono)
-        maxPowerValue = max (maxPowerValue, powerValues[1]);
-      }
-    }
+  cSong::cWaveSummary::cBucket summary = song->getWaveSummary (int64_t(leftFrame), rightFrame+1);
+  float maxPowerValue = mono ? summary.mMaxPower[0] : max (summary.mMaxPower[0], summary.mMaxPower[1]);
 
   // draw unzoomed waveform, start before playFrame
   float left = firstX;
@@ -597,7 +521,7 @@ void cSongLoaderBox::drawFrequencies (cSong* song, int64_t playFrame) {
 
   float left = mRect.left;
   cSong::cFrame* framePtr = song->findFrameByFrameNum (playFrame);
-  if (framePtr && framePtr->getFreqValues()) {
+  if (framePtr && framePtr->isFreqReady()) {
     uint8_t* freqValues = framePtr->getFreqValues();
     for (uint32_t i = 0; (i < song->getNumFreqBytes()) && ((i*2) < getWidth()); i++, left += 2.f)
       drawRectangleUnclipped (kYellow, {left, mRect.bottom - freqValues[i] * valueScale, left + 2.f, mRect.bottom});
@@ -74,12 +74,4 @@ private:
 
   float mDstWaveCentre = 0.f;
   float mDstOverviewCentre = 0.f;
-
-  // mOverview cache
-  std::array <float,3000> mOverviewValuesL = { 0.f };
-  std::array <float,3000> mOverviewValuesR = { 0.f };
-  int64_t mOverviewTotalFrames = 0;
-  int64_t mOverviewLastFrame = 0;
-  int64_t mOverviewFirstFrame = 0;
-  float mOverviewValueScale = 0.f;
   };
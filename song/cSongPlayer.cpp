@@ -5,7 +5,7 @@
   #define WIN32_LEAN_AND_MEAN
   #include "../audio/audioWASAPI.h"
 #else // linux
-  #include "../audio/cLinuxAudio.h"
+  #include "../audio/cAudioStream.h"
 #endif
 
 #include "cSongPlayer.h"
@@ -91,30 +91,54 @@ using namespace std;
       array <float,2048*2> samples = { 0.f };
 
       song->togglePlaying();
-      //{{{  player thread, video follows playPts
-      cAudio audio (2, song->getSampleRate(), 40000);
+      //{{{  player thread, fills audioStream ring, video follows playPts
+      cAudioStream* audioStream = cAudioStream::create (mAudioOutput, 2, song->getSampleRate(), mAudioLatencyMs * 1000);
+      if (!audioStream->isOk()) {
+        // keep playPts moving for video without audio
+        delete audioStream;
+        audioStream = cAudioStream::create ("null", 2, song->getSampleRate(), mAudioLatencyMs * 1000);
+        }
 
+      int64_t underruns = 0;
       cSong::cFrame* frame;
       while (!mExit) {
-        float* playSamples = silence.data();
-          {
-          // scoped song mutex
-          shared_lock<shared_mutex> lock (song->getSharedMutex());
-          frame = song->findPlayFrame();
-          bool gotSamples = song->getPlaying() && frame && frame->getSamples();
-          if (gotSamples) {
-            memcpy (samples.data(), frame->getSamples(), song->getSamplesPerFrame() * 8);
-            playSamples = samples.data();
+        int numSamples = song->getSamplesPerFrame();
+        if (!audioStream->waitWrite (numSamples, 100ms))
+          continue;
+
+        {
+        // scoped song mutex
+        shared_lock<shared_mutex> lock (song->getSharedMutex());
+        frame = song->findPlayFrame();
+        bool gotSamples = song->getPlaying() && frame && frame->getSamples();
+        if (gotSamples && (song->getNumChannels() == 1)) {
+          // mono to stereo
+          float* src = frame->getSamples();
+          float* dst = samples.data();
+          for (int i = 0; i < numSamples; i++) {
+            *dst++ = *src;
+            *dst++ = *src++;
             }
+          audioStream->write (samples.data(), numSamples);
           }
-        audio.play (2, playSamples, song->getSamplesPerFrame(), 1.f);
+        else
+          audioStream->write (gotSamples ? frame->getSamples() : silence.data(), numSamples);
+        }
 
         if (frame && song->getPlaying())
           song->nextPlayFrame (true);
 
+        if (audioStream->getUnderruns() != underruns) {
+          underruns = audioStream->getUnderruns();
+          cLog::log (LOGINFO1, fmt::format ("underrun {}", audioStream->getInfoString()));
+          }
+
         if (!streaming && song->getPlayFinished())
           break;
         }
+
+      cLog::log (LOGINFO, audioStream->getInfoString());
+      delete audioStream;
       //}}}
       mRunning = false;
       cLog::log (LOGINFO, "exit");
@@ -128,6 +152,11 @@ using namespace std;
     }
 #endif
 
+void cSongPlayer::setAudioOutput (const string& output, int latencyMs) {
+  mAudioOutput = output;
+  mAudioLatencyMs = latencyMs;
+  }
+
 void cSongPlayer::wait() {
   while (mRunning)
     this_thread::sleep_for (100ms);
@@ -1,5 +1,6 @@
 // cSongPlayer.h
 #pragma once
+#include <string>
 class cSong;
 
 class cSongPlayer {
@@ -7,10 +8,16 @@ public:
   cSongPlayer (cSong* song, bool streaming);
   ~cSongPlayer() {}
 
+  // linux audio output, "default" device, "null" or raw float filename, target latency
+  static void setAudioOutput (const std::string& output, int latencyMs);
+
   void exit() { mExit = true; }
   void wait();
 
 private:
+  inline static std::string mAudioOutput = "default";
+  inline static int mAudioLatencyMs = 40;
+
   bool mExit = false;
   bool mRunning = true;
   };
@@ -6,9 +6,12 @@
 
 #include <cstring>
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <thread>
+#include <mutex>
 #include <shared_mutex>
+#include <condition_variable>
 #include <vector>
 #include <map>
 
@@ -34,11 +37,14 @@ extern "C" {
 //}}}
 #include "cSong.h"
 
+#include "oneapi/tbb/parallel_for.h"
+
 #if defined (__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
   #define INTEL_SSE2
   #define INTEL_SSSE3 1
   #include <emmintrin.h>
   #include <tmmintrin.h>
+  #include <immintrin.h>
 #else
   #include <arm_neon.h>
   //{{{
@@ -112,300 +118,15 @@ using namespace std;
 //}}}
 constexpr int kPtsPerSecond = 90000;
 
-namespace {
-  //{{{
-  const uint8_t kExpGolombBits[256] = {
-    8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4, 3,
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0,
-    };
-  //}}}
-  //{{{
-  class cBitstream {
-  // used to parse H264 stream to find I frames
-  public:
-    cBitstream (const uint8_t* buffer, uint32_t bit_len)
-      : mDecBuffer(buffer), mDecBufferSize(bit_len), mNumOfBitsInBuffer(0), mBookmarkOn(false) {}
-
-    //{{{
-    uint32_t peekBits (uint32_t bits) {
-
-      bookmark (true);
-      uint32_t ret = getBits (bits);
-      bookmark (false);
-      return ret;
-      }
-    //}}}
-    //{{{
-    uint32_t getBits (uint32_t numBits) {
-
-      //{{{
-      static const uint32_t msk[33] = {
-        0x00000000, 0x00000001, 0x00000003, 0x00000007,
-        0x0000000f, 0x0000001f, 0x0000003f, 0x0000007f,
-        0x000000ff, 0x000001ff, 0x000003ff, 0x000007ff,
-        0x00000fff, 0x00001fff, 0x00003fff, 0x00007fff,
-        0x0000ffff, 0x0001ffff, 0x0003ffff, 0x0007ffff,
-        0x000fffff, 0x001fffff, 0x003fffff, 0x007fffff,
-        0x00ffffff, 0x01ffffff, 0x03ffffff, 0x07ffffff,
-        0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff,
-        0xffffffff
-        };
-      //}}}
-
-      if (numBits == 0)
-        return 0;
-
-      uint32_t retData;
-      if (mNumOfBitsInBuffer >= numBits) {  // don't need to read from FILE
-        mNumOfBitsInBuffer -= numBits;
-        retData = mDecData >> mNumOfBitsInBuffer;
-        // wmay - this gets done below...retData &= msk[numBits];
-        }
-      else {
-        uint32_t nbits;
-        nbits = numBits - mNumOfBitsInBuffer;
-        if (nbits == 32)
-          retData = 0;
-        else
-          retData = mDecData << nbits;
-
-        switch ((nbits - 1) / 8) {
-          case 3:
-            nbits -= 8;
-            if (mDecBufferSize < 8)
-              return 0;
-            retData |= *mDecBuffer++ << nbits;
-            mDecBufferSize -= 8;
-            // fall through
-          case 2:
-            nbits -= 8;
-            if (mDecBufferSize < 8)
-              return 0;
-            retData |= *mDecBuffer++ << nbits;
-            mDecBufferSize -= 8;
-            // fall through
-          case 1:
-            nbits -= 8;
-            if (mDecBufferSize < 8)
-              return 0;
-            retData |= *mDecBuffer++ << nbits;
-            mDecBufferSize -= 8;
-            // fall through
-          case 0:
-            break;
-          }
-        if (mDecBufferSize < nbits)
-          return 0;
-
-        mDecData = *mDecBuffer++;
-        mNumOfBitsInBuffer = min(8u, mDecBufferSize) - nbits;
-        mDecBufferSize -= min(8u, mDecBufferSize);
-        retData |= (mDecData >> mNumOfBitsInBuffer) & msk[nbits];
-        }
-
-      return (retData & msk[numBits]);
-      };
-    //}}}
-
-    //{{{
-    uint32_t getUe() {
-
-      uint32_t bits  = 0;
-      uint32_t read = 0;
-      int bits_left;
-      bool done = false;
-
-      // we want to read 8 bits at a time - if we don't have 8 bits,
-      // read what's left, and shift.  The exp_golomb_bits calc remains the same.
-      while (!done) {
-        bits_left = bitsRemain();
-        if (bits_left < 8) {
-          read = peekBits (bits_left) << (8 - bits_left);
-          done = true;
-          }
-        else {
-          read = peekBits (8);
-          if (read == 0) {
-            getBits (8);
-            bits += 8;
-            }
-          else
-           done = true;
-          }
-        }
-
-      uint8_t coded = kExpGolombBits[read];
-      getBits (coded);
-      bits += coded;
-
-      return getBits (bits + 1) - 1;
-      }
-    //}}}
-    //{{{
-    int32_t getSe() {
-
-      uint32_t ret;
-      ret = getUe();
-      if ((ret & 0x1) == 0) {
-        ret >>= 1;
-        int32_t temp = 0 - ret;
-        return temp;
-        }
-
-      return (ret + 1) >> 1;
-      }
-    //}}}
-
-    //{{{
-    void check0s (int count) {
-
-      uint32_t val = getBits (count);
-      if (val != 0)
-        cLog::log (LOGERROR, "field error - %d bits should be 0 is %x", count, val);
-      }
-    //}}}
-    //{{{
-    int bitsRemain() {
-      return mDecBufferSize + mNumOfBitsInBuffer;
-      };
-    //}}}
-    //{{{
-    int byteAlign() {
-
-      int temp = 0;
-      if (mNumOfBitsInBuffer != 0)
-        temp = getBits (mNumOfBitsInBuffer);
-      else {
-        // if we are byte aligned, check for 0x7f value - this will indicate
-        // we need to skip those bits
-        uint8_t readval = (uint8_t)peekBits (8);
-        if (readval == 0x7f)
-          readval = (uint8_t)getBits (8);
-        }
-
-      return temp;
-      };
-    //}}}
-
-  private:
-    //{{{
-    void bookmark (bool on) {
-
-      if (on) {
-        mNumOfBitsInBuffer_bookmark = mNumOfBitsInBuffer;
-        mDecBuffer_bookmark = mDecBuffer;
-        mDecBufferSize_bookmark = mDecBufferSize;
-        mBookmarkOn = true;
-        mDecData_bookmark = mDecData;
-        }
-
-      else {
-        mNumOfBitsInBuffer = mNumOfBitsInBuffer_bookmark;
-        mDecBuffer = mDecBuffer_bookmark;
-        mDecBufferSize = mDecBufferSize_bookmark;
-        mDecData = mDecData_bookmark;
-        mBookmarkOn = false;
-        }
-      };
-    //}}}
-
-    const uint8_t* mDecBuffer;
-    uint32_t mDecBufferSize;
-    uint32_t mNumOfBitsInBuffer;
-    bool mBookmarkOn;
-
-    uint8_t mDecData = 0;
-    uint8_t mDecData_bookmark = 0;
-    uint32_t mNumOfBitsInBuffer_bookmark = 0;
-    uint32_t mDecBufferSize_bookmark = 0;
-    const uint8_t* mDecBuffer_bookmark = nullptr;
-    };
-  //}}}
-  //{{{
-  char getH264FrameType (uint8_t* pes, int pesSize) {
-  // minimal h264 parser - returns frameType of video pes
-
-    uint8_t* pesEnd = pes + pesSize;
-    while (pes < pesEnd) {
-      uint8_t* buf = pes;
-      uint32_t bufSize = (uint32_t)pesSize;
-      uint32_t startOffset = 0;
-      //{{{  skip past startcode
-      if (!buf[0] && !buf[1]) {
-        if (!buf[2] && buf[3] == 1) {
-          buf += 4;
-          startOffset = 4;
-          }
-        else if (buf[2] == 1) {
-          buf += 3;
-          startOffset = 3;
-          }
-        }
-      //}}}
-
-      uint32_t offset = startOffset;
-      uint32_t nalSize = offset;
-      //{{{  find next startcode
-      uint32_t val = 0xffffffff;
-      while (offset++ < bufSize - 3) {
-        val = (val << 8) | *buf++;
-        if (val == 0x0000001) {
-          nalSize = offset - 4;
-          break;
-          }
-        if ((val & 0x00ffffff) == 0x0000001) {
-          nalSize = offset - 3;
-          break;
-          }
-        nalSize = (uint32_t)bufSize;
-        }
-      //}}}
-
-      if (nalSize > 3) {
-        // parse NAL bitStream
-        cBitstream bitstream (buf, (nalSize - startOffset) * 8);
-        bitstream.check0s (1);
-        bitstream.getBits (2);
-        switch (bitstream.getBits (5)) {
-          case 1:
-          case 5:
-            bitstream.getUe();
-            switch (bitstream.getUe()) {
-              case 5:  return 'P';
-              case 6:  return 'B';
-              case 7:  return 'I';
-              default: return '?';
-              }
-            break;
-          //case 6: cLog::log(LOGINFO, ("SEI"); break;
-          //case 7: cLog::log(LOGINFO, ("SPS"); break;
-          //case 8: cLog::log(LOGINFO, ("PPS"); break;
-          //case 9: cLog::log(LOGINFO,  ("AUD"); break;
-          //case 0x0d: cLog::log(LOGINFO, ("SEQEXT"); break;
-          }
-        }
-
-      pes += nalSize;
-      }
-
-    return '?';
-    }
-  //}}}
-  }
+//{{{
+class cYuvConvert {
+// yuv420 to rgba conversion settings, owned by videoPool, passed as setYuv420 context
+public:
+  SwsContext* mSwsContext = nullptr;
+  atomic<bool> mSimd = true;
+  atomic<int> mBands = 1;
+  };
+//}}}
 
 // iVideoFrame classes
 //{{{
@@ -442,15 +163,17 @@ public:
     mFrameType = frameType;
     mPesSize = pesSize;
 
-    #ifdef _WIN32
-      if (!mBuffer8888)
-        // allocate aligned buffer
-        mBuffer8888 = (uint32_t*)_aligned_malloc (width * height * 4, 128);
-    #else
-      if (!mBuffer8888)
-        // allocate aligned buffer
-        mBuffer8888 = (uint32_t*)aligned_alloc (128, width * height * 4);
-    #endif
+    if (width * height > mBufferSize) {
+      // first or larger frame, hls rate switch changes size, allocate aligned buffer
+      mBufferSize = width * height;
+      #ifdef _WIN32
+        _aligned_free (mBuffer8888);
+        mBuffer8888 = (uint32_t*)_aligned_malloc (mBufferSize * 4, 128);
+      #else
+        free (mBuffer8888);
+        mBuffer8888 = (uint32_t*)aligned_alloc (128, mBufferSize * 4);
+      #endif
+      }
     }
   //}}}
   //{{{
@@ -466,6 +189,7 @@ protected:
   int mWidth = 0;
   int mHeight = 0;
   uint32_t* mBuffer8888 = nullptr;
+  int mBufferSize = 0;
 
 private:
   bool mFree = false;
@@ -834,10 +558,224 @@ public:
     // ffmpeg libswscale convert data to mBuffer8888 using swsContext
     uint8_t* dstData[1] = { (uint8_t*)mBuffer8888 };
     int dstStride[1] = { mWidth * 4 };
-    sws_scale ((SwsContext*)context, data, linesize, 0, mHeight, dstData, dstStride);
+    sws_scale (((cYuvConvert*)context)->mSwsContext, data, linesize, 0, mHeight, dstData, dstStride);
     }
   };
 //}}}
+#if defined(INTEL_SSE2) && !defined(_WIN32)
+  //{{{
+  class cFramePlanarRgbaSimd : public cFramePlanarRgbaSws {
+  // linux intel yuv420p to rgba, sse4.1 or avx2 kernel chosen at runtime, optionally split into row bands
+  public:
+    virtual ~cFramePlanarRgbaSimd() {}
+
+    //{{{
+    static const char* getKernelName() {
+      return useAvx2() ? "avx2" : useSse41() ? "sse4" : "sws";
+      }
+    //}}}
+
+    //{{{
+    virtual void setYuv420 (void* context, uint8_t** data, int* linesize) {
+
+      cYuvConvert* yuvConvert = (cYuvConvert*)context;
+      if (!yuvConvert->mSimd || !useSse41() || (mWidth % 16) || (mHeight % 2)) {
+        // not selected, not supported or odd size, fallback to sws
+        cFramePlanarRgbaSws::setYuv420 (context, data, linesize);
+        return;
+        }
+
+      // bands of even row pairs
+      int numBands = max (1, min ((int)yuvConvert->mBands, mHeight / 16));
+      int bandHeight = (((mHeight + numBands - 1) / numBands) + 1) & ~1;
+
+      if (numBands == 1)
+        convertBand (data, linesize, 0, mHeight);
+      else
+        tbb::parallel_for (0, numBands, [&](int band) {
+          int firstRow = band * bandHeight;
+          convertBand (data, linesize, firstRow, min (firstRow + bandHeight, mHeight));
+          });
+      }
+    //}}}
+
+  private:
+    //{{{
+    static bool useSse41() {
+      static const bool kSse41 = __builtin_cpu_supports ("sse4.1");
+      return kSse41;
+      }
+    //}}}
+    //{{{
+    static bool useAvx2() {
+      static const bool kAvx2 = __builtin_cpu_supports ("avx2");
+      return kAvx2;
+      }
+    //}}}
+
+    //{{{
+    void convertBand (uint8_t** data, int* linesize, int firstRow, int lastRow) {
+
+      if (useAvx2())
+        convertAvx2 (data, linesize, firstRow, lastRow);
+      else
+        convertSse41 (data, linesize, firstRow, lastRow);
+      }
+    //}}}
+
+    //{{{
+    __attribute__((target("sse4.1")))
+    void convertSse41 (uint8_t** data, int* linesize, int firstRow, int lastRow) {
+    // same coefficients as windows sse2 cFramePlanarRgba, saturating to stop bright blue wrapping
+
+      __m128i ysub  = _mm_set1_epi16 (0x0010);
+      __m128i uvsub = _mm_set1_epi16 (0x0080);
+      __m128i facy  = _mm_set1_epi16 (0x004a);
+      __m128i facrv = _mm_set1_epi16 (0x0066);
+      __m128i facgu = _mm_set1_epi16 (0x0019);
+      __m128i facgv = _mm_set1_epi16 (0x0034);
+      __m128i facbu = _mm_set1_epi16 (0x0081);
+      __m128i alpha = _mm_set1_epi32 (0xFFFFFFFF);
+
+      for (int y = firstRow; y < lastRow; y += 2) {
+        uint8_t* srcY0 = data[0] + (linesize[0] * y);
+        uint8_t* srcY1 = srcY0 + linesize[0];
+        uint8_t* srcU = data[1] + (linesize[1] * (y/2));
+        uint8_t* srcV = data[2] + (linesize[2] * (y/2));
+        __m128i* dst0 = (__m128i*)(mBuffer8888 + (mWidth * y));
+        __m128i* dst1 = (__m128i*)(mBuffer8888 + (mWidth * (y+1)));
+
+        for (int x = 0; x < mWidth; x += 16) {
+          //{{{  2 rows of 16 pixels
+          // u,v = 0.u0 0.u1 .. 0.u7, duplicated to 0.u0 0.u0 0.u1 0.u1 ..
+          __m128i temp = _mm_cvtepu8_epi16 (_mm_loadl_epi64 ((__m128i*)(srcU + x/2)));
+          __m128i u00 = _mm_sub_epi16 (_mm_unpacklo_epi16 (temp, temp), uvsub);
+          __m128i u01 = _mm_sub_epi16 (_mm_unpackhi_epi16 (temp, temp), uvsub);
+
+          temp = _mm_cvtepu8_epi16 (_mm_loadl_epi64 ((__m128i*)(srcV + x/2)));
+          __m128i v00 = _mm_sub_epi16 (_mm_unpacklo_epi16 (temp, temp), uvsub);
+          __m128i v01 = _mm_sub_epi16 (_mm_unpackhi_epi16 (temp, temp), uvsub);
+
+          __m128i rv00 = _mm_mullo_epi16 (facrv, v00);
+          __m128i rv01 = _mm_mullo_epi16 (facrv, v01);
+          __m128i guv00 = _mm_add_epi16 (_mm_mullo_epi16 (facgu, u00), _mm_mullo_epi16 (facgv, v00));
+          __m128i guv01 = _mm_add_epi16 (_mm_mullo_epi16 (facgu, u01), _mm_mullo_epi16 (facgv, v01));
+          __m128i bu00 = _mm_mullo_epi16 (facbu, u00);
+          __m128i bu01 = _mm_mullo_epi16 (facbu, u01);
+
+          storeSse41 (dst0, _mm_loadu_si128 ((__m128i*)(srcY0 + x)), ysub, facy, alpha,
+                      rv00, rv01, guv00, guv01, bu00, bu01);
+          storeSse41 (dst1, _mm_loadu_si128 ((__m128i*)(srcY1 + x)), ysub, facy, alpha,
+                      rv00, rv01, guv00, guv01, bu00, bu01);
+          dst0 += 4;
+          dst1 += 4;
+          }
+          //}}}
+        }
+
+      _mm_sfence();
+      }
+    //}}}
+    //{{{
+    __attribute__((target("sse4.1")))
+    static inline void storeSse41 (__m128i* dst, __m128i yRow, __m128i ysub, __m128i facy, __m128i alpha,
+                                   __m128i rv00, __m128i rv01, __m128i guv00, __m128i guv01,
+                                   __m128i bu00, __m128i bu01) {
+    // 16 pixels of y plus shared uv terms, packed r,g,b,a bytes
+
+      __m128i y00 = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_cvtepu8_epi16 (yRow), ysub), facy);
+      __m128i y01 = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_unpackhi_epi8 (yRow, _mm_setzero_si128()), ysub), facy);
+
+      __m128i r = _mm_packus_epi16 (_mm_srai_epi16 (_mm_adds_epi16 (y00, rv00), 6),
+                                    _mm_srai_epi16 (_mm_adds_epi16 (y01, rv01), 6));
+      __m128i g = _mm_packus_epi16 (_mm_srai_epi16 (_mm_subs_epi16 (y00, guv00), 6),
+                                    _mm_srai_epi16 (_mm_subs_epi16 (y01, guv01), 6));
+      __m128i b = _mm_packus_epi16 (_mm_srai_epi16 (_mm_adds_epi16 (y00, bu00), 6),
+                                    _mm_srai_epi16 (_mm_adds_epi16 (y01, bu01), 6));
+
+      __m128i rg = _mm_unpacklo_epi8 (r, g);
+      __m128i ba = _mm_unpacklo_epi8 (b, alpha);
+      _mm_stream_si128 (dst++, _mm_unpacklo_epi16 (rg, ba));
+      _mm_stream_si128 (dst++, _mm_unpackhi_epi16 (rg, ba));
+
+      rg = _mm_unpackhi_epi8 (r, g);
+      ba = _mm_unpackhi_epi8 (b, alpha);
+      _mm_stream_si128 (dst++, _mm_unpacklo_epi16 (rg, ba));
+      _mm_stream_si128 (dst, _mm_unpackhi_epi16 (rg, ba));
+      }
+    //}}}
+
+    //{{{
+    __attribute__((target("avx2")))
+    void convertAvx2 (uint8_t** data, int* linesize, int firstRow, int lastRow) {
+    // 16 pixels per 256bit register as 16bit, lane crossing fixed up by permute on store
+
+      __m256i ysub  = _mm256_set1_epi16 (0x0010);
+      __m256i uvsub = _mm256_set1_epi16 (0x0080);
+      __m256i facy  = _mm256_set1_epi16 (0x004a);
+      __m256i facrv = _mm256_set1_epi16 (0x0066);
+      __m256i facgu = _mm256_set1_epi16 (0x0019);
+      __m256i facgv = _mm256_set1_epi16 (0x0034);
+      __m256i facbu = _mm256_set1_epi16 (0x0081);
+
+      for (int y = firstRow; y < lastRow; y += 2) {
+        uint8_t* srcY0 = data[0] + (linesize[0] * y);
+        uint8_t* srcY1 = srcY0 + linesize[0];
+        uint8_t* srcU = data[1] + (linesize[1] * (y/2));
+        uint8_t* srcV = data[2] + (linesize[2] * (y/2));
+        __m256i* dst0 = (__m256i*)(mBuffer8888 + (mWidth * y));
+        __m256i* dst1 = (__m256i*)(mBuffer8888 + (mWidth * (y+1)));
+
+        for (int x = 0; x < mWidth; x += 16) {
+          //{{{  2 rows of 16 pixels
+          // u,v = u0 u0 u1 u1 .. u7 u7 as 16bit
+          __m128i temp = _mm_loadl_epi64 ((__m128i*)(srcU + x/2));
+          __m256i u = _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (_mm_unpacklo_epi8 (temp, temp)), uvsub);
+          temp = _mm_loadl_epi64 ((__m128i*)(srcV + x/2));
+          __m256i v = _mm256_sub_epi16 (_mm256_cvtepu8_epi16 (_mm_unpacklo_epi8 (temp, temp)), uvsub);
+
+          __m256i rv = _mm256_mullo_epi16 (facrv, v);
+          __m256i guv = _mm256_add_epi16 (_mm256_mullo_epi16 (facgu, u), _mm256_mullo_epi16 (facgv, v));
+          __m256i bu = _mm256_mullo_epi16 (facbu, u);
+
+          storeAvx2 (dst0, _mm_loadu_si128 ((__m128i*)(srcY0 + x)), ysub, facy, rv, guv, bu);
+          storeAvx2 (dst1, _mm_loadu_si128 ((__m128i*)(srcY1 + x)), ysub, facy, rv, guv, bu);
+          dst0 += 2;
+          dst1 += 2;
+          }
+          //}}}
+        }
+
+      _mm_sfence();
+      }
+    //}}}
+    //{{{
+    __attribute__((target("avx2")))
+    static inline void storeAvx2 (__m256i* dst, __m128i yRow, __m256i ysub, __m256i facy,
+                                  __m256i rv, __m256i guv, __m256i bu) {
+    // 16 pixels of y plus shared uv terms, clamped, packed r,g,b,a bytes
+
+      __m256i zero = _mm256_setzero_si256();
+      __m256i maxByte = _mm256_set1_epi16 (0x00FF);
+
+      __m256i y16 = _mm256_mullo_epi16 (_mm256_sub_epi16 (_mm256_cvtepu8_epi16 (yRow), ysub), facy);
+      __m256i r = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (_mm256_adds_epi16 (y16, rv), 6), zero), maxByte);
+      __m256i g = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (_mm256_subs_epi16 (y16, guv), 6), zero), maxByte);
+      __m256i b = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (_mm256_adds_epi16 (y16, bu), 6), zero), maxByte);
+
+      // rg,ba 16bit pairs per pixel, unpack interleaves within 128bit lanes
+      __m256i rg = _mm256_or_si256 (r, _mm256_slli_epi16 (g, 8));
+      __m256i ba = _mm256_or_si256 (b, _mm256_set1_epi16 ((short)0xFF00));
+      __m256i lo = _mm256_unpacklo_epi16 (rg, ba);  // pixels 0..3, 8..11
+      __m256i hi = _mm256_unpackhi_epi16 (rg, ba);  // pixels 4..7, 12..15
+
+      _mm256_stream_si256 (dst, _mm256_permute2x128_si256 (lo, hi, 0x20));
+      _mm256_stream_si256 (dst+1, _mm256_permute2x128_si256 (lo, hi, 0x31));
+      }
+    //}}}
+    };
+  //}}}
+#endif
 //{{{
 class cFramePlanarRgbaTable : cVideoFrame {
 public:
@@ -1794,8 +1732,11 @@ public:
 
     for (auto frame : mFramePool)
       delete frame.second;
-
     mFramePool.clear();
+
+    for (auto frame : mFreeFrames)
+      delete frame;
+    mFreeFrames.clear();
     }
   //}}}
 
@@ -1804,24 +1745,72 @@ public:
   virtual int getHeight() { return mHeight; }
   //{{{
   virtual string getInfoString() {
-    return fmt::format ("{}x{} {:5d}:{:4d}", mWidth, mHeight, mDecodeMicroSeconds, mYuv420MicroSeconds);
+    return fmt::format ("{}x{} {:5d}:{:4d} {}", mWidth, mHeight, mDecodeMicroSeconds, mYuv420MicroSeconds,
+                        getYuvConvertString());
+    }
+  //}}}
+  //{{{
+  virtual string getPoolString() {
+  // occupancy decoded:free/allocated of max, decoder waits for a free frame, duplicate pts dropped
+
+    shared_lock<shared_mutex> lock (mSharedMutex);
+    return fmt::format ("pool {}:{}/{} of {} waits:{} {}us max:{}us dup:{}",
+                        mFramePool.size(), mFreeFrames.size(), mNumAllocated, mMaxPoolSize,
+                        mNumWaits, mNumWaits ? mWaitMicroSeconds / mNumWaits : 0, mMaxWaitMicroSeconds,
+                        mNumDuplicates);
     }
   //}}}
   virtual map <int64_t, iVideoFrame*>& getFramePool() { return mFramePool; }
 
+  //{{{
+  virtual void setYuvConvert (bool simd, int bands) {
+  // select yuv420 to rgba conversion, takes effect on next decoded frame
+
+    mYuvConvert.mSimd = simd;
+    mYuvConvert.mBands = max (1, bands);
+    cLog::log (LOGINFO, fmt::format ("videoPool yuv420 convert {}", getYuvConvertString()));
+    }
+  //}}}
+  //{{{
+  virtual void setPlayPts (int64_t pts) {
+  // play position moved, recycle frames it has left behind, wake decoder waiting for one
+
+    if (mPtsDuration <= 0)
+      return;
+
+    bool recycled;
+      { // locked
+      unique_lock<shared_mutex> lock (mSharedMutex);
+      recycled = recycleFrames (pts);
+      }
+
+    if (recycled)
+      mFreeCondition.notify_all();
+    }
+  //}}}
+
   //{{{
   virtual void flush (int64_t pts) {
-  // mark free, !!!! could use proximity to pts to limit !!!!
+  // recycle all decoded frames
 
-    for (auto frame : mFramePool)
-      frame.second->setFree (true, pts);
+      { // locked
+      unique_lock<shared_mutex> lock (mSharedMutex);
+      for (auto frame : mFramePool) {
+        frame.second->setFree (true, pts);
+        mFreeFrames.push_back (frame.second);
+        }
+      mFramePool.clear();
+      }
+
+    mFreeCondition.notify_all();
     }
   //}}}
 
   //{{{
   virtual iVideoFrame* findFrame (int64_t pts) {
+  // readOnly lookup, shared with other readers, only excluded while decoder inserts or recycles
 
-    unique_lock<shared_mutex> lock (mSharedMutex);
+    shared_lock<shared_mutex> lock (mSharedMutex);
 
     if (mPtsDuration > 0) {
       auto it = mFramePool.find (pts / mPtsDuration);
@@ -1844,12 +1833,36 @@ protected:
 
   //{{{
   iVideoFrame* getFreeFrame (bool reuseFromFront, int64_t pts) {
-  // return youngest frame in pool if older than playPts - (halfPoolSize * duration)
+  // return frame from free list, allocate upto mMaxPoolSize, else block until play position recycles one
     (void)reuseFromFront;
 
+    chrono::system_clock::time_point waitTimePoint;
+    bool waited = false;
+
+    unique_lock<shared_mutex> lock (mSharedMutex);
     while (true) {
-      if ((int)mFramePool.size() < mMaxPoolSize) {
-        // create and insert new videoFrame
+      if (!mFreeFrames.empty()) {
+        //{{{  reuse frame from free list
+        iVideoFrame* videoFrame = mFreeFrames.back();
+        mFreeFrames.pop_back();
+        videoFrame->setFree (false, pts);
+
+        if (waited) {
+          int64_t waitMicroSeconds =
+            chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - waitTimePoint).count();
+          mNumWaits++;
+          mWaitMicroSeconds += waitMicroSeconds;
+          mMaxWaitMicroSeconds = max (mMaxWaitMicroSeconds, waitMicroSeconds);
+          }
+
+        return videoFrame;
+        }
+        //}}}
+
+      if (mNumAllocated < mMaxPoolSize) {
+        //{{{  allocate new videoFrame
+        mNumAllocated++;
+
         iVideoFrame* videoFrame;
         #ifdef _WIN32
           if (!mPlanar)
@@ -1860,33 +1873,56 @@ protected:
             #else
               videoFrame = new cFramePlanarRgbaSws();
             #endif
+          #elif defined(INTEL_SSE2)
+            videoFrame = new cFramePlanarRgbaSimd();
           #else
             videoFrame = new cFramePlanarRgbaSws();
           #endif
         return videoFrame;
         }
+        //}}}
 
-      { // start of lock
-      unique_lock<shared_mutex> lock (mSharedMutex);
-      // look at youngest frame in pool
-      auto it = mFramePool.begin();
-      if ((*it).second->isFree() ||
-          ((*it).first < ((mSong->getPlayPts() / mPtsDuration) - (int)mFramePool.size()/2))) {
-        // old enough to be reused, remove from map and reuse videoFrame,
-        iVideoFrame* videoFrame = (*it).second;
-        mFramePool.erase (it);
-        videoFrame->setFree (false, pts);
-        return videoFrame;
+      // song may be played without setPlayPts, recycle by its playPts before waiting
+      if (recycleFrames (mSong->getPlayPts()))
+        continue;
+
+      if (!waited) {
+        waited = true;
+        waitTimePoint = chrono::system_clock::now();
         }
-      } // end of lock
 
-      // one should come along in a frame in while playing
-      // - !!!! should be ptsduration!!!
-      this_thread::sleep_for (20ms);
+      // woken by setPlayPts,flush, timeout covers a paused or unwired play position
+      mFreeCondition.wait_for (lock, kFreeWaitTimeout);
       }
+    }
+  //}}}
+  //{{{
+  void insertFrame (int64_t pts, iVideoFrame* frame) {
+  // duplicate pts, hls refetch or seek back redecode, keeps the frame already found by readers,
+  // - recycles the new one so the pool does not lose it
+
+      { // locked
+      unique_lock<shared_mutex> lock (mSharedMutex);
+      if (mFramePool.insert (map<int64_t, iVideoFrame*>::value_type (pts / mPtsDuration, frame)).second)
+        return;
 
-    // never gets here
-    return 0;
+      frame->setFree (true, pts);
+      mFreeFrames.push_back (frame);
+      mNumDuplicates++;
+      }
+
+    mFreeCondition.notify_all();
+    }
+  //}}}
+  //{{{
+  string getYuvConvertString() {
+
+    #if defined(INTEL_SSE2) && !defined(_WIN32)
+      if (mYuvConvert.mSimd)
+        return fmt::format ("{}x{}", cFramePlanarRgbaSimd::getKernelName(), mYuvConvert.mBands.load());
+    #endif
+
+    return "sws";
     }
   //}}}
 
@@ -1898,16 +1934,51 @@ protected:
 
   int64_t mDecodeMicroSeconds = 0;
   int64_t mYuv420MicroSeconds = 0;
+  cYuvConvert mYuvConvert;
 
   // map of videoFrames, key is pts/mPtsDuration, allow a simple find by pts throughout the duration
   map <int64_t, iVideoFrame*> mFramePool;
 
 private:
+  static constexpr chrono::milliseconds kFreeWaitTimeout = 100ms;
+
+  //{{{
+  bool recycleFrames (int64_t playPts) {
+  // move frames older than playPts - (halfPoolSize * duration) to free list, locked by caller
+
+    int64_t recycleFrameNum = (playPts / mPtsDuration) - (mMaxPoolSize / 2);
+
+    bool recycled = false;
+    auto it = mFramePool.begin();
+    while ((it != mFramePool.end()) && ((*it).first < recycleFrameNum)) {
+      (*it).second->setFree (true, playPts);
+      mFreeFrames.push_back ((*it).second);
+      it = mFramePool.erase (it);
+      recycled = true;
+      }
+
+    return recycled;
+    }
+  //}}}
+
   #ifdef _WIN32
     const bool mPlanar;
   #endif
   const int mMaxPoolSize;
   cSong* mSong;
+
+  // free list, decoder blocks on mFreeCondition when empty and mMaxPoolSize allocated
+  vector <iVideoFrame*> mFreeFrames;
+  condition_variable_any mFreeCondition;
+  int mNumAllocated = 0;
+
+  // wait stats
+  int64_t mNumWaits = 0;
+  int64_t mWaitMicroSeconds = 0;
+  int64_t mMaxWaitMicroSeconds = 0;
+
+  // decoded frames dropped for an already pooled pts
+  int64_t mNumDuplicates = 0;
   };
 //}}}
 //{{{
@@ -1918,110 +1989,229 @@ public:
 
     mAvParser = av_parser_init (AV_CODEC_ID_H264);
     mAvCodec = (AVCodec*)avcodec_find_decoder (AV_CODEC_ID_H264);
-    mAvContext = avcodec_alloc_context3 (mAvCodec);
-    avcodec_open2 (mAvContext, mAvCodec, NULL);
+    openDecoder();
+
+    // reused by every decodeFrame
+    mAvPacket = av_packet_alloc();
+    mAvFrame = av_frame_alloc();
     }
   //}}}
   //{{{
   virtual ~cFFmpegVideoPool() {
 
+    av_frame_free (&mAvFrame);
+    av_packet_free (&mAvPacket);
+
     if (mAvContext)
-      avcodec_close (mAvContext);
+      avcodec_free_context (&mAvContext);
     if (mAvParser)
       av_parser_close (mAvParser);
 
-    sws_freeContext (mSwsContext);
+    sws_freeContext (mYuvConvert.mSwsContext);
+    }
+  //}}}
+
+  //{{{
+  virtual string getInfoString() {
+  // decode threading, throughput of this service's video, then base info
+
+    return fmt::format ("{} {:4.1f}fps {}frames {}", getDecodeThreadsString(), mFramesPerSecond.load(),
+                        mNumFrames.load(), cVideoPool::getInfoString());
+    }
+  //}}}
+  //{{{
+  virtual void setDecodeThreads (eDecodeThreads decodeThreads, int numThreads) {
+  // reopen decoder with new threading, on decode thread before next decodeFrame
+
+    mDecodeThreads = decodeThreads;
+    mNumThreads = max (0, numThreads);
+    mReopenDecoder = true;
+    }
+  //}}}
+
+  //{{{
+  virtual void flush (int64_t pts) {
+  // recycle decoded frames, drop frames held in decoder, on decode thread before next decodeFrame
+
+    cVideoPool::flush (pts);
+    mFlushDecoder = true;
     }
   //}}}
 
   //{{{
   virtual void decodeFrame (bool reuseFromFront, uint8_t* pes, unsigned int pesSize, int64_t pts, int64_t dts) {
+  // ffmpeg doesn't maintain correct avFrame.pts, guess pts in presentation order, correct it on I frames
+  // - I frame packets carry their dts as pts through decoder, which survives threaded decoder delay
+  // - other packets carry no pts, their frames continue the guess
 
-    chrono::system_clock::time_point timePoint = chrono::system_clock::now();
+    if (mReopenDecoder.exchange (false))
+      openDecoder();
 
-    // ffmpeg doesn't maintain correct avFrame.pts, decode frames in presentation order and pts correct on I frames
-    char frameType = getH264FrameType (pes, pesSize);
-    if (frameType == 'I') {
-      if ((mGuessPts >= 0) && (mGuessPts != dts))
-        //{{{  debug
-        cLog::log (LOGERROR, fmt::format ("lost:{} to:{} type:{} {}",
-          utils::getPtsFramesString (mGuessPts, 1800), utils::getPtsFramesString (dts, 1800),frameType,pesSize));
-        //}}}
-      mGuessPts = dts;
-      mSeenIFrame = true;
-      }
-    if (!mSeenIFrame) {
-      //{{{  debug
-      cLog::log (LOGINFO, fmt::format("waiting for Iframe {} to:{} type:{} size:{}",
-        utils::getPtsFramesString (mGuessPts, 1800), utils::getPtsFramesString (dts, 1800),frameType,pesSize));
-      //}}}
-      return;
+    if (mFlushDecoder.exchange (false)) {
+      avcodec_flush_buffers (mAvContext);
+      mSeenIFrame = false;
       }
 
-    cLog::log (LOGINFO1, fmt::format("ffmpeg decode guessPts:{}.{} pts:{}.{} dts:{}.{} - {} size:{}",
-                         mGuessPts/1800, mGuessPts%1800, pts/1800, pts%1800, dts/1800, dts%1800,
-                         frameType, pesSize));
-
-    AVPacket* avPacket = av_packet_alloc();
-    AVFrame* avFrame = av_frame_alloc();
+    chrono::system_clock::time_point timePoint = chrono::system_clock::now();
 
     auto pesPtr = pes;
     auto pesLeft = pesSize;
     while (pesLeft) {
-      auto bytesUsed = av_parser_parse2 (mAvParser, mAvContext, &avPacket->data, &avPacket->size,
-                                         pesPtr, (int)pesLeft, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+      auto bytesUsed = av_parser_parse2 (mAvParser, mAvContext, &mAvPacket->data, &mAvPacket->size,
+                                         pesPtr, (int)pesLeft, pts, dts, 0);
       pesPtr += bytesUsed;
       pesLeft -= bytesUsed;
-      if (avPacket->size) {
-        auto ret = avcodec_send_packet (mAvContext, avPacket);
+      if (mAvPacket->size) {
+        // parser reports type of the packet it outputs, with its pts,dts
+        bool iFrame = (mAvParser->pict_type == AV_PICTURE_TYPE_I) || (mAvParser->key_frame == 1);
+        if (!mSeenIFrame && !iFrame) {
+          //{{{  debug
+          cLog::log (LOGINFO, fmt::format ("waiting for Iframe to:{} type:{} size:{}",
+            utils::getPtsFramesString (mAvParser->dts, 1800),
+            av_get_picture_type_char ((AVPictureType)mAvParser->pict_type), mAvPacket->size));
+          //}}}
+          continue;
+          }
+        mSeenIFrame = true;
+        mAvPacket->pts = iFrame ? mAvParser->dts : AV_NOPTS_VALUE;
+
+        auto ret = avcodec_send_packet (mAvContext, mAvPacket);
         while (ret >= 0) {
-          ret = avcodec_receive_frame (mAvContext, avFrame);
+          ret = avcodec_receive_frame (mAvContext, mAvFrame);
           if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF || ret < 0)
             break;
           mDecodeMicroSeconds = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - timePoint).count();
 
           // extract frame info from decode
-          mWidth = avFrame->width;
-          mHeight = avFrame->height;
+          mWidth = mAvFrame->width;
+          mHeight = mAvFrame->height;
           mPtsDuration = (kPtsPerSecond * mAvContext->framerate.den) / mAvContext->framerate.num;
 
-          if (mSeenIFrame) {
-            // blocks on waiting for freeFrame most of the time
-            auto frame = getFreeFrame (reuseFromFront, mGuessPts);
-
-            frame->set (mGuessPts, pesSize, mWidth, mHeight, frameType);
-            timePoint = chrono::system_clock::now();
-            if (!mSwsContext)
-              mSwsContext = sws_getContext (mWidth, mHeight, AV_PIX_FMT_YUV420P,
-                                            mWidth, mHeight, AV_PIX_FMT_RGBA,
-                                            SWS_BILINEAR, NULL, NULL, NULL);
-            frame->setYuv420 (mSwsContext, avFrame->data, avFrame->linesize);
-            mYuv420MicroSeconds = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - timePoint).count();
-
-              { // locked
-              unique_lock<shared_mutex> lock (mSharedMutex);
-              mFramePool.insert (map<int64_t, iVideoFrame*>::value_type (mGuessPts / mPtsDuration, frame));
-              }
+          char frameType = av_get_picture_type_char (mAvFrame->pict_type);
+          if (mAvFrame->pts != AV_NOPTS_VALUE) {
+            if ((mGuessPts >= 0) && (mGuessPts != mAvFrame->pts))
+              //{{{  debug
+              cLog::log (LOGERROR, fmt::format ("lost:{} to:{} type:{}",
+                utils::getPtsFramesString (mGuessPts, 1800), utils::getPtsFramesString (mAvFrame->pts, 1800),
+                frameType));
+              //}}}
+            mGuessPts = mAvFrame->pts;
             }
+
+          cLog::log (LOGINFO1, fmt::format("ffmpeg decoded guessPts:{}.{} - {} size:{}",
+                               mGuessPts/1800, mGuessPts%1800, frameType, pesSize));
+
+          // blocks on waiting for freeFrame most of the time
+          auto frame = getFreeFrame (reuseFromFront, mGuessPts);
+
+          frame->set (mGuessPts, pesSize, mWidth, mHeight, frameType);
+          timePoint = chrono::system_clock::now();
+          // reuses context until size changes
+          mYuvConvert.mSwsContext = sws_getCachedContext (mYuvConvert.mSwsContext,
+                                                          mWidth, mHeight, AV_PIX_FMT_YUV420P,
+                                                          mWidth, mHeight, AV_PIX_FMT_RGBA,
+                                                          SWS_BILINEAR, NULL, NULL, NULL);
+          frame->setYuv420 (&mYuvConvert, mAvFrame->data, mAvFrame->linesize);
+          mYuv420MicroSeconds = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - timePoint).count();
+
+          insertFrame (mGuessPts, frame);
           mGuessPts += mPtsDuration;
+
+          updateThroughput();
+          timePoint = chrono::system_clock::now();
           }
         }
       }
-
-    av_frame_free (&avFrame);
-    av_packet_free (&avPacket);
     }
   //}}}
 
 private:
+  //{{{
+  void openDecoder() {
+  // open, or reopen, h264 decoder with selected threading
+
+    if (mAvContext)
+      avcodec_free_context (&mAvContext);
+
+    mAvContext = avcodec_alloc_context3 (mAvCodec);
+    switch (mDecodeThreads) {
+      case eDecodeThreads::eSingle:
+        mAvContext->thread_count = 1;
+        break;
+      case eDecodeThreads::eFrame:
+        mAvContext->thread_count = mNumThreads;
+        mAvContext->thread_type = FF_THREAD_FRAME;
+        break;
+      case eDecodeThreads::eSlice:
+        mAvContext->thread_count = mNumThreads;
+        mAvContext->thread_type = FF_THREAD_SLICE;
+        break;
+      case eDecodeThreads::eFrameSlice:
+        mAvContext->thread_count = mNumThreads;
+        mAvContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        break;
+      }
+    avcodec_open2 (mAvContext, mAvCodec, NULL);
+    mOpenNumThreads = mAvContext->thread_count;
+
+    // decoder starts again from next I frame
+    mSeenIFrame = false;
+
+    cLog::log (LOGINFO, fmt::format ("ffmpeg h264 decoder {}", getDecodeThreadsString()));
+    }
+  //}}}
+  //{{{
+  string getDecodeThreadsString() {
+
+    string threads = fmt::format ("{}", mOpenNumThreads.load());
+    switch (mDecodeThreads) {
+      case eDecodeThreads::eSingle:     return "single";
+      case eDecodeThreads::eFrame:      return "frame:" + threads;
+      case eDecodeThreads::eSlice:      return "slice:" + threads;
+      case eDecodeThreads::eFrameSlice: return "frameSlice:" + threads;
+      }
+
+    return "";
+    }
+  //}}}
+  //{{{
+  void updateThroughput() {
+  // count decoded frames, update frames per second once a second
+
+    mNumFrames++;
+
+    auto now = chrono::system_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(now - mThroughputTimePoint).count();
+    if (elapsed >= 1000000) {
+      mFramesPerSecond = ((mNumFrames - mThroughputFrames) * 1000000.f) / elapsed;
+      mThroughputFrames = mNumFrames;
+      mThroughputTimePoint = now;
+      }
+    }
+  //}}}
+
   // vars
   AVCodecParserContext* mAvParser = nullptr;
   AVCodec* mAvCodec = nullptr;
   AVCodecContext* mAvContext = nullptr;
-  SwsContext* mSwsContext = nullptr;
+  AVPacket* mAvPacket = nullptr;
+  AVFrame* mAvFrame = nullptr;
+
+  // threading, default frame and slice threads, 0 numThreads lets ffmpeg choose
+  atomic<eDecodeThreads> mDecodeThreads = eDecodeThreads::eFrameSlice;
+  atomic<int> mNumThreads = 0;
+  atomic<bool> mReopenDecoder = false;
+  atomic<bool> mFlushDecoder = false;
+  atomic<int> mOpenNumThreads = 0;
 
   int64_t mGuessPts = -1;
   bool mSeenIFrame= false;
+
+  // throughput
+  atomic<int64_t> mNumFrames = 0;
+  atomic<float> mFramesPerSecond = 0.f;
+  int64_t mThroughputFrames = 0;
+  chrono::system_clock::time_point mThroughputTimePoint = chrono::system_clock::now();
   };
 //}}}
 
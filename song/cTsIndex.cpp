@@ -0,0 +1,377 @@
+// cTsIndex.cpp - sparse pts to byte offset index of a transport stream, persisted as a sidecar file
+// - built as the loader reads, extended by a fast pes header scan when seeking past it
+// - sidecar saved periodically and on exit, reused while the ts file is unchanged or has only grown
+// - assumes indexed pid pts increase through the file, no 33bit wrap handling
+// - sidecar is native endian, it lives next to the ts file it indexes
+//{{{  includes
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "cTsIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "../common/cDvbUtils.h"
+#include "../common/cLog.h"
+#include "fmt/format.h"
+
+using namespace std;
+//}}}
+
+//{{{
+int64_t cTsIndex::getPesPts (const uint8_t* ts) {
+// return pts of pes starting in ts packet, -1 if none
+
+  bool payloadStart = ts[1] & 0x40;
+  bool hasPayload = ts[3] & 0x10;
+  if (!payloadStart || !hasPayload)
+    return -1;
+
+  int headerSize = (ts[3] & 0x20) ? 5 + ts[4] : 4;
+  if (headerSize + 14 > 188)
+    return -1;
+
+  const uint8_t* pes = ts + headerSize;
+  if (pes[0] || pes[1] || (pes[2] != 0x01))
+    return -1;
+
+  return (pes[7] & 0x80) ? cDvbUtils::getPts (pes + 9) : -1;
+  }
+//}}}
+//{{{
+bool cTsIndex::isKeyFrame (const uint8_t* ts) {
+// return true if h264 pes starting in ts packet has sps or idr nal in its first packet
+
+  bool payloadStart = ts[1] & 0x40;
+  bool hasPayload = ts[3] & 0x10;
+  if (!payloadStart || !hasPayload)
+    return false;
+
+  int headerSize = (ts[3] & 0x20) ? 5 + ts[4] : 4;
+  if (headerSize + 9 > 188)
+    return false;
+
+  const uint8_t* pes = ts + headerSize;
+  if (pes[0] || pes[1] || (pes[2] != 0x01))
+    return false;
+
+  const uint8_t* es = pes + 9 + pes[8];
+  const uint8_t* esEnd = ts + 188;
+  for (; es + 3 < esEnd; es++)
+    if (!es[0] && !es[1] && (es[2] == 0x01)) {
+      int nalType = es[3] & 0x1F;
+      if ((nalType == 5) || (nalType == 7))
+        return true;
+      }
+
+  return false;
+  }
+//}}}
+
+//{{{
+void cTsIndex::clear() {
+
+  mAudioPid = -1;
+  mVideoPid = -1;
+  mFirstPts = -1;
+  mLastPts = -1;
+
+  mPrograms.clear();
+  mStreams.clear();
+  mEntries.clear();
+  mKeyFrames.clear();
+
+  mIndexedOffset = 0;
+  mSavedOffset = 0;
+  }
+//}}}
+//{{{
+void cTsIndex::setPids (int audioPid, int videoPid) {
+// set indexed pids, index restarts if they change, service,pid table kept
+
+  if ((audioPid != mAudioPid) || (videoPid != mVideoPid)) {
+    mAudioPid = audioPid;
+    mVideoPid = videoPid;
+    mFirstPts = -1;
+    mLastPts = -1;
+
+    mEntries.clear();
+    mKeyFrames.clear();
+
+    mIndexedOffset = 0;
+    mSavedOffset = 0;
+    }
+  }
+//}}}
+
+//{{{
+void cTsIndex::addProgram (int sid, int pmtPid) {
+
+  for (auto& program : mPrograms)
+    if ((program.mSid == sid) && (program.mPmtPid == pmtPid))
+      return;
+
+  mPrograms.push_back ({sid, pmtPid});
+  }
+//}}}
+//{{{
+void cTsIndex::addStream (int sid, int pid, int streamType) {
+
+  for (auto& stream : mStreams)
+    if ((stream.mSid == sid) && (stream.mPid == pid))
+      return;
+
+  mStreams.push_back ({sid, pid, streamType});
+  }
+//}}}
+
+//{{{
+void cTsIndex::add (const uint8_t* ts, int64_t offset) {
+// add audio entry kPtsInterval after last entry, add video keyFrames
+
+  if (offset < mIndexedOffset)
+    return;
+  mIndexedOffset = offset + 188;
+
+  int pid = getPid (ts);
+  if (pid == mAudioPid) {
+    int64_t pts = getPesPts (ts);
+    if (pts < 0)
+      return;
+
+    if (mFirstPts < 0)
+      mFirstPts = pts;
+    mLastPts = max (mLastPts, pts);
+
+    if (mEntries.empty() || (pts >= mEntries.back().mPts + kPtsInterval))
+      mEntries.push_back ({pts, offset});
+    }
+
+  else if ((pid == mVideoPid) && isKeyFrame (ts)) {
+    int64_t pts = getPesPts (ts);
+    if ((pts >= 0) && (mKeyFrames.empty() || (pts > mKeyFrames.back().mPts)))
+      mKeyFrames.push_back ({pts, offset});
+    }
+  }
+//}}}
+//{{{
+int64_t cTsIndex::find (int64_t pts) const {
+// return offset of last entry at or before pts, 0 if before first entry
+
+  auto it = upper_bound (mEntries.begin(), mEntries.end(), pts,
+                         [](int64_t value, const cEntry& entry) noexcept { return value < entry.mPts; });
+
+  return (it == mEntries.begin()) ? 0 : prev (it)->mOffset;
+  }
+//}}}
+//{{{
+int64_t cTsIndex::seek (const uint8_t* data, int64_t size, int64_t pts) {
+// return offset to start loading from to play pts
+// - extend index by scanning pes headers when pts is beyond it, binary search, then short local scan
+// - back up to preceding video keyFrame, if near enough, so video decodes from it
+
+  if (mAudioPid < 0)
+    return -1;
+
+  int64_t offset = mIndexedOffset;
+  while ((offset + 188 <= size) && (mLastPts < pts + kPtsInterval)) {
+    if (data[offset] != 0x47) {
+      // lost sync, hunt forward
+      offset++;
+      continue;
+      }
+
+    add (data + offset, offset);
+    offset += 188;
+    }
+
+  offset = localScan (data, size, find (pts), pts);
+
+  int64_t keyFrameOffset = findKeyFrame (pts);
+  return ((keyFrameOffset >= 0) && (keyFrameOffset < offset)) ? keyFrameOffset : offset;
+  }
+//}}}
+
+//{{{
+bool cTsIndex::load (const string& filename, const uint8_t* data, int64_t size) {
+// load sidecar if it matches ts file, or ts file has only grown since, return true if loaded
+
+  FILE* file = fopen (getSidecarName (filename).c_str(), "rb");
+  if (!file)
+    return false;
+
+  cSidecarHeader header;
+  bool ok = (fread (&header, sizeof(header), 1, file) == 1) &&
+            !memcmp (header.mMagic, "TSIX", 4) && (header.mVersion == kSidecarVersion) &&
+            (header.mNumPrograms < kMaxCount) && (header.mNumStreams < kMaxCount) &&
+            (header.mNumEntries < kMaxCount) && (header.mNumKeyFrames < kMaxCount);
+
+  int64_t fileSize;
+  int64_t fileTime;
+  ok = ok && getFileInfo (filename, fileSize, fileTime);
+
+  bool unchanged = ok && (header.mFileSize == fileSize) && (header.mFileTime == fileTime);
+  bool grown = ok && (fileSize > header.mFileSize);
+  if (!unchanged && !grown) {
+    fclose (file);
+    cLog::log (LOGINFO, fmt::format ("cTsIndex sidecar stale or invalid {}", getSidecarName (filename)));
+    return false;
+    }
+
+  vector <cProgram> programs (header.mNumPrograms);
+  vector <cStream> streams (header.mNumStreams);
+  vector <cEntry> entries (header.mNumEntries);
+  vector <cEntry> keyFrames (header.mNumKeyFrames);
+  ok = (fread (programs.data(), sizeof(cProgram), programs.size(), file) == programs.size()) &&
+       (fread (streams.data(), sizeof(cStream), streams.size(), file) == streams.size()) &&
+       (fread (entries.data(), sizeof(cEntry), entries.size(), file) == entries.size()) &&
+       (fread (keyFrames.data(), sizeof(cEntry), keyFrames.size(), file) == keyFrames.size());
+  fclose (file);
+
+  if (ok && grown && !entries.empty()) {
+    // grown file, check last entry still points at same pes
+    const cEntry& entry = entries.back();
+    ok = (entry.mOffset + 188 <= size) &&
+         (data[entry.mOffset] == 0x47) && (getPesPts (data + entry.mOffset) == entry.mPts);
+    }
+
+  if (!ok) {
+    cLog::log (LOGERROR, fmt::format ("cTsIndex sidecar failed to load {}", getSidecarName (filename)));
+    return false;
+    }
+
+  mAudioPid = header.mAudioPid;
+  mVideoPid = header.mVideoPid;
+  mFirstPts = header.mFirstPts;
+  mLastPts = header.mLastPts;
+
+  mPrograms = move (programs);
+  mStreams = move (streams);
+  mEntries = move (entries);
+  mKeyFrames = move (keyFrames);
+
+  mIndexedOffset = min (header.mIndexedOffset, size);
+  mSavedOffset = mIndexedOffset;
+
+  cLog::log (LOGINFO, fmt::format ("cTsIndex loaded {} {} entries {} keyFrames indexed {} of {}{}",
+                                   getSidecarName (filename), mEntries.size(), mKeyFrames.size(),
+                                   mIndexedOffset, size, grown ? " grown" : ""));
+  return true;
+  }
+//}}}
+//{{{
+bool cTsIndex::save (const string& filename) {
+// write sidecar to temp, rename over old
+
+  mSavedOffset = mIndexedOffset;
+
+  cSidecarHeader header = {};
+  memcpy (header.mMagic, "TSIX", 4);
+  header.mVersion = kSidecarVersion;
+  if (!getFileInfo (filename, header.mFileSize, header.mFileTime))
+    return false;
+
+  header.mIndexedOffset = mIndexedOffset;
+  header.mAudioPid = mAudioPid;
+  header.mVideoPid = mVideoPid;
+  header.mFirstPts = mFirstPts;
+  header.mLastPts = mLastPts;
+
+  header.mNumPrograms = (uint32_t)mPrograms.size();
+  header.mNumStreams = (uint32_t)mStreams.size();
+  header.mNumEntries = (uint32_t)mEntries.size();
+  header.mNumKeyFrames = (uint32_t)mKeyFrames.size();
+
+  string sidecarName = getSidecarName (filename);
+  string tempName = sidecarName + ".tmp";
+
+  FILE* file = fopen (tempName.c_str(), "wb");
+  if (!file) {
+    cLog::log (LOGERROR, fmt::format ("cTsIndex failed to create {}", tempName));
+    return false;
+    }
+
+  bool ok = (fwrite (&header, sizeof(header), 1, file) == 1) &&
+            (fwrite (mPrograms.data(), sizeof(cProgram), mPrograms.size(), file) == mPrograms.size()) &&
+            (fwrite (mStreams.data(), sizeof(cStream), mStreams.size(), file) == mStreams.size()) &&
+            (fwrite (mEntries.data(), sizeof(cEntry), mEntries.size(), file) == mEntries.size()) &&
+            (fwrite (mKeyFrames.data(), sizeof(cEntry), mKeyFrames.size(), file) == mKeyFrames.size());
+  ok = (fclose (file) == 0) && ok;
+
+  #ifdef _WIN32
+    remove (sidecarName.c_str());
+  #endif
+  if (!ok || rename (tempName.c_str(), sidecarName.c_str())) {
+    cLog::log (LOGERROR, fmt::format ("cTsIndex failed to write {}", sidecarName));
+    remove (tempName.c_str());
+    return false;
+    }
+
+  cLog::log (LOGINFO1, fmt::format ("cTsIndex saved {} {} entries {} keyFrames indexed {}",
+                                    sidecarName, mEntries.size(), mKeyFrames.size(), mIndexedOffset));
+  return true;
+  }
+//}}}
+
+// private
+//{{{
+bool cTsIndex::getFileInfo (const string& filename, int64_t& fileSize, int64_t& fileTime) {
+
+  #ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64 (filename.c_str(), &st) == -1)
+      return false;
+  #else
+    struct stat st;
+    if (stat (filename.c_str(), &st) == -1)
+      return false;
+  #endif
+
+  fileSize = st.st_size;
+  fileTime = st.st_mtime;
+  return true;
+  }
+//}}}
+//{{{
+int64_t cTsIndex::findKeyFrame (int64_t pts) const {
+// return offset of last keyFrame at or before pts, -1 if none within kMaxKeyFrameDistance
+
+  auto it = upper_bound (mKeyFrames.begin(), mKeyFrames.end(), pts,
+                         [](int64_t value, const cEntry& entry) noexcept { return value < entry.mPts; });
+  if (it == mKeyFrames.begin())
+    return -1;
+
+  --it;
+  return (pts - it->mPts <= kMaxKeyFrameDistance) ? it->mOffset : -1;
+  }
+//}}}
+//{{{
+int64_t cTsIndex::localScan (const uint8_t* data, int64_t size, int64_t offset, int64_t pts) {
+// scan forward from indexed offset to last audio pes start at or before pts
+
+  int64_t foundOffset = offset;
+
+  int64_t lastOffset = min (size, offset + kMaxLocalScan);
+  while (offset + 188 <= lastOffset) {
+    if (data[offset] != 0x47) {
+      offset++;
+      continue;
+      }
+
+    if (getPid (data + offset) == mAudioPid) {
+      int64_t pesPts = getPesPts (data + offset);
+      if (pesPts > pts)
+        break;
+      if (pesPts >= 0)
+        foundOffset = offset;
+      }
+
+    offset += 188;
+    }
+
+  return foundOffset;
+  }
+//}}}
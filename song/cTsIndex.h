@@ -0,0 +1,118 @@
+// cTsIndex.h - sparse pts to byte offset index of a transport stream, persisted as a sidecar file
+#pragma once
+//{{{  includes
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+//}}}
+
+class cTsIndex {
+public:
+  // one audio entry per kPtsInterval, video keyFrames within kMaxKeyFrameDistance used to start a seek
+  static constexpr int64_t kPtsInterval = 90000 / 2;
+  static constexpr int64_t kMaxKeyFrameDistance = 90000 * 4;
+  static constexpr int64_t kMaxLocalScan = 4 * 1024 * 1024;
+
+  //{{{
+  class cProgram {
+  public:
+    int32_t mSid;
+    int32_t mPmtPid;
+    };
+  //}}}
+  //{{{
+  class cStream {
+  public:
+    int32_t mSid;
+    int32_t mPid;
+    int32_t mStreamType;
+    };
+  //}}}
+
+  static int getPid (const uint8_t* ts) { return ((ts[1] & 0x1F) << 8) | ts[2]; }
+  static int64_t getPesPts (const uint8_t* ts);
+  static bool isKeyFrame (const uint8_t* ts);
+
+  void clear();
+  void setPids (int audioPid, int videoPid);
+
+  // gets
+  int getAudioPid() const { return mAudioPid; }
+  int getVideoPid() const { return mVideoPid; }
+  int64_t getFirstPts() const { return mFirstPts; }
+  int64_t getLastPts() const { return mLastPts; }
+  int64_t getIndexedOffset() const { return mIndexedOffset; }
+  size_t getNumEntries() const { return mEntries.size(); }
+  size_t getNumKeyFrames() const { return mKeyFrames.size(); }
+  const std::vector <cProgram>& getPrograms() const { return mPrograms; }
+  const std::vector <cStream>& getStreams() const { return mStreams; }
+
+  // service,pid table
+  void addProgram (int sid, int pmtPid);
+  void addStream (int sid, int pid, int streamType);
+
+  // index
+  void add (const uint8_t* ts, int64_t offset);
+  int64_t find (int64_t pts) const;
+  int64_t seek (const uint8_t* data, int64_t size, int64_t pts);
+
+  // sidecar
+  static std::string getSidecarName (const std::string& filename) { return filename + ".idx"; }
+  bool load (const std::string& filename, const uint8_t* data, int64_t size);
+  bool save (const std::string& filename);
+  bool isSaveDue() const { return mIndexedOffset >= mSavedOffset + kSaveBytes; }
+
+private:
+  static constexpr uint32_t kSidecarVersion = 1;
+  static constexpr int64_t kSaveBytes = 64 * 1024 * 1024;
+  static constexpr uint32_t kMaxCount = 1 << 24;
+
+  //{{{
+  class cEntry {
+  public:
+    int64_t mPts;
+    int64_t mOffset;
+    };
+  //}}}
+  //{{{
+  class cSidecarHeader {
+  public:
+    char mMagic[4];
+    uint32_t mVersion;
+
+    // ts file this was indexed from
+    int64_t mFileSize;
+    int64_t mFileTime;
+
+    int64_t mIndexedOffset;
+    int32_t mAudioPid;
+    int32_t mVideoPid;
+    int64_t mFirstPts;
+    int64_t mLastPts;
+
+    uint32_t mNumPrograms;
+    uint32_t mNumStreams;
+    uint32_t mNumEntries;
+    uint32_t mNumKeyFrames;
+    };
+  //}}}
+
+  static bool getFileInfo (const std::string& filename, int64_t& fileSize, int64_t& fileTime);
+
+  int64_t findKeyFrame (int64_t pts) const;
+  int64_t localScan (const uint8_t* data, int64_t size, int64_t offset, int64_t pts);
+
+  int mAudioPid = -1;
+  int mVideoPid = -1;
+  int64_t mFirstPts = -1;
+  int64_t mLastPts = -1;
+
+  std::vector <cProgram> mPrograms;
+  std::vector <cStream> mStreams;
+  std::vector <cEntry> mEntries;
+  std::vector <cEntry> mKeyFrames;
+
+  int64_t mIndexedOffset = 0;
+  int64_t mSavedOffset = 0;
+  };
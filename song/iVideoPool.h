@@ -6,6 +6,9 @@
 #include <map>
 class cSong;
 
+// h264 decoder threading
+enum class eDecodeThreads { eSingle, eFrame, eSlice, eFrameSlice };
+
 // iVideoFrame
 class iVideoFrame {
 public:
@@ -35,8 +38,14 @@ public:
   virtual int getWidth() = 0;
   virtual int getHeight() = 0;
   virtual std::string getInfoString() = 0;
+  virtual std::string getPoolString() = 0;
   virtual std::map <int64_t,iVideoFrame*>& getFramePool() = 0;
 
+  // sets
+  virtual void setYuvConvert (bool simd, int bands) = 0;
+  virtual void setPlayPts (int64_t pts) = 0;
+  virtual void setDecodeThreads (eDecodeThreads decodeThreads, int numThreads) = 0;
+
   //
   virtual void flush (int64_t pts) = 0;
 
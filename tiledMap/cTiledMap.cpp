@@ -37,28 +37,40 @@ bool cTileSet::getLoaded (const string& quadKey) {
   }
 //}}}
 //{{{
-cTexture cTileSet::getTexture (const string& quadKey) {
+cTexture cTileSet::getTexture (const string& quadKey, uint64_t useCount) {
+// get texture, mark tile used for lru
 
   auto it = mTileMap.find (quadKey);
-  return (it == mTileMap.end()) ? cTexture() : it->second.mTexture;
+  if (it == mTileMap.end())
+    return cTexture();
+
+  it->second.mLastUsed = useCount;
+  return it->second.mTexture;
   }
 //}}}
 
 //{{{
-void cTileSet::addTile (const string& quadKey, cTexture texture, float scaledX, float scaledY) {
+int64_t cTileSet::addTile (const string& quadKey, cTexture texture, float scaledX, float scaledY, uint64_t useCount) {
+// return resident bytes added
 
   auto it = mTileMap.find (quadKey);
-  if (it == mTileMap.end())
+  if (it == mTileMap.end()) {
     // insert a new tile with texture
-    mTileMap.insert (tbb::concurrent_unordered_map <string, cTile>::value_type (quadKey, cTile(texture, scaledX, scaledY)));
+    auto result = mTileMap.insert (tbb::concurrent_unordered_map <string, cTile>::value_type (
+                                     quadKey, cTile(texture, scaledX, scaledY, useCount)));
+    return result.second ? result.first->second.getBytes() : 0;
+    }
   else {
-    if (it->second.mTexture.empty())
+    if (it->second.mTexture.empty()) {
       // add texture to existing tile with empty texture
-      it->second.set (texture, scaledX, scaledY);
+      it->second.set (texture, scaledX, scaledY, useCount);
+      return it->second.getBytes();
+      }
     else {
       // !!! not sure how this happens, release the texture resources !!!
       //cLog::log (LOGERROR, fmt::format ("{} cTileSet::addTile already had texture", quadKey));
       texture.release();
+      return 0;
       }
     }
   }
@@ -70,11 +82,15 @@ void cTileSet::addEmptyTile (const string& quadKey) {
 //}}}
 
 //{{{
-void cTileSet::releaseTextures() {
-// release all textures
+int64_t cTileSet::releaseTextures() {
+// release all textures, return bytes released
 
+  int64_t bytes = 0;
   for (auto& tile : mTileMap)
-    tile.second.mTexture.release();
+    if (!tile.second.mTexture.empty())
+      bytes += tile.second.release();
+
+  return bytes;
   }
 //}}}
 //{{{
@@ -102,7 +118,7 @@ cTiledMapLayer::cTiledMapLayer (const cLayerSpec& layerSpec) : mLayerSpec(layerS
 //}}}
 
 //{{{
-void cTiledMapLayer::addTile (const string& quadKey, cRange& tileRange, cTexture texture) {
+int64_t cTiledMapLayer::addTile (const string& quadKey, cRange& tileRange, cTexture texture, uint64_t useCount) {
 
   uint32_t xTile;
   uint32_t yTile;
@@ -113,7 +129,7 @@ void cTiledMapLayer::addTile (const string& quadKey, cRange& tileRange, cTexture
   float scaledY = yTile / tileSet->getScale();
   tileRange.update (scaledX, scaledY);
 
-  tileSet->addTile (quadKey, texture, scaledX, scaledY);
+  return tileSet->addTile (quadKey, texture, scaledX, scaledY, useCount);
   }
 //}}}
 //{{{
@@ -250,7 +266,9 @@ cTexture cTiledMap::getTexture (uint32_t zoom, int tileX, int tileY) {
 
   string quadKey = zoomTileXYtoQuadKey (zoom, tileX, tileY);
   cTileSet* tileSet = getLayer().mZoomTileSet[zoom];
-  return tileSet->getTexture (quadKey);
+
+  unique_lock<mutex> lock (mTextureMutex);
+  return tileSet->getTexture (quadKey, mUseCount);
   }
 //}}}
 //{{{
@@ -329,12 +347,47 @@ void cTiledMap::cycleGrid() {
   }
 //}}}
 
+//{{{
+void cTiledMap::trimTextures() {
+// called once a frame after draw has got its textures, evict least recently drawn textures over budget
+// - evicted tiles keep their file present entry, reload decodes from file not network
+
+  unique_lock<mutex> lock (mTextureMutex);
+
+  uint64_t drawnCount = mUseCount++;
+  if (mResidentBytes <= mTextureBudget)
+    return;
+
+  vector<cTile*> tiles;
+  for (auto& layer : mLayers)
+    for (uint32_t zoom = layer.mLayerSpec.mMinZoom; zoom <= layer.mLayerSpec.mMaxZoom; zoom++)
+      for (auto& tile : layer.mZoomTileSet[zoom]->getTileMap())
+        if (!tile.second.mTexture.empty() && (tile.second.mLastUsed < drawnCount))
+          tiles.push_back (&tile.second);
+
+  sort (tiles.begin(), tiles.end(), [](const cTile* a, const cTile* b) { return a->mLastUsed < b->mLastUsed; });
+
+  // evict to 7/8 budget, avoid evicting every draw
+  uint32_t numEvictions = 0;
+  for (auto tile : tiles) {
+    if (mResidentBytes <= (mTextureBudget / 8) * 7)
+      break;
+    mResidentBytes -= tile->release();
+    numEvictions++;
+    }
+
+  mNumEvictions += numEvictions;
+  cLog::log (LOGINFO1, fmt::format ("trimTextures evicted {} resident {}m",
+                                    numEvictions, mResidentBytes / (1024 * 1024)));
+  }
+//}}}
 //{{{
 void cTiledMap::releaseTextures() {
 
+  unique_lock<mutex> lock (mTextureMutex);
   for (auto& layer : mLayers)
     for (uint32_t zoom = layer.mLayerSpec.mMinZoom; zoom <= layer.mLayerSpec.mMaxZoom; zoom++)
-      layer.mZoomTileSet[zoom]->releaseTextures();
+      mResidentBytes -= layer.mZoomTileSet[zoom]->releaseTextures();
 
   tilesChanged (true);
   }
@@ -424,8 +477,11 @@ void cTiledMap::setCentreLatLon (double lat, double lon, bool flushQueue) {
 bool cTiledMap::queueLoad (int xTile, int yTile) {
 
   string quadKey = zoomTileXYtoQuadKey (mZoom, xTile, yTile);
+  {
+  unique_lock<mutex> lock (mTextureMutex);
   if (getZoomTileSet (mZoom)->getLoaded (quadKey))
     return false;
+  }
 
   // !!!! is this ok, doesn't have to be 100% accurate !!!
   for (tbb::concurrent_queue<string>::const_iterator i(mLoadQueue.unsafe_begin()); i != mLoadQueue.unsafe_end(); ++i) {
@@ -469,7 +525,7 @@ void cTiledMap::fileScan() {
         for (const filesystem::directory_entry& entry : filesystem::directory_iterator (srcPath)) {
           if (entry.path().extension().string() == layer.mLayerSpec.mExtension) {
             // add unloaded tile
-            layer.addTile (entry.path().stem().string(), mTileRange, cTexture());
+            addTile (layer, entry.path().stem().string(), cTexture(), 0);
             numLayerFiles++;
             }
           }
@@ -509,6 +565,7 @@ void cTiledMap::fileScan() {
 //}}}
 //{{{
 void cTiledMap::loadTiles (uint32_t threadIndex) {
+// load queued tiles with files, batch the rest into one pipelined download
 
   // !!! should assert maxSize !!!!
   uint8_t* fileBuf = new uint8_t [kMapMaxPngSize];
@@ -517,8 +574,13 @@ void cTiledMap::loadTiles (uint32_t threadIndex) {
   http.initialise();
 
   while (true) {
+    bool popped = false;
+    vector <string> downloadQuadKeys;
+    vector <string> downloadFileNames;
+
     string quadKey;
-    if (mLoadQueue.try_pop (quadKey)) {
+    while ((downloadQuadKeys.size() < kMapPipelineDepth) && mLoadQueue.try_pop (quadKey)) {
+      popped = true;
       cTiledMapLayer& layer = getLayer();
       string fileName = fmt::format ("{}/{}/{}/{}{}",
                                      mMapFileRoot, layer.mLayerSpec.mName, quadKey.size(), quadKey, layer.mLayerSpec.mExtension);
@@ -542,7 +604,7 @@ void cTiledMap::loadTiles (uint32_t threadIndex) {
                                            quadKey, fileBufLen, findUs, loadUs, decodeUs));
 
           // add loaded tile
-          layer.addTile (quadKey, mTileRange, texture);
+          addTile (layer, quadKey, texture, mUseCount);
           if (mChangedCallback)
             mChangedCallback();
           }
@@ -551,78 +613,99 @@ void cTiledMap::loadTiles (uint32_t threadIndex) {
         }
         //}}}
       else {
-        //{{{  file notFound, download, save, decode to texture
-        string hostName = fmt::vformat (layer.mLayerSpec.mHost, fmt::make_format_args (threadIndex));
-        string pathName = fmt::vformat (layer.mLayerSpec.mPath, fmt::make_format_args (quadKey, mApiKey));
-
-        int response = http.get (hostName, pathName);
-        if (response == 200) {
-          //  download ok
-          auto downTime = system_clock::now();
-          int64_t downUs = duration_cast<milliseconds>(downTime - findTime).count();
-
-          if (layer.mLayerSpec.mSave && http.getContentSize() < layer.mLayerSpec.mMinSize) {
-            // too small to save, add to emptyTile set
-            int64_t loadTime = duration_cast<microseconds>(system_clock::now() - startTime).count();
-            cLog::log (LOGINFO2, fmt::format ("{} empty  {}us", quadKey, loadTime));
-
-            mNumEmptyDownloads++;
-            layer.addEmptyTile (quadKey, mTileRange);
-            }
-
-          else {
-            mNumDownloads++;
-
-            uint8_t* httpPngBuf = http.getContent();
-            uint32_t httpPngBufLen = http.getContentSize();
-
-            cTexture texture = cTexture::createDecode (httpPngBuf, httpPngBufLen);
-            if (!texture.empty()) {
-              auto decodeTime = system_clock::now();
-              int64_t decodeUs = duration_cast<microseconds>(decodeTime - downTime).count();
-
-              // decode ok
-              if (layer.mLayerSpec.mSave) {
-                //{{{  loaded and save
-                FILE* writeFile = fopen (fileName.c_str(), "wb");
-                if (writeFile) {
-                  fwrite (httpPngBuf, 1, httpPngBufLen, writeFile);
-                  fclose (writeFile);
-
-                  auto writeTime = system_clock::now();
-                  int64_t writeUs = duration_cast<microseconds>(writeTime - decodeTime).count();
-                  cLog::log (LOGINFO, fmt::format ("{} size:{:6} find:{:4}us down:{:4}ms decode:{:4}us write:{:5}us",
-                                                   quadKey, httpPngBufLen, findUs, downUs, decodeUs, writeUs));
-                  // add loaded and saved tile
-                  layer.addTile (quadKey, mTileRange, texture);
-                  }
-                else
-                  cLog::log (LOGERROR, fmt::format ("download - failed to save {}", quadKey));
-                }
-                //}}}
-              else {
-                //{{{  loaded but don't save
-                cLog::log (LOGINFO, fmt::format ("{} size:{:6} find:{:4}us down:{:4}ms decode:{:4}us",
-                                                 quadKey, httpPngBufLen, findUs, downUs, decodeUs));
-                // add loaded and unsaved tile
-                layer.addTile (quadKey, mTileRange, texture);
-                }
-                //}}}
-              }
-            else
-              cLog::log (LOGERROR, fmt::format ("{} size:{:6} download decode failed", quadKey, httpPngBufLen));
-
-            if (mChangedCallback)
-              mChangedCallback();
-            }
-          }
+        // file notFound, download
+        downloadQuadKeys.push_back (quadKey);
+        downloadFileNames.push_back (fileName);
         }
-        //}}}
       }
-    else
+
+    if (!downloadQuadKeys.empty()) {
+      //{{{  download, save, decode to texture, responses in queue order
+      cTiledMapLayer& layer = getLayer();
+      string hostName = fmt::vformat (layer.mLayerSpec.mHost, fmt::make_format_args (threadIndex));
+
+      vector <string> pathNames;
+      for (auto& downloadQuadKey : downloadQuadKeys)
+        pathNames.push_back (fmt::vformat (layer.mLayerSpec.mPath, fmt::make_format_args (downloadQuadKey, mApiKey)));
+
+      auto startTime = system_clock::now();
+      http.getPipelined (hostName, pathNames, kMapPipelineDepth, [&](size_t index, int response) {
+        if (response == 200)
+          addDownloadedTile (layer, downloadQuadKeys[index], downloadFileNames[index],
+                             http.getContent(), http.getContentSize(),
+                             duration_cast<milliseconds>(system_clock::now() - startTime).count());
+        });
+      }
+      //}}}
+    else if (!popped)
       mLoadSem.wait();
     }
 
   delete[] fileBuf;
   }
 //}}}
+//{{{
+void cTiledMap::addDownloadedTile (cTiledMapLayer& layer, const string& quadKey, const string& fileName,
+                                   uint8_t* httpPngBuf, uint32_t httpPngBufLen, int64_t downMs) {
+
+  auto downTime = system_clock::now();
+
+  if (layer.mLayerSpec.mSave && (int)httpPngBufLen < layer.mLayerSpec.mMinSize) {
+    // too small to save, add to emptyTile set
+    cLog::log (LOGINFO2, fmt::format ("{} empty  {}ms", quadKey, downMs));
+
+    mNumEmptyDownloads++;
+    layer.addEmptyTile (quadKey, mTileRange);
+    return;
+    }
+
+  mNumDownloads++;
+
+  cTexture texture = cTexture::createDecode (httpPngBuf, httpPngBufLen);
+  if (!texture.empty()) {
+    auto decodeTime = system_clock::now();
+    int64_t decodeUs = duration_cast<microseconds>(decodeTime - downTime).count();
+
+    // decode ok
+    if (layer.mLayerSpec.mSave) {
+      //{{{  loaded and save
+      FILE* writeFile = fopen (fileName.c_str(), "wb");
+      if (writeFile) {
+        fwrite (httpPngBuf, 1, httpPngBufLen, writeFile);
+        fclose (writeFile);
+
+        auto writeTime = system_clock::now();
+        int64_t writeUs = duration_cast<microseconds>(writeTime - decodeTime).count();
+        cLog::log (LOGINFO, fmt::format ("{} size:{:6} down:{:4}ms decode:{:4}us write:{:5}us",
+                                         quadKey, httpPngBufLen, downMs, decodeUs, writeUs));
+        // add loaded and saved tile
+        addTile (layer, quadKey, texture, mUseCount);
+        }
+      else
+        cLog::log (LOGERROR, fmt::format ("download - failed to save {}", quadKey));
+      }
+      //}}}
+    else {
+      //{{{  loaded but don't save
+      cLog::log (LOGINFO, fmt::format ("{} size:{:6} down:{:4}ms decode:{:4}us",
+                                       quadKey, httpPngBufLen, downMs, decodeUs));
+      // add loaded and unsaved tile
+      addTile (layer, quadKey, texture, mUseCount);
+      }
+      //}}}
+    }
+  else
+    cLog::log (LOGERROR, fmt::format ("{} size:{:6} download decode failed", quadKey, httpPngBufLen));
+
+  if (mChangedCallback)
+    mChangedCallback();
+  }
+//}}}
+//{{{
+void cTiledMap::addTile (cTiledMapLayer& layer, const string& quadKey, cTexture texture, uint64_t useCount) {
+// loader threads - add tile, with texture if loaded, while draw or trimTextures may be using the tileSet
+
+  unique_lock<mutex> lock (mTextureMutex);
+  mResidentBytes += layer.addTile (quadKey, mTileRange, texture, useCount);
+  }
+//}}}
@@ -7,6 +7,8 @@
 #include <array>
 #include <vector>
 #include <functional>
+#include <atomic>
+#include <mutex>
 
 #include "oneapi/tbb/concurrent_queue.h"
 #include "oneapi/tbb/concurrent_unordered_map.h"
@@ -21,21 +23,35 @@ constexpr uint32_t kMapMaxZoom = 17;
 constexpr uint32_t kMapTileSize = 256;
 constexpr uint32_t kMapMaxPngSize = 200000;
 constexpr uint32_t kMapLoadThreads = 4;
+constexpr uint32_t kMapPipelineDepth = 4;
+constexpr int64_t kMapTextureBudget = 128 * 1024 * 1024; // 512 decoded 256x256 tiles
 
 //{{{
 struct cTile {
-  cTile (cTexture texture, float scaledX, float scaledY) :
-    mTexture(texture), mScaledX(scaledX), mScaledY(scaledY) {}
+  cTile (cTexture texture, float scaledX, float scaledY, uint64_t lastUsed) :
+    mTexture(texture), mScaledX(scaledX), mScaledY(scaledY), mLastUsed(lastUsed) {}
 
-  void set (cTexture texture, float scaledX, float scaledY) {
+  void set (cTexture texture, float scaledX, float scaledY, uint64_t lastUsed) {
     mTexture = texture;
     mScaledX = scaledX;
     mScaledY = scaledY;
+    mLastUsed = lastUsed;
+    }
+
+  int64_t getBytes() const { return int64_t(mTexture.getWidth()) * mTexture.getHeight() * sizeof(cTexture::uPixel); }
+
+  int64_t release() {
+  // release decoded texture, tile stays as unloaded file present, return bytes released
+    int64_t bytes = getBytes();
+    mTexture.release();
+    mTexture = cTexture();
+    return bytes;
     }
 
   cTexture mTexture;
   float mScaledX;
   float mScaledY;
+  uint64_t mLastUsed;
   };
 //}}}
 //{{{
@@ -68,12 +84,12 @@ public:
   tbb::concurrent_unordered_set <std::string>& getEmptyTileSet() { return mEmptyTileSet; }
 
   bool getLoaded (const std::string& quadKey);
-  cTexture getTexture (const std::string& quadKey);
+  cTexture getTexture (const std::string& quadKey, uint64_t useCount);
 
-  void addTile (const std::string& quadKey, cTexture texture, float scaledX, float scaledY);
+  int64_t addTile (const std::string& quadKey, cTexture texture, float scaledX, float scaledY, uint64_t useCount);
   void addEmptyTile (const std::string& quadKey);
 
-  void releaseTextures();
+  int64_t releaseTextures();
   void dumpEmptyFiles (const std::string& fileName);
 
 private:
@@ -112,7 +128,7 @@ public:
   cTiledMapLayer(const cLayerSpec& layerSpec);
   virtual ~cTiledMapLayer() = default; // could delete zoomTileSet
 
-  void addTile (const std::string& quadKey, cRange& tileRange, cTexture texture);
+  int64_t addTile (const std::string& quadKey, cRange& tileRange, cTexture texture, uint64_t useCount);
   void addEmptyTile (const std::string& quadKey, cRange& tileRange);
   void dumpEmptyFiles (const std::string& fileRoot);
 
@@ -177,6 +193,10 @@ public:
   int getNumEmptyDownloads() { return mNumEmptyDownloads; }
   int getNumAlreadyQueued() { return mNumAlreadyQueued; }
 
+  int64_t getResidentBytes() { return mResidentBytes; }
+  int64_t getTextureBudget() { return mTextureBudget; }
+  uint32_t getNumEvictions() { return mNumEvictions; }
+
   std::vector<std::string> getLayerNames();
 
   bool getShowGrid() { return mShowGrid; }
@@ -190,8 +210,11 @@ public:
 
   void cycleLayers();
   void cycleGrid();
+
+  void setTextureBudget (int64_t bytes) { mTextureBudget = bytes; }
   //}}}
 
+  void trimTextures();
   void releaseTextures();
   void dumpEmptyFiles();
 
@@ -208,6 +231,9 @@ private:
 
   void fileScan();
   void loadTiles (uint32_t threadIndex);
+  void addTile (cTiledMapLayer& layer, const std::string& quadKey, cTexture texture, uint64_t useCount);
+  void addDownloadedTile (cTiledMapLayer& layer, const std::string& quadKey, const std::string& fileName,
+                          uint8_t* httpPngBuf, uint32_t httpPngBufLen, int64_t downMs);
 
   // private vars
   cTiledMapSpec mMapSpec;
@@ -234,4 +260,12 @@ private:
   uint32_t mNumDownloads = 0;
   uint32_t mNumEmptyDownloads = 0;
   uint32_t mNumAlreadyQueued = 0;
+
+  // decoded texture residency, lru by draw count
+  // - textureMutex orders loader threads adding textures against draw and trim on ui thread
+  std::mutex mTextureMutex;
+  std::atomic<uint64_t> mUseCount = 1;
+  std::atomic<int64_t> mResidentBytes = 0;
+  int64_t mTextureBudget = kMapTextureBudget;
+  uint32_t mNumEvictions = 0;
   };
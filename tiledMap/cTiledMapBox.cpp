@@ -78,6 +78,12 @@ void cTiledMapBox::draw() {
     yTile++;
     }
 
+  // every draw marks all visible tiles, trim once per frame, draw of each damaged rect marks them again
+  if (mWindow.getFrameNum() != mTrimFrameNum) {
+    mTrimFrameNum = mWindow.getFrameNum();
+    mTiledMap.trimTextures();
+    }
+
   drawTextShadow (kWhite,
                   {getTL(), getTL() + cPoint(400.f, getBoxHeight())},
                   fmt::format ("lat:{:6.4} lon:{:6.4} zoom:{} d:{} e:{} a:{} ",
@@ -14,4 +14,5 @@ public:
 
 private:
   cTiledMap& mTiledMap;
+  uint64_t mTrimFrameNum = 0;
   };
@@ -102,6 +102,10 @@ void cTiledMapOverviewBox::draw() {
   uint32_t numTilesY = uint32_t(mMap.getRangeY() * tileSet->getScale());
   drawText (kWhite, {getTL(), getTL() + cPoint(240.f, getBoxHeight())},
             fmt::format ("{} {}x{}", tileSet->getNumTiles(), numTilesX, numTilesY));
+  drawText (kWhite, {getTL() + cPoint(0.f, getBoxHeight()), getTL() + cPoint(240.f, 2.f * getBoxHeight())},
+            fmt::format ("{}m of {}m evicted:{}",
+                         mMap.getResidentBytes() / (1024 * 1024), mMap.getTextureBudget() / (1024 * 1024),
+                         mMap.getNumEvictions()));
 
   //drawBorder (kWhite, 1);
   }